@@ -0,0 +1,270 @@
+#include "AmbiguityTable.h"
+#include "BlastInfo.h"
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+#include <string.h>
+#include <stdlib.h>
+
+/////////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2007 Affymetrix, Inc.                                         //
+//                                                                             //
+// This program is free software; you can redistribute it and/or modify        //
+// it under the terms of the GNU General Public License (version 2) as         //
+// published by the Free Software Foundation.                                  //
+//                                                                             //
+// This program is distributed in the hope that it will be useful,             //
+// but WITHOUT ANY WARRANTY; without even the implied warranty of              // 
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU            //
+// General Public License for more details.                                    //
+//                                                                             //
+// You should have received a copy of the GNU General Public License           //
+// along with this program;if not, write to the                                //
+//                                                                             //
+// Free Software Foundation, Inc.,                                             //
+// 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA                       // 
+/////////////////////////////////////////////////////////////////////////////////
+
+static const char AMB_MAGIC[8] = {'P','G','A','M','B','0','1','\0'};
+static const char MSK_MAGIC[8] = {'P','G','M','S','K','0','1','\0'};
+
+///////////////////////////////////////////////////////////////////////////////
+// AmbiguityTable (constructor)                                              //
+//    desc: an empty table.  load() fills it in for one db file.             //
+///////////////////////////////////////////////////////////////////////////////  
+
+AmbiguityTable::AmbiguityTable() {
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// load                                                                      //
+//  inputs: db filename <std::string>, blast db flag <bool>                  //
+//  output: true if the db has an ambiguity table <bool>                     //
+//    desc: reads the .amb file next to a pgrep db, or the tables kept in a  //
+//          blast db.  Pgrep dbs built before .amb files have none.          //
+///////////////////////////////////////////////////////////////////////////////  
+
+bool AmbiguityTable::load(std::string filename, bool isBlast) {
+  runs.clear();
+  return (isBlast) ? loadBlast(filename) : loadRuns(filename + ".amb", AMB_MAGIC);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// loadMask                                                                  //
+//  inputs: pgrep db filename <std::string>                                  //
+//  output: true if the db has a mask file <bool>                            //
+//    desc: reads the .msk file next to a pgrep db - the soft-masked         //
+//          (lowercase) and low-complexity runs, in the .amb layout.  Blast  //
+//          dbs have none.                                                   //
+///////////////////////////////////////////////////////////////////////////////  
+
+bool AmbiguityTable::loadMask(std::string filename) {
+  runs.clear();
+  return loadRuns(filename + ".msk", MSK_MAGIC);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// loadRuns                                                                  //
+//  inputs: run filename <std::string>, file magic <char*>                   //
+//  output: true if the file was found <bool>                                //
+//    desc: .amb and .msk files are the magic, the number of seqs, then for  //
+//          each seq in db order its number of runs and their (start,        //
+//          length) pairs, all unsigned ints                                 //
+///////////////////////////////////////////////////////////////////////////////  
+
+bool AmbiguityTable::loadRuns(std::string runFilename, const char *magic) {
+  std::ifstream runFile(runFilename.c_str(), std::ios::in | std::ios::binary);
+  if (!runFile.is_open()) {
+    return false;
+  }
+  
+  char fileMagic[sizeof(AMB_MAGIC)];
+  runFile.read(fileMagic, sizeof(AMB_MAGIC));
+  if (!runFile || memcmp(fileMagic, magic, sizeof(AMB_MAGIC)) != 0) {
+    std::cerr << "Error: " << runFilename << " is not a pgrep base run file.\n";
+    exit(1);
+  }
+  
+  unsigned int nseqs = 0;
+  runFile.read((char*)&nseqs, sizeof(unsigned int));
+  for (unsigned int s=0; s < nseqs && runFile; ++s) {
+    unsigned int nruns = 0;
+    runFile.read((char*)&nruns, sizeof(unsigned int));
+    for (unsigned int r=0; r < nruns && runFile; ++r) {
+      BaseRun run;
+      runFile.read((char*)&run.start, sizeof(unsigned int));
+      runFile.read((char*)&run.length, sizeof(unsigned int));
+      addRun(s, run.start, run.length);
+    }
+  }
+  if (!runFile) {
+    std::cerr << "Error: Truncated base run file: " << runFilename << "\n";
+    exit(1);
+  }
+  return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// loadBlast                                                                 //
+//  inputs: blast db name <std::string>                                      //
+//  output: true (blast dbs always have ambiguity tables) <bool>             //
+//    desc: each table is a big-endian word count, then one word per run     //
+//          (residue:4, length-1:4, offset:24), or when the top bit of the   //
+//          count is set two words per run (residue:4, length-1:12, unused   //
+//          :16 then a 32-bit offset)                                        //
+///////////////////////////////////////////////////////////////////////////////  
+
+static bool byStart(const BaseRun &run1, const BaseRun &run2) {
+  return run1.start < run2.start;
+}
+
+bool AmbiguityTable::loadBlast(std::string filename) {
+  std::string nsqFilename = filename + ".nsq";
+  std::ifstream nsqFile(nsqFilename.c_str(), std::ios::in | std::ios::binary);
+  if (!nsqFile.is_open()) {
+    std::cerr << "Error opening sequence database file: " << nsqFilename << "\n";
+    exit(1);
+  }
+  
+  BlastInfo* biseqs[MAX_BLAST_ENTRIES+1];
+  loadBlastInfo(filename, biseqs);
+  
+  for (int i=0; biseqs[i] != NULL; ++i) {
+    if (biseqs[i]->getAmbLength() >= BLAST_INT) {
+      nsqFile.seekg(biseqs[i]->getAmbOffset(), std::ios::beg);
+      int count;
+      nsqFile.read((char*)&count, BLAST_INT);
+      count = longSwap(count);
+      bool newFormat = (count & 0x80000000) != 0;
+      count &= 0x7FFFFFFF;
+      if ((count + 1)*BLAST_INT > biseqs[i]->getAmbLength()) {
+        std::cerr << "Error: Bad ambiguity table for " << biseqs[i]->getSeqName() << " in file: " << nsqFilename << "\n";
+        exit(1);
+      }
+      
+      std::vector<int> words(count);
+      if (count > 0) {
+        nsqFile.read((char*)&words[0], count*BLAST_INT);
+      }
+      std::vector<BaseRun> seqRuns;
+      for (int w=0; w < count; ++w) {
+        unsigned int word = longSwap(words[w]);
+        BaseRun run;
+        if (newFormat) {
+          if (w+1 == count) {
+            break;
+          }
+          run.start = longSwap(words[++w]);
+          run.length = ((word >> 16) & 0xFFF) + 1;
+        }
+        else {
+          run.start = word & 0xFFFFFF;
+          run.length = ((word >> 24) & 0xF) + 1;
+        }
+        seqRuns.push_back(run);
+      }
+      std::sort(seqRuns.begin(), seqRuns.end(), byStart);
+      for (unsigned int r=0; r < seqRuns.size(); ++r) {
+        addRun(i, seqRuns[r].start, seqRuns[r].length);
+      }
+    }
+    delete biseqs[i];
+  }
+  
+  if (!nsqFile) {
+    std::cerr << "Error: Truncated ambiguity table in file: " << nsqFilename << "\n";
+    exit(1);
+  }
+  return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// addRun                                                                    //
+//  inputs: seq index <int>, first base <uns int>, number of bases <uns int> //
+//  output: none                                                             //
+//    desc: runs arrive in order - touching or overlapping ones are merged   //
+///////////////////////////////////////////////////////////////////////////////  
+
+void AmbiguityTable::addRun(int seq, unsigned int start, unsigned int length) {
+  if ((int) runs.size() <= seq) {
+    runs.resize(seq + 1);
+  }
+  std::vector<BaseRun> &seqRuns = runs[seq];
+  if (!seqRuns.empty()) {
+    BaseRun &last = seqRuns.back();
+    if (start < last.start) {
+      std::cerr << "Error: Base runs out of order.\n";
+      exit(1);
+    }
+    if (start <= last.start + last.length) {
+      last.length = std::max(last.length, start + length - last.start);
+      return;
+    }
+  }
+  BaseRun run = {start, length};
+  seqRuns.push_back(run);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// getRuns                                                                   //
+//  inputs: seq index in the db file <int>                                   //
+//  output: the runs of the seq, NULL if it has none                         //
+///////////////////////////////////////////////////////////////////////////////  
+
+const std::vector<BaseRun> *AmbiguityTable::getRuns(int seq) {
+  if (seq >= (int) runs.size() || runs[seq].empty()) {
+    return NULL;
+  }
+  return &runs[seq];
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// getBaseCount                                                              //
+//  inputs: none                                                             //
+//  output: ambiguous bases in the whole db file <uns long long>             //
+///////////////////////////////////////////////////////////////////////////////  
+
+unsigned long long AmbiguityTable::getBaseCount() {
+  unsigned long long bases = 0;
+  for (unsigned int s=0; s < runs.size(); ++s) {
+    for (unsigned int r=0; r < runs[s].size(); ++r) {
+      bases += runs[s][r].length;
+    }
+  }
+  return bases;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// firstRun                                                                  //
+//  inputs: sorted runs <vector BaseRun>, 0-based position <uns int>         //
+//  output: the first run that ends after the position <iterator>           //
+///////////////////////////////////////////////////////////////////////////////  
+
+static bool endsBefore(const BaseRun &run, unsigned int position) {
+  return run.start + run.length <= position;
+}
+
+std::vector<BaseRun>::const_iterator AmbiguityTable::firstRun(const std::vector<BaseRun> &runs, unsigned int position) {
+  return std::lower_bound(runs.begin(), runs.end(), position, endsBefore);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// overlaps                                                                  //
+//  inputs: sorted runs <vector BaseRun>, first base <uns int>, base after   //
+//          the last <uns int>                                               //
+//  output: true if any base in [start, end) is ambiguous <bool>             //
+//    desc: only the last run starting before end can reach into the range  //
+///////////////////////////////////////////////////////////////////////////////  
+
+static bool startsBefore(unsigned int position, const BaseRun &run) {
+  return position < run.start;
+}
+
+bool AmbiguityTable::overlaps(const std::vector<BaseRun> &runs, unsigned int start, unsigned int end) {
+  std::vector<BaseRun>::const_iterator next = std::upper_bound(runs.begin(), runs.end(), end - 1, startsBefore);
+  if (next == runs.begin()) {
+    return false;
+  }
+  --next;
+  return next->start + next->length > start;
+}
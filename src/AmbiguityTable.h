@@ -0,0 +1,61 @@
+#ifndef AMBIGUITYTABLE_H__
+#define AMBIGUITYTABLE_H__
+
+#include <string>
+#include <vector>
+#include "Properties.h"
+
+/////////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2007 Affymetrix, Inc.                                         //
+//                                                                             //
+// This program is free software; you can redistribute it and/or modify        //
+// it under the terms of the GNU General Public License (version 2) as         //
+// published by the Free Software Foundation.                                  //
+//                                                                             //
+// This program is distributed in the hope that it will be useful,             //
+// but WITHOUT ANY WARRANTY; without even the implied warranty of              // 
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU            //
+// General Public License for more details.                                    //
+//                                                                             //
+// You should have received a copy of the GNU General Public License           //
+// along with this program;if not, write to the                                //
+//                                                                             //
+// Free Software Foundation, Inc.,                                             //
+// 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA                       // 
+/////////////////////////////////////////////////////////////////////////////////
+
+// a run of ambiguous bases (0-based first base, number of bases)
+struct BaseRun {
+  unsigned int start;
+  unsigned int length;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// AmbiguityTable                                                            //
+// - The runs of non-ACGT bases (N gaps and IUPAC codes) of each sequence of //
+//   one db file.  Packed sequences hold a random base for each of them.     //
+//   Pgrep dbs carry the runs in a .amb file written by generatePgrepDB.pl;  //
+//   blast dbs keep them after each sequence in the .nsq file.               //
+// - loadMask fills one with the masked runs of a pgrep db instead (.msk).   //
+///////////////////////////////////////////////////////////////////////////////  
+
+class AmbiguityTable {
+  public:
+    AmbiguityTable();
+    bool load(std::string filename, bool isBlast);
+    bool loadMask(std::string filename);
+    const std::vector<BaseRun> *getRuns(int seq);
+    unsigned long long getBaseCount();
+    
+    static std::vector<BaseRun>::const_iterator firstRun(const std::vector<BaseRun> &runs, unsigned int position);
+    static bool overlaps(const std::vector<BaseRun> &runs, unsigned int start, unsigned int end);
+    
+  private:
+    bool loadRuns(std::string runFilename, const char *magic);
+    bool loadBlast(std::string filename);
+    void addRun(int seq, unsigned int start, unsigned int length);
+  
+    std::vector<std::vector<BaseRun> > runs; // sorted and merged, by seq
+};
+
+#endif // AMBIGUITYTABLE_H__
@@ -1,15 +1,23 @@
 #include "BlastInfo.h"
+#include "Properties.h"
 #include <string>
 #include <string.h>
+#include <iostream>
+#include <fstream>
+#include <stdlib.h>
 
 BlastInfo::BlastInfo(char *name, int offset, int length) {
   strcpy(seqName, name);
   startOffset = offset;
   seqLength = length;
+  ambOffset = offset + length;
+  ambLength = 0;
 }
 
 BlastInfo::BlastInfo(char *name) {
   strcpy(seqName, name);
+  ambOffset = 0;
+  ambLength = 0;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -36,3 +44,165 @@ void BlastInfo::setSeqLength(int sl) {
   seqLength = sl;
 }
 
+int BlastInfo::getAmbOffset() {
+  return ambOffset;
+}
+
+int BlastInfo::getAmbLength() {
+  return ambLength;
+}
+
+void BlastInfo::setAmbiguities(int ao, int al) {
+  ambOffset = ao;
+  ambLength = al;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// longSwap                                                                  //
+//  inputs: 32-bit integer to be reversed (from big endian to little end.)   //
+//  output: swapped 32-bits                                                  //
+//    desc: blast info files are written big-endian.  Need to convert.       //
+///////////////////////////////////////////////////////////////////////////////
+
+int longSwap (int i)
+{
+  unsigned char b1, b2, b3, b4;
+
+  b1 = i & 255;
+  b2 = ( i >> 8 ) & 255;
+  b3 = ( i>>16 ) & 255;
+  b4 = ( i>>24 ) & 255;
+
+  return ((int)b1 << 24) + ((int)b2 << 16) + ((int)b3 << 8) + b4;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// loadBlastInfo                                                             //
+//  inputs: blast db name <std::string>, ptr to blast info array <BlastInfo*>//
+//  output: none                                                             //
+//    desc: reads in .nin file to figure out seq names and offsets           //
+//          .nin format is hard-coded here so if the format ever changes     //
+//          this will need to be changed                                     //
+//          at the same time, reads in .nhr file for the header names        //
+///////////////////////////////////////////////////////////////////////////////  
+
+void loadBlastInfo(std::string filename, BlastInfo* biseqs[]) {
+  std::string ninFilename;
+  std::string nhrFilename;
+  ninFilename = filename + ".nin";
+  nhrFilename = filename + ".nhr";
+  
+  std::ifstream blastNinFile;
+  blastNinFile.open (ninFilename.c_str(), std::ios::in | std::ios::binary);
+  if (!blastNinFile.is_open()) { 
+    std::cerr << "Error opening blast .nin file: " << ninFilename << "\n";
+    exit(1);
+  }
+  
+  std::ifstream blastNhrFile;
+  blastNhrFile.open (nhrFilename.c_str(), std::ios::in | std::ios::binary);
+  if (!blastNhrFile.is_open()) { 
+    std::cerr << "Error opening blast .nhr file: " << nhrFilename << "\n";
+    exit(1);
+  }
+  
+  // read in formatdb version
+  int formatdb;
+  blastNinFile.read((char*)&formatdb, BLAST_INT);
+   
+  // read in blast db type
+  int blastType; 
+  blastNinFile.read((char*)&blastType, BLAST_INT);
+  if (blastType != 0) {
+  	// not a nucleotide db!
+  	std::cerr << "Error: blast file " << ninFilename << " is not a nucleotide blast db.\n";
+    exit(1);
+  }
+  
+  // read through title
+  int titleSize;
+  blastNinFile.read((char*)&titleSize, BLAST_INT);
+  titleSize = longSwap(titleSize);
+  char ignore;
+  
+  for (int i = 0; i < titleSize; ++i) {
+  	blastNinFile.read((char*)&ignore, 1);
+  }
+  
+  // read through date
+  int dateSize;
+  blastNinFile.read((char*)&dateSize, BLAST_INT);
+  dateSize = longSwap(dateSize);
+  for (int i = 0; i < dateSize; ++i) {
+  	blastNinFile.read((char*)&ignore, 1);
+  }
+  
+  // now get to the good stuff
+  int nseqs;
+  blastNinFile.read((char*)&nseqs, BLAST_INT);
+  nseqs = longSwap(nseqs);
+  if (nseqs > MAX_BLAST_ENTRIES) {
+  	std::cerr << "Error:  Blast db has too many seq entries.  Right now PGREP is limited to " << MAX_BLAST_ENTRIES << ".\n";
+  	exit(1);
+  }
+  
+  // total seq length appears to be little-endian, 64 bit
+  long long int tseq;
+  blastNinFile.read((char*)&tseq, BLAST_INT*2);
+  
+  int maxseq;
+  blastNinFile.read((char*)&maxseq, BLAST_INT);
+  maxseq = longSwap(maxseq);
+    
+  // loop through the seq names
+  int lastOffset;
+  int nextOffset;
+  blastNinFile.read((char*)&lastOffset, BLAST_INT);
+  lastOffset = longSwap(lastOffset);
+  char ignoreText[8];
+  char seqName[256];
+ 
+  for (int i = 0; i < nseqs; ++i) {
+    blastNinFile.read((char*)&nextOffset, BLAST_INT);
+  	nextOffset = longSwap(nextOffset);
+  	
+  	// read text from the last to next offset
+  	// - the first 8 chars get tossed - not sure what this is
+  	// - also toss last 32 chars... 
+  	blastNhrFile.read((char*)&ignoreText, 8);
+  	blastNhrFile.read((char*)&seqName, (nextOffset - (lastOffset + 8)));
+  	seqName[nextOffset - (lastOffset + 40)] = '\0';
+  	biseqs[i] = new BlastInfo(seqName);
+  	lastOffset = nextOffset;
+  }
+  
+  blastNinFile.read((char*)&lastOffset, BLAST_INT);
+  lastOffset = longSwap(lastOffset);
+  
+  for (int i = 0; i < nseqs; ++i) {
+    blastNinFile.read((char*)&nextOffset, BLAST_INT);
+  	nextOffset = longSwap(nextOffset);
+
+    biseqs[i]->setStartOffset(lastOffset);
+    biseqs[i]->setSeqLength(nextOffset-lastOffset); 
+    biseqs[i]->setAmbiguities(nextOffset, 0);
+  	lastOffset = nextOffset;
+  }
+  biseqs[nseqs] = NULL;  
+  
+  // the ambiguity offsets follow - each seq's packed bases end where its
+  // ambiguity table starts, and the table runs up to the next seq
+  int ambOffset;
+  for (int i = 0; i < nseqs && blastNinFile; ++i) {
+    blastNinFile.read((char*)&ambOffset, BLAST_INT);
+    ambOffset = longSwap(ambOffset);
+    int start = biseqs[i]->getStartOffset();
+    int end = biseqs[i]->getAmbOffset();
+    if (!blastNinFile || ambOffset < start || ambOffset > end) {
+      break;
+    }
+    biseqs[i]->setSeqLength(ambOffset - start);
+    biseqs[i]->setAmbiguities(ambOffset, end - ambOffset);
+  }
+}
+  
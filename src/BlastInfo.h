@@ -1,4 +1,9 @@
 
+#ifndef BLASTINFO_H__
+#define BLASTINFO_H__
+
+#include <string>
+
 /////////////////////////////////////////////////////////////////////////////////
 // Copyright (C) 2007 Affymetrix, Inc.                                         //
 //                                                                             //
@@ -32,12 +37,22 @@ class BlastInfo {
     char *getSeqName();
     int getSeqLength();
     int getStartOffset();
+    int getAmbOffset();
+    int getAmbLength();
     void setSeqLength(int so);
     void setStartOffset(int so);
+    void setAmbiguities(int ao, int al);
     
   private:
     char seqName[256];
     int startOffset;
     int seqLength;
+    int ambOffset; // .nsq offset of the ambiguity table that follows the seq
+    int ambLength; // and its size in bytes (0 when the seq has none)
 };
 
+// blast db readers shared by pgrep and the db tools
+int longSwap(int i);
+void loadBlastInfo(std::string filename, BlastInfo* biseqs[]);
+
+#endif // BLASTINFO_H__
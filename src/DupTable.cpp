@@ -0,0 +1,120 @@
+#include "DupTable.h"
+#include <iostream>
+#include <fstream>
+#include <string.h>
+#include <stdlib.h>
+
+/////////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2007 Affymetrix, Inc.                                         //
+//                                                                             //
+// This program is free software; you can redistribute it and/or modify        //
+// it under the terms of the GNU General Public License (version 2) as         //
+// published by the Free Software Foundation.                                  //
+//                                                                             //
+// This program is distributed in the hope that it will be useful,             //
+// but WITHOUT ANY WARRANTY; without even the implied warranty of              // 
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU            //
+// General Public License for more details.                                    //
+//                                                                             //
+// You should have received a copy of the GNU General Public License           //
+// along with this program;if not, write to the                                //
+//                                                                             //
+// Free Software Foundation, Inc.,                                             //
+// 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA                       // 
+/////////////////////////////////////////////////////////////////////////////////
+
+static const char DUP_MAGIC[8] = {'P','G','D','U','P','0','1','\0'};
+
+///////////////////////////////////////////////////////////////////////////////
+// DupTable (constructor)                                                    //
+//    desc: an empty table.  load() fills it in for one db file.             //
+///////////////////////////////////////////////////////////////////////////////  
+
+DupTable::DupTable() {
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// load                                                                      //
+//  inputs: pgrep db filename <std::string>                                  //
+//  output: true if the db has a .dup file <bool>                            //
+//    desc: the .dup file is DUP_MAGIC, the number of copies, then for each  //
+//          copy its stored seq and the stored seq it followed (unsigned     //
+//          ints) and its name, padded to MAX_SEQNAME_SIZE as in the db      //
+///////////////////////////////////////////////////////////////////////////////  
+
+bool DupTable::load(std::string filename) {
+  dups.clear();
+  copied.clear();
+  std::string dupFilename = filename + ".dup";
+  std::ifstream dupFile(dupFilename.c_str(), std::ios::in | std::ios::binary);
+  if (!dupFile.is_open()) {
+    return false;
+  }
+  
+  char magic[sizeof(DUP_MAGIC)];
+  dupFile.read(magic, sizeof(DUP_MAGIC));
+  if (!dupFile || memcmp(magic, DUP_MAGIC, sizeof(DUP_MAGIC)) != 0) {
+    std::cerr << "Error: " << dupFilename << " is not a pgrep duplicate table.\n";
+    exit(1);
+  }
+  
+  unsigned int ndups = 0;
+  dupFile.read((char*)&ndups, sizeof(unsigned int));
+  char seqName[MAX_SEQNAME_SIZE];
+  for (unsigned int d=0; d < ndups && dupFile; ++d) {
+    DupSeq dup;
+    dupFile.read((char*)&dup.rep, sizeof(unsigned int));
+    dupFile.read((char*)&dup.after, sizeof(unsigned int));
+    dupFile.read(seqName, MAX_SEQNAME_SIZE);
+    seqName[MAX_SEQNAME_SIZE-1] = '\0';
+    dup.name = seqName;
+    if (dup.rep > dup.after || (!dups.empty() && dup.after < dups.back().after)) {
+      std::cerr << "Error: Bad duplicate table: " << dupFilename << "\n";
+      exit(1);
+    }
+    dups.push_back(dup);
+    if (copied.size() <= dup.rep) {
+      copied.resize(dup.rep + 1, false);
+    }
+    copied[dup.rep] = true;
+  }
+  if (!dupFile) {
+    std::cerr << "Error: Truncated duplicate table: " << dupFilename << "\n";
+    exit(1);
+  }
+  return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// accessors                                                                 //
+///////////////////////////////////////////////////////////////////////////////  
+
+const std::vector<DupSeq> &DupTable::getDups() {
+  return dups;
+}
+
+bool DupTable::hasDups(unsigned int rep) {
+  return rep < copied.size() && copied[rep];
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// firstAfter                                                                //
+//  inputs: stored seq index <uns int>                                       //
+//  output: index of the first copy that followed it (or a later stored      //
+//          seq) in the fasta file, getDups().size() if none <uns int>       //
+///////////////////////////////////////////////////////////////////////////////  
+
+unsigned int DupTable::firstAfter(unsigned int after) {
+  unsigned int lo = 0;
+  unsigned int hi = dups.size();
+  while (lo < hi) {
+    unsigned int mid = (lo + hi)/2;
+    if (dups[mid].after < after) {
+      lo = mid + 1;
+    }
+    else {
+      hi = mid;
+    }
+  }
+  return lo;
+}
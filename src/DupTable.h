@@ -0,0 +1,55 @@
+#ifndef DUPTABLE_H__
+#define DUPTABLE_H__
+
+#include <string>
+#include <vector>
+#include "Properties.h"
+
+/////////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2007 Affymetrix, Inc.                                         //
+//                                                                             //
+// This program is free software; you can redistribute it and/or modify        //
+// it under the terms of the GNU General Public License (version 2) as         //
+// published by the Free Software Foundation.                                  //
+//                                                                             //
+// This program is distributed in the hope that it will be useful,             //
+// but WITHOUT ANY WARRANTY; without even the implied warranty of              // 
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU            //
+// General Public License for more details.                                    //
+//                                                                             //
+// You should have received a copy of the GNU General Public License           //
+// along with this program;if not, write to the                                //
+//                                                                             //
+// Free Software Foundation, Inc.,                                             //
+// 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA                       // 
+/////////////////////////////////////////////////////////////////////////////////
+
+// one sequence left out of a deduplicated pgrep db as a copy of another
+struct DupSeq {
+  std::string name;
+  unsigned int rep;   // index of the stored seq it copies
+  unsigned int after; // index of the stored seq it followed in the fasta file
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// DupTable                                                                  //
+// - The duplicate sequences of a pgrep db built with generatePgrepDB.pl     //
+//   -dedup (.dup file).  Each distinct sequence is stored once; the copies  //
+//   are only named here, in fasta file order, so a search can report their  //
+//   hits without scanning them.                                             //
+///////////////////////////////////////////////////////////////////////////////  
+
+class DupTable {
+  public:
+    DupTable();
+    bool load(std::string filename);
+    const std::vector<DupSeq> &getDups();
+    bool hasDups(unsigned int rep);
+    unsigned int firstAfter(unsigned int after);
+    
+  private:
+    std::vector<DupSeq> dups;     // ordered by after
+    std::vector<bool> copied;     // by stored seq, true if it has copies
+};
+
+#endif // DUPTABLE_H__
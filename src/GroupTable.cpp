@@ -0,0 +1,104 @@
+#include "GroupTable.h"
+#include "RegionList.h"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <stdlib.h>
+
+/////////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2007 Affymetrix, Inc.                                         //
+//                                                                             //
+// This program is free software; you can redistribute it and/or modify        //
+// it under the terms of the GNU General Public License (version 2) as         //
+// published by the Free Software Foundation.                                  //
+//                                                                             //
+// This program is distributed in the hope that it will be useful,             //
+// but WITHOUT ANY WARRANTY; without even the implied warranty of              // 
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU            //
+// General Public License for more details.                                    //
+//                                                                             //
+// You should have received a copy of the GNU General Public License           //
+// along with this program;if not, write to the                                //
+//                                                                             //
+// Free Software Foundation, Inc.,                                             //
+// 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA                       // 
+/////////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+// GroupTable (constructor)                                                  //
+//    desc: an empty table.  load() fills it in.                             //
+///////////////////////////////////////////////////////////////////////////////  
+
+GroupTable::GroupTable() {
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// load                                                                      //
+//  inputs: group file name <std::string>                                    //
+//  output: none                                                             //
+//    desc: a sequence name and a group name on each line.  Blank lines and  //
+//          lines starting with # are ignored.                               //
+///////////////////////////////////////////////////////////////////////////////  
+
+void GroupTable::load(std::string filename) {
+  std::ifstream groupFile(filename.c_str());
+  if (!groupFile.is_open()) {
+    std::cerr << "ERROR:  Could not open sequence group file [" << filename << "].\n";
+    exit(1);
+  }
+  
+  std::map<std::string, int> groupIds;
+  std::string line;
+  while (std::getline(groupFile, line)) {
+    std::istringstream fields(line);
+    std::string seq;
+    std::string group;
+    if (!(fields >> seq) || seq[0] == '#') {
+      continue;
+    }
+    if (!(fields >> group)) {
+      std::cerr << "ERROR:  Bad line in sequence group file [" << filename << "]: " << line << "\n";
+      exit(1);
+    }
+    
+    std::map<std::string, int>::iterator found = groupIds.find(group);
+    int id = (found != groupIds.end()) ? found->second : (int) groupNames.size();
+    if (found == groupIds.end()) {
+      groupIds[group] = id;
+      groupNames.push_back(group);
+    }
+    std::vector<int> &groups = seqGroups[seq];
+    if (std::find(groups.begin(), groups.end(), id) == groups.end()) {
+      groups.push_back(id);
+    }
+  }
+  
+  if (groupNames.empty()) {
+    std::cerr << "ERROR:  No groups in sequence group file [" << filename << "].\n";
+    exit(1);
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// getGroups                                                                 //
+//  inputs: db sequence name <char*>                                         //
+//  output: the groups the seq is in, NULL if none <vector int*>             //
+///////////////////////////////////////////////////////////////////////////////  
+
+const std::vector<int> *GroupTable::getGroups(const char *seqName) {
+  std::map<std::string, std::vector<int> >::iterator found = seqGroups.find(RegionList::firstWord(seqName));
+  return (found != seqGroups.end()) ? &found->second : NULL;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// accessors                                                                 //
+///////////////////////////////////////////////////////////////////////////////  
+
+int GroupTable::getGroupCount() {
+  return groupNames.size();
+}
+
+std::string GroupTable::getGroupName(int group) {
+  return groupNames[group];
+}
@@ -0,0 +1,47 @@
+#ifndef GROUPTABLE_H__
+#define GROUPTABLE_H__
+
+#include <string>
+#include <vector>
+#include <map>
+
+/////////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2007 Affymetrix, Inc.                                         //
+//                                                                             //
+// This program is free software; you can redistribute it and/or modify        //
+// it under the terms of the GNU General Public License (version 2) as         //
+// published by the Free Software Foundation.                                  //
+//                                                                             //
+// This program is distributed in the hope that it will be useful,             //
+// but WITHOUT ANY WARRANTY; without even the implied warranty of              // 
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU            //
+// General Public License for more details.                                    //
+//                                                                             //
+// You should have received a copy of the GNU General Public License           //
+// along with this program;if not, write to the                                //
+//                                                                             //
+// Free Software Foundation, Inc.,                                             //
+// 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA                       // 
+/////////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+// GroupTable                                                                //
+// - Sequence groups for --groups (e.g. the strains an assay must detect     //
+//   and the near neighbours it must not).  A sequence may be in several     //
+//   groups.  Names match the first word of a db sequence name.              //
+///////////////////////////////////////////////////////////////////////////////  
+
+class GroupTable {
+  public:
+    GroupTable();
+    void load(std::string filename);
+    const std::vector<int> *getGroups(const char *seqName);
+    int getGroupCount();
+    std::string getGroupName(int group);
+    
+  private:
+    std::vector<std::string> groupNames;             // in order of first use
+    std::map<std::string, std::vector<int> > seqGroups;
+};
+
+#endif // GROUPTABLE_H__
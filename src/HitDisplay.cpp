@@ -0,0 +1,379 @@
+#include "HitDisplay.h"
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+/////////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2007 Affymetrix, Inc.                                         //
+//                                                                             //
+// This program is free software; you can redistribute it and/or modify        //
+// it under the terms of the GNU General Public License (version 2) as         //
+// published by the Free Software Foundation.                                  //
+//                                                                             //
+// This program is distributed in the hope that it will be useful,             //
+// but WITHOUT ANY WARRANTY; without even the implied warranty of              // 
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU            //
+// General Public License for more details.                                    //
+//                                                                             //
+// You should have received a copy of the GNU General Public License           //
+// along with this program;if not, write to the                                //
+//                                                                             //
+// Free Software Foundation, Inc.,                                             //
+// 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA                       // 
+/////////////////////////////////////////////////////////////////////////////////
+
+// does simple bp by bp comparison and returns " || "
+// style alignment
+
+///////////////////////////////////////////////////////////////////////////////
+// makeAlignment                                                             //
+//  inputs: alignment string <std::string>, primer sequence <std::string>,   //
+//          template seq <std::string>                                       //
+//  output: none                                                             //
+//    desc: accepts a primer and template sequence and produces and alignment//
+//          string by placing an '|' at positions where the two strings agree//
+//          (a degenerate primer base agrees with any base it stands for).   //
+//          The mismatch scores come from the search (see PrimingSite).      //
+/////////////////////////////////////////////////////////////////////////////// 
+
+void makeAlignment(std::string &align, const std::string &seq1, const std::string &seq2) {
+  int seqLen = seq1.length();
+  align = seq1;
+  for (int i=0; i < seqLen; i++) {
+    if (seq1[i] == seq2[i] ||
+        (WeightMatrix::iupac2bits(seq1[i]) & WeightMatrix::iupac2bits(seq2[i]))) {
+      align[i] = '|';
+    }
+    else {
+      align[i] = ' ';
+      
+    }
+  }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// HitText                                                                   //
+// - Reusable text buffer for full output.  Hits are formatted into it       //
+//   without iostreams and written out a block at a time.                    //
+///////////////////////////////////////////////////////////////////////////////  
+
+class HitText {
+  public:
+    HitText() {
+      used = 0;
+    }
+    
+    void put(const char *text, int length) {
+      reserve(length);
+      memcpy(&data[used], text, length);
+      used += length;
+    }
+    
+    void put(const std::string &text) {
+      put(text.data(), text.length());
+    }
+    
+    void put(char c) {
+      reserve(1);
+      data[used++] = c;
+    }
+    
+    void putInt(unsigned int value) {
+      char digits[16];
+      int n = 0;
+      do {
+        digits[n++] = '0' + value % 10;
+        value /= 10;
+      } while (value);
+      reserve(n);
+      while (n) {
+        data[used++] = digits[--n];
+      }
+    }
+    
+    int size() {
+      return used;
+    }
+    
+    std::string since(int mark) {
+      return std::string(&data[mark], used - mark);
+    }
+    
+    void truncate(int length) {
+      used = length;
+    }
+    
+    void write(std::ostream &out) {
+      if (used > 0) {
+        out.write(&data[0], used);
+        used = 0;
+      }
+    }
+    
+  private:
+    void reserve(int length) {
+      if (used + length > (int) data.size()) {
+        data.resize(2*(used + length));
+      }
+    }
+    
+    std::vector<char> data;
+    int used;
+};
+
+static HitText hitText;
+
+///////////////////////////////////////////////////////////////////////////////
+// putHit                                                                    //
+//  inputs: primer pair <PrimerPair*>, priming site <PrimingSite*>,          //
+//          amplicon <std::string>, rev primer not complemented <int>        //
+//  output: none                                                             //
+//    desc: formats one full-output line into hitText.  With no amplicon     //
+//          the alignment, template and amplicon columns are left empty.     //
+/////////////////////////////////////////////////////////////////////////////// 
+
+static void putHit(PrimerPair *pp, PrimingSite *match, const std::string &amp, int noRevC) {
+  hitText.put(pp->getId());
+  hitText.put('\t');
+  hitText.put(match->getSeqName(), strlen(match->getSeqName()));
+  hitText.put('\t');
+  hitText.putInt(match->getForPos());
+  hitText.put('\t');
+  hitText.putInt(match->getRevPos());
+  hitText.put('\t');
+  hitText.putInt(match->getStrand());
+  hitText.put('\t');
+  hitText.putInt(match->getRevPos() - match->getForPos() + 1);
+  hitText.put('\t');
+
+  // primer info
+  std::string forSeq;
+  std::string revSeq;
+  std::string forPrimerSeq;
+  if (match->getForDir() == FOR || match->getStrand()) {
+  	forPrimerSeq = pp->getForPrimer();
+  }
+  else {
+  	forPrimerSeq = pp->getRevPrimer();
+  }
+
+  std::string revPrimerSeq;
+  if (match->getRevDir() == REV || match->getStrand()) {
+      	revPrimerSeq = pp->getRevPrimer();
+  }
+  else {
+      	revPrimerSeq = pp->getForPrimer();
+  }
+
+  int ampLength = amp.length();
+  int forLength = forPrimerSeq.length();
+  int revLength = revPrimerSeq.length();
+  if (ampLength == 0) {
+    // no sequence to show
+  }
+  else if (match->getStrand()) {
+    // reverse strand, so use end of amplicon
+    forSeq.assign(amp,ampLength-forLength,forLength);
+    forSeq = PrimerSearch::reverseComplement(forSeq);      
+    revSeq.assign(amp,0,revLength);
+ 
+    if (noRevC) {
+      revSeq = PrimerSearch::reverseComplement(revSeq);
+    }
+  }
+  else {
+    forSeq.assign(amp,0,forLength);
+    revSeq.assign(amp,ampLength-revLength,revLength);
+    if (!noRevC) {
+      revSeq = PrimerSearch::reverseComplement(revSeq);
+    }
+  }
+  std::string align;
+  hitText.put(forPrimerSeq);
+  hitText.put('\t');
+  if (ampLength > 0) {
+    makeAlignment(align, forPrimerSeq, forSeq);
+  }
+  hitText.put(align);
+  hitText.put('\t');
+  hitText.put(forSeq);
+  hitText.put('\t');
+  hitText.putInt(match->getForScore());
+  hitText.put('\t');
+  
+  hitText.put(revPrimerSeq);
+  hitText.put('\t');
+  if (ampLength > 0) {
+    makeAlignment(align, revPrimerSeq, revSeq);
+  }
+  hitText.put(align);
+  hitText.put('\t');
+  hitText.put(revSeq);
+  hitText.put('\t');
+  hitText.putInt(match->getRevScore());
+  hitText.put('\t');
+  
+  // dump amplicon as well
+  hitText.put(amp);
+  hitText.put('\n');
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// showAmbiguities                                                           //
+//  inputs: decoded bases <std::string>, ambiguous runs <vector BaseRun>,    //
+//          0-based seq position of the first base <uns int>                 //
+//  output: none                                                             //
+//    desc: writes N over the random bases the db holds for ambiguous ones   //
+///////////////////////////////////////////////////////////////////////////////  
+
+void showAmbiguities(std::string &bases, const std::vector<BaseRun> &runs, unsigned int first) {
+  unsigned int last = first + bases.length();
+  std::vector<BaseRun>::const_iterator run = AmbiguityTable::firstRun(runs, first);
+  for (; run != runs.end() && run->start < last; ++run) {
+    unsigned int runEnd = std::min(run->start + run->length, last);
+    for (unsigned int p = std::max(run->start, first); p < runEnd; ++p) {
+      bases[p - first] = 'N';
+    }
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// displayHits                                                               //
+//  inputs: output stream <std::ostream&>,                                   //
+//          primer search <PrimerSearch*>, number of matches found<int>,     //
+//          name of seq being searched <char*>, seq buffer <char*>, start    //
+//          pos in seq <int>, buffer start pos <int>, buffer stop pos <int>, //
+//          flag whether we're at end of seq <int>, best hit list            //
+//          <TopHits*> (may be NULL)                                         //
+//  output: none                                                             //
+//    desc: produces tab-delimited full-output results.  With a best hit     //
+//          list the lines are offered to it, scored by the sum of both      //
+//          primer mismatch scores, instead of being written to out.  Hits   //
+//          that could not make the list are not decoded at all.             //
+/////////////////////////////////////////////////////////////////////////////// 
+  
+void displayHits (std::ostream &out, PrimerSearch *ps, int &disMatchCount, char *seqName, char *buffer, 
+                  unsigned int startPos, int bufferStart, int bufferEnd, int notAtEnd, TopHits *top) {
+  int matchCount = ps->getMatchCount();
+  PrimerPair *pp = ps->getPrimerPair();
+  std::string amp;
+  
+  for (int i = disMatchCount; i < matchCount; i++) {
+    PrimingSite *match = ps->getPrimingSite(i);
+    int score = match->getForScore() + match->getRevScore();
+    if (top != NULL && !top->accepts(score)) {
+      continue;
+    }
+    unsigned int start = match->getForPos();
+    
+    int bStart = int(start - startPos - 1);
+    // todo - put in a real floor function
+    if (bStart < 0) {
+      bStart -= 3;
+    }
+    bStart = int(bStart/4) + bufferStart; 
+    
+    unsigned int end = match->getRevPos();
+    int bEnd = int((int(end - startPos - 1))/4) + bufferStart;
+    
+    if (bEnd >= bufferEnd) {
+      if (notAtEnd) {
+        // too close to edge... skip remaining hits and move on to next
+        // scan
+        disMatchCount = i;
+        hitText.write(out);
+        return;
+      }
+      else {
+        std::cerr << "FATAL ERROR:  Match fell outside of buffer area." << "\n";
+        exit(1);
+      }
+    }
+
+    int mark = hitText.size();
+    int ampStart = ((start-startPos-1) % 4);
+    amp.resize(end-start+1);
+    PrimerSearch::decodeBases(buffer, BUFFERSIZE*2, bStart, ampStart, amp.length(), &amp[0]);
+    if (ps->getAmbiguities() != NULL) {
+      showAmbiguities(amp, *ps->getAmbiguities(), start - 1);
+    }
+    putHit(pp, match, amp, ps->getNoRevC());
+    
+    if (top != NULL) {
+      top->offer(score, hitText.since(mark));
+      hitText.truncate(mark);
+    }
+    else if (hitText.size() >= OUTPUT_BUFFER) {
+      hitText.write(out);
+    }
+  }  
+   
+  // everything displayed
+  hitText.write(out);
+  disMatchCount = matchCount;
+ 
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// displayHeader                                                             //
+//  inputs: output stream <std::ostream&>                                    //
+//  output: none                                                             //
+//    desc: the column names line of full output                             //
+/////////////////////////////////////////////////////////////////////////////// 
+
+void displayHeader(std::ostream &out) {
+  out << "PrimerPairId\tTemplateSequenceName\tMatchStart\tMatchStop\tMatchStrand\tMatchLength\t";
+  out << "ForwardPrimer\tForwardPrimerAlignment\tForwardTemplateSeq\tForwardMismatchScore\t";
+  out << "ReversePrimer\tReversePrimerAlignment\tReverseTemplateSeq\tReverseMismatchScore\t";
+  out << "FullMatchSequence\n";
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// displayHit                                                                //
+//  inputs: output stream <std::ostream&>, primer pair <PrimerPair*>,        //
+//          priming site <PrimingSite*>, amplicon (may be empty)             //
+//          <std::string>, rev primer not complemented <int>                 //
+//  output: none                                                             //
+//    desc: formats one hit as displayHits does, for hits read back from a   //
+//          hit file.  Call flushHits when done.                             //
+/////////////////////////////////////////////////////////////////////////////// 
+
+void displayHit(std::ostream &out, PrimerPair *pp, PrimingSite *match, const std::string &amp, int noRevC) {
+  putHit(pp, match, amp, noRevC);
+  if (hitText.size() >= OUTPUT_BUFFER) {
+    hitText.write(out);
+  }
+}
+
+void flushHits(std::ostream &out) {
+  hitText.write(out);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// writeHits                                                                 //
+//  inputs: hit file <HitFile*>, primer search <PrimerSearch*>, number of    //
+//          matches written <int>, best hit list <TopHits*> (may be NULL)    //
+//  output: none                                                             //
+//    desc: binary counterpart of displayHits.  No sequence is written, so   //
+//          every new hit can go out at once.                                //
+/////////////////////////////////////////////////////////////////////////////// 
+
+void writeHits(HitFile *hitFile, PrimerSearch *ps, int &disMatchCount, TopHits *top) {
+  int matchCount = ps->getMatchCount();
+  for (int i = disMatchCount; i < matchCount; i++) {
+    PrimingSite *match = ps->getPrimingSite(i);
+    int score = match->getForScore() + match->getRevScore();
+    if (top != NULL && !top->accepts(score)) {
+      continue;
+    }
+    HitRecord hit = hitFile->makeRecord(match);
+    if (top != NULL) {
+      top->offer(score, std::string((char*)&hit, sizeof(HitRecord)));
+    }
+    else {
+      hitFile->add(hit);
+    }
+  }
+  disMatchCount = matchCount;
+}
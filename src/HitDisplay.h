@@ -0,0 +1,40 @@
+#ifndef HITDISPLAY_H__
+#define HITDISPLAY_H__
+
+#include <iostream>
+#include <string>
+#include "Properties.h"
+#include "PrimerSearch.h"
+#include "TopHits.h"
+#include "HitFile.h"
+
+/////////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2007 Affymetrix, Inc.                                         //
+//                                                                             //
+// This program is free software; you can redistribute it and/or modify        //
+// it under the terms of the GNU General Public License (version 2) as         //
+// published by the Free Software Foundation.                                  //
+//                                                                             //
+// This program is distributed in the hope that it will be useful,             //
+// but WITHOUT ANY WARRANTY; without even the implied warranty of              // 
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU            //
+// General Public License for more details.                                    //
+//                                                                             //
+// You should have received a copy of the GNU General Public License           //
+// along with this program;if not, write to the                                //
+//                                                                             //
+// Free Software Foundation, Inc.,                                             //
+// 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA                       // 
+/////////////////////////////////////////////////////////////////////////////////
+
+// full output formatting, shared by pgrep, pgrep-view and the benchmarks
+void displayHeader(std::ostream &out);
+void makeAlignment(std::string &align, const std::string &seq1, const std::string &seq2);
+void showAmbiguities(std::string &bases, const std::vector<BaseRun> &runs, unsigned int first);
+void displayHits (std::ostream &out, PrimerSearch *ps, int &disMatchCount, char *seqName, char *buffer, 
+                  unsigned int startPos, int bufferStart, int bufferEnd, int notAtEnd, TopHits *top = NULL);
+void displayHit(std::ostream &out, PrimerPair *pp, PrimingSite *match, const std::string &amp, int noRevC);
+void flushHits(std::ostream &out);
+void writeHits(HitFile *hitFile, PrimerSearch *ps, int &disMatchCount, TopHits *top = NULL);
+
+#endif // HITDISPLAY_H__
@@ -0,0 +1,380 @@
+#include "HitFile.h"
+#include <string.h>
+#include <stdlib.h>
+
+/////////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2007 Affymetrix, Inc.                                         //
+//                                                                             //
+// This program is free software; you can redistribute it and/or modify        //
+// it under the terms of the GNU General Public License (version 2) as         //
+// published by the Free Software Foundation.                                  //
+//                                                                             //
+// This program is distributed in the hope that it will be useful,             //
+// but WITHOUT ANY WARRANTY; without even the implied warranty of              // 
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU            //
+// General Public License for more details.                                    //
+//                                                                             //
+// You should have received a copy of the GNU General Public License           //
+// along with this program;if not, write to the                                //
+//                                                                             //
+// Free Software Foundation, Inc.,                                             //
+// 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA                       // 
+/////////////////////////////////////////////////////////////////////////////////
+
+static const char HIT_MAGIC[8] = {'P','G','H','I','T','0','1','\0'};
+static const int HEADER_SIZE = sizeof(HIT_MAGIC) + 2*sizeof(int);
+static const int TRAILER_SIZE = 4*sizeof(unsigned long long) + sizeof(HIT_MAGIC);
+
+///////////////////////////////////////////////////////////////////////////////
+// HitFile (constructor)                                                     //
+//    desc: use create() to write a hit file, or load() to read one          //
+///////////////////////////////////////////////////////////////////////////////  
+
+HitFile::HitFile() {
+  noRevC = false;
+  showsAmbiguities = false;
+  nRecords = 0;
+  out = NULL;
+  written = 0;
+  curPair = 0;
+  lastSeq = 0;
+  block.count = 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// create                                                                    //
+//  inputs: where to write the hits <std::ostream*>, rev primer not          //
+//          complemented <bool>, ambiguous bases shown as N <bool>           //
+//  output: none                                                             //
+//    desc: hit file format:                                                 //
+//            magic[8], record size, flags (1 noRevC, 2 N shown)  (ints)     //
+//            records <HitRecord>                                            //
+//            npairs <uns int>, per pair: id, for primer, rev primer         //
+//                     (each a length <uns int> then the chars)              //
+//            nseqs <uns int>, per seq: name[MAX_SEQNAME_SIZE]               //
+//            nblocks <uns long long>, region index <HitBlock>               //
+//            trailer: nrecords, pair table, seq table and index offsets     //
+//                     (uns long longs), magic[8]                            //
+///////////////////////////////////////////////////////////////////////////////  
+
+void HitFile::create(std::ostream *cOut, bool cNoRevC, bool cShowsAmbiguities) {
+  out = cOut;
+  noRevC = cNoRevC;
+  showsAmbiguities = cShowsAmbiguities;
+  
+  int recordSize = sizeof(HitRecord);
+  int flag = noRevC | (showsAmbiguities << 1);
+  put(HIT_MAGIC, sizeof(HIT_MAGIC));
+  put((char*)&recordSize, sizeof(int));
+  put((char*)&flag, sizeof(int));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// beginPair                                                                 //
+//  inputs: primer pair about to be searched <PrimerPair*>                   //
+//  output: none                                                             //
+//    desc: adds the pair to the pair table.  Hits made from now on are      //
+//          given to it.                                                     //
+///////////////////////////////////////////////////////////////////////////////  
+
+void HitFile::beginPair(PrimerPair *pp) {
+  pairs.push_back(new PrimerPair(*pp));
+  curPair = pairs.size() - 1;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// makeRecord                                                                //
+//  inputs: priming site of the current pair <PrimingSite*>                  //
+//  output: hit record <HitRecord>                                           //
+//    desc: looks up (or adds) the site's sequence in the sequence table     //
+///////////////////////////////////////////////////////////////////////////////  
+
+HitRecord HitFile::makeRecord(PrimingSite *site) {
+  HitRecord hit;
+  memset(&hit, 0, sizeof(HitRecord));
+  
+  // hits come a sequence at a time, so try the last one first
+  unsigned int seq = lastSeq;
+  if (seq >= seqNames.size() || seqNames[seq] != site->getSeqName()) {
+    std::map<std::string, unsigned int>::iterator it = seqIds.find(site->getSeqName());
+    if (it == seqIds.end()) {
+      seq = seqNames.size();
+      seqIds[site->getSeqName()] = seq;
+      seqNames.push_back(site->getSeqName());
+    }
+    else {
+      seq = it->second;
+    }
+    lastSeq = seq;
+  }
+  
+  hit.pair = curPair;
+  hit.seq = seq;
+  hit.start = site->getForPos();
+  hit.stop = site->getRevPos();
+  hit.forScore = site->getForScore();
+  hit.revScore = site->getRevScore();
+  hit.strand = site->getStrand();
+  hit.forDir = site->getForDir();
+  hit.revDir = site->getRevDir();
+  return hit;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// add                                                                       //
+//  inputs: hit record <HitRecord>                                           //
+//  output: none                                                             //
+//    desc: writes the record and adds it to the region index                //
+///////////////////////////////////////////////////////////////////////////////  
+
+void HitFile::add(const HitRecord &hit) {
+  if (block.count > 0 && (hit.pair != block.pair || hit.seq != block.seq || block.count == HIT_BLOCK)) {
+    closeBlock();
+  }
+  if (block.count == 0) {
+    block.pair = hit.pair;
+    block.seq = hit.seq;
+    block.first = nRecords;
+    block.minStart = hit.start;
+    block.maxStop = hit.stop;
+    block.unused = 0;
+  }
+  if (hit.start < block.minStart) {
+    block.minStart = hit.start;
+  }
+  if (hit.stop > block.maxStop) {
+    block.maxStop = hit.stop;
+  }
+  ++block.count;
+  
+  put((char*)&hit, sizeof(HitRecord));
+  ++nRecords;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// addRecords                                                                //
+//  inputs: records back to back <std::string>                               //
+//  output: none                                                             //
+//    desc: adds records held as text, e.g. by the --best hit list           //
+///////////////////////////////////////////////////////////////////////////////  
+
+void HitFile::addRecords(const std::string &records) {
+  HitRecord hit;
+  for (unsigned int i=0; i + sizeof(HitRecord) <= records.length(); i += sizeof(HitRecord)) {
+    memcpy(&hit, records.data() + i, sizeof(HitRecord));
+    add(hit);
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// closeBlock                                                                //
+//  inputs: none                                                             //
+//  output: none                                                             //
+//    desc: moves the block being filled into the region index               //
+///////////////////////////////////////////////////////////////////////////////  
+
+void HitFile::closeBlock() {
+  if (block.count > 0) {
+    blocks.push_back(block);
+    block.count = 0;
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// finish                                                                    //
+//  inputs: none                                                             //
+//  output: none                                                             //
+//    desc: writes the tables, index and trailer after the last hit          //
+///////////////////////////////////////////////////////////////////////////////  
+
+void HitFile::finish() {
+  closeBlock();
+  
+  unsigned long long pairsOffset = written;
+  unsigned int npairs = pairs.size();
+  put((char*)&npairs, sizeof(unsigned int));
+  for (unsigned int p=0; p < npairs; ++p) {
+    std::string text[3] = {pairs[p]->getId(), pairs[p]->getForPrimer(), pairs[p]->getRevPrimer()};
+    for (int t=0; t < 3; ++t) {
+      unsigned int length = text[t].length();
+      put((char*)&length, sizeof(unsigned int));
+      put(text[t].data(), length);
+    }
+  }
+  
+  unsigned long long seqsOffset = written;
+  unsigned int nseqs = seqNames.size();
+  put((char*)&nseqs, sizeof(unsigned int));
+  for (unsigned int s=0; s < nseqs; ++s) {
+    char seqName[MAX_SEQNAME_SIZE];
+    memset(seqName, 0, MAX_SEQNAME_SIZE);
+    strncpy(seqName, seqNames[s].c_str(), MAX_SEQNAME_SIZE-1);
+    put(seqName, MAX_SEQNAME_SIZE);
+  }
+  
+  unsigned long long indexOffset = written;
+  unsigned long long nblocks = blocks.size();
+  put((char*)&nblocks, sizeof(unsigned long long));
+  if (nblocks > 0) {
+    put((char*)&blocks[0], nblocks*sizeof(HitBlock));
+  }
+  
+  put((char*)&nRecords, sizeof(unsigned long long));
+  put((char*)&pairsOffset, sizeof(unsigned long long));
+  put((char*)&seqsOffset, sizeof(unsigned long long));
+  put((char*)&indexOffset, sizeof(unsigned long long));
+  put(HIT_MAGIC, sizeof(HIT_MAGIC));
+  out->flush();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// put                                                                       //
+//  inputs: bytes to write <char*>, number of bytes <int>                    //
+//  output: none                                                             //
+//    desc: writes to the output stream, keeping count of the file offset    //
+///////////////////////////////////////////////////////////////////////////////  
+
+void HitFile::put(const char *data, int length) {
+  out->write(data, length);
+  written += length;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// load                                                                      //
+//  inputs: hit filename <std::string>                                       //
+//  output: none                                                             //
+//    desc: reads the tables and region index of a hit file.  The records    //
+//          are read a block at a time with readBlock().                     //
+///////////////////////////////////////////////////////////////////////////////  
+
+void HitFile::load(std::string cFilename) {
+  filename = cFilename;
+  hitFile.open(filename.c_str(), std::ios::in | std::ios::binary);
+  if (!hitFile.is_open()) {
+    std::cerr << "Error opening hit file: " << filename << "\n";
+    exit(1);
+  }
+  
+  char magic[sizeof(HIT_MAGIC)];
+  int recordSize = 0;
+  int flag = 0;
+  hitFile.read(magic, sizeof(HIT_MAGIC));
+  hitFile.read((char*)&recordSize, sizeof(int));
+  hitFile.read((char*)&flag, sizeof(int));
+  if (!hitFile || memcmp(magic, HIT_MAGIC, sizeof(HIT_MAGIC)) != 0 || recordSize != sizeof(HitRecord)) {
+    std::cerr << "Error: " << filename << " is not a pgrep hit file.\n";
+    exit(1);
+  }
+  noRevC = flag & 1;
+  showsAmbiguities = (flag & 2) != 0;
+  
+  unsigned long long pairsOffset = 0;
+  unsigned long long seqsOffset = 0;
+  unsigned long long indexOffset = 0;
+  hitFile.seekg(-TRAILER_SIZE, std::ios::end);
+  hitFile.read((char*)&nRecords, sizeof(unsigned long long));
+  hitFile.read((char*)&pairsOffset, sizeof(unsigned long long));
+  hitFile.read((char*)&seqsOffset, sizeof(unsigned long long));
+  hitFile.read((char*)&indexOffset, sizeof(unsigned long long));
+  hitFile.read(magic, sizeof(HIT_MAGIC));
+  if (!hitFile || memcmp(magic, HIT_MAGIC, sizeof(HIT_MAGIC)) != 0) {
+    std::cerr << "Error: Truncated hit file (the search did not finish): " << filename << "\n";
+    exit(1);
+  }
+  
+  hitFile.seekg(pairsOffset, std::ios::beg);
+  unsigned int npairs = 0;
+  hitFile.read((char*)&npairs, sizeof(unsigned int));
+  for (unsigned int p=0; p < npairs && hitFile; ++p) {
+    std::string text[3];
+    for (int t=0; t < 3; ++t) {
+      unsigned int length = 0;
+      hitFile.read((char*)&length, sizeof(unsigned int));
+      text[t].resize(length);
+      if (length > 0) {
+        hitFile.read(&text[t][0], length);
+      }
+    }
+    pairs.push_back(new PrimerPair(text[0], text[1], text[2], 0));
+  }
+  
+  hitFile.seekg(seqsOffset, std::ios::beg);
+  unsigned int nseqs = 0;
+  hitFile.read((char*)&nseqs, sizeof(unsigned int));
+  for (unsigned int s=0; s < nseqs && hitFile; ++s) {
+    char seqName[MAX_SEQNAME_SIZE];
+    hitFile.read(seqName, MAX_SEQNAME_SIZE);
+    seqName[MAX_SEQNAME_SIZE-1] = '\0';
+    seqNames.push_back(seqName);
+  }
+  
+  hitFile.seekg(indexOffset, std::ios::beg);
+  unsigned long long nblocks = 0;
+  hitFile.read((char*)&nblocks, sizeof(unsigned long long));
+  blocks.resize(nblocks);
+  if (nblocks > 0) {
+    hitFile.read((char*)&blocks[0], nblocks*sizeof(HitBlock));
+  }
+  if (!hitFile) {
+    std::cerr << "Error: Truncated hit file: " << filename << "\n";
+    exit(1);
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// readBlock                                                                 //
+//  inputs: region index entry <int>, where to put the hits                  //
+//          <vector HitRecord>                                               //
+//  output: none                                                             //
+//    desc: reads the records of one index block                             //
+///////////////////////////////////////////////////////////////////////////////  
+
+void HitFile::readBlock(int b, std::vector<HitRecord> &hits) {
+  hits.resize(blocks[b].count);
+  hitFile.seekg(HEADER_SIZE + blocks[b].first*sizeof(HitRecord), std::ios::beg);
+  hitFile.read((char*)&hits[0], blocks[b].count*sizeof(HitRecord));
+  if (!hitFile) {
+    std::cerr << "Error: Truncated hit file: " << filename << "\n";
+    exit(1);
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// accessors                                                                 //
+///////////////////////////////////////////////////////////////////////////////  
+
+int HitFile::getBlockCount() {
+  return blocks.size();
+}
+
+HitBlock &HitFile::getBlock(int b) {
+  return blocks[b];
+}
+
+int HitFile::getPairCount() {
+  return pairs.size();
+}
+
+int HitFile::getSeqCount() {
+  return seqNames.size();
+}
+
+PrimerPair *HitFile::getPrimerPair(int pair) {
+  return pairs[pair];
+}
+
+char *HitFile::getSeqName(int seq) {
+  return (char*) seqNames[seq].c_str();
+}
+
+bool HitFile::getNoRevC() {
+  return noRevC;
+}
+
+bool HitFile::getShowsAmbiguities() {
+  return showsAmbiguities;
+}
+
+unsigned long long HitFile::getRecordCount() {
+  return nRecords;
+}
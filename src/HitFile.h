@@ -0,0 +1,115 @@
+#ifndef HITFILE_H__
+#define HITFILE_H__
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <map>
+#include "Properties.h"
+#include "PrimerPair.h"
+#include "PrimingSite.h"
+
+/////////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2007 Affymetrix, Inc.                                         //
+//                                                                             //
+// This program is free software; you can redistribute it and/or modify        //
+// it under the terms of the GNU General Public License (version 2) as         //
+// published by the Free Software Foundation.                                  //
+//                                                                             //
+// This program is distributed in the hope that it will be useful,             //
+// but WITHOUT ANY WARRANTY; without even the implied warranty of              // 
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU            //
+// General Public License for more details.                                    //
+//                                                                             //
+// You should have received a copy of the GNU General Public License           //
+// along with this program;if not, write to the                                //
+//                                                                             //
+// Free Software Foundation, Inc.,                                             //
+// 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA                       // 
+/////////////////////////////////////////////////////////////////////////////////
+
+// one hit, as written to a binary hit file
+struct HitRecord {
+  unsigned int pair;      // index in the pair table
+  unsigned int seq;       // index in the sequence table
+  unsigned int start;     // MatchStart
+  unsigned int stop;      // MatchStop
+  unsigned int forScore;
+  unsigned int revScore;
+  unsigned char strand;
+  unsigned char forDir;
+  unsigned char revDir;
+  unsigned char unused;
+};
+
+// region index entry - a run of at most HIT_BLOCK records of one pair on
+// one sequence, with the span they cover
+struct HitBlock {
+  unsigned int pair;
+  unsigned int seq;
+  unsigned long long first; // record number of the first hit
+  unsigned int count;
+  unsigned int minStart;
+  unsigned int maxStop;
+  unsigned int unused;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// HitFile                                                                   //
+// - Binary full output (--format=bin).  Hits are streamed as fixed-width    //
+//   records, then the pair and sequence tables, the region index and a      //
+//   trailer locating them are written at the end, so the file can go to a   //
+//   pipe.  pgrep-view reads it back with load().                            //
+///////////////////////////////////////////////////////////////////////////////  
+
+class HitFile {
+  public:
+    HitFile();
+
+    // writing
+    void create(std::ostream *cOut, bool cNoRevC, bool cShowsAmbiguities);
+    void beginPair(PrimerPair *pp);
+    HitRecord makeRecord(PrimingSite *site);
+    void add(const HitRecord &hit);
+    void addRecords(const std::string &records);
+    void finish();
+
+    // reading
+    void load(std::string filename);
+    void readBlock(int block, std::vector<HitRecord> &hits);
+    int getBlockCount();
+    HitBlock &getBlock(int block);
+    int getPairCount();
+    int getSeqCount();
+    PrimerPair *getPrimerPair(int pair);
+    char *getSeqName(int seq);
+    bool getNoRevC();
+    bool getShowsAmbiguities();
+    unsigned long long getRecordCount();
+
+  private:
+    void put(const char *data, int length);
+    void closeBlock();
+
+    bool noRevC;
+    bool showsAmbiguities; // ambiguous bases were shown as N (not --ambig=off)
+    unsigned long long nRecords;
+    std::vector<PrimerPair*> pairs;
+    std::vector<std::string> seqNames;
+    std::vector<HitBlock> blocks;
+
+    // writing
+    std::ostream *out;
+    unsigned long long written; // bytes, since out may not be seekable
+    unsigned int curPair;
+    std::map<std::string, unsigned int> seqIds;
+    unsigned int lastSeq; // sequence of the last record made
+    HitBlock block; // block being filled
+
+    // reading
+    std::string filename;
+    std::ifstream hitFile;
+};
+
+#endif // HITFILE_H__
@@ -0,0 +1,431 @@
+#include "MappabilityTrack.h"
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+#include <string.h>
+#include <stdlib.h>
+
+/////////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2007 Affymetrix, Inc.                                         //
+//                                                                             //
+// This program is free software; you can redistribute it and/or modify        //
+// it under the terms of the GNU General Public License (version 2) as         //
+// published by the Free Software Foundation.                                  //
+//                                                                             //
+// This program is distributed in the hope that it will be useful,             //
+// but WITHOUT ANY WARRANTY; without even the implied warranty of              // 
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU            //
+// General Public License for more details.                                    //
+//                                                                             //
+// You should have received a copy of the GNU General Public License           //
+// along with this program;if not, write to the                                //
+//                                                                             //
+// Free Software Foundation, Inc.,                                             //
+// 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA                       // 
+/////////////////////////////////////////////////////////////////////////////////
+
+static const char MAP_MAGIC[8] = {'P','G','M','A','P','0','2','\0'};
+static const unsigned long long LOW_WORD = 0xFFFFFFFFLLU;
+
+///////////////////////////////////////////////////////////////////////////////
+// MappabilityTrack (constructors)                                           //
+//  inputs: oligo length <int>, max mismatches <int>                         //
+//    desc: a track for oligos of one length and one mismatch level.  Use    //
+//          the default constructor and load() for an existing track file.   //
+///////////////////////////////////////////////////////////////////////////////  
+
+MappabilityTrack::MappabilityTrack() {
+  oligoLength = 0;
+  maxMismatches = 0;
+}
+
+MappabilityTrack::MappabilityTrack(int cOligoLength, int cMaxMismatches) {
+  if (cOligoLength < MIN_OLIGO || cOligoLength > MAX_OLIGO) {
+    std::cerr << "ERROR:  Mappability oligo length must be between " << MIN_OLIGO << " and " << MAX_OLIGO << ".\n";
+    exit(1);
+  }
+  oligoLength = cOligoLength;
+  maxMismatches = cMaxMismatches;
+  halfLength[0] = oligoLength / 2;
+  halfLength[1] = oligoLength - halfLength[0];
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// accessors                                                                 //
+///////////////////////////////////////////////////////////////////////////////  
+
+int MappabilityTrack::getOligoLength() {
+  return oligoLength;
+}
+
+int MappabilityTrack::getMaxMismatches() {
+  return maxMismatches;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// codeMask                                                                  //
+//  inputs: none                                                             //
+//  output: mask covering the 2-bit codes of one oligo <uns long long>       //
+///////////////////////////////////////////////////////////////////////////////  
+
+unsigned long long MappabilityTrack::codeMask() {
+  return (1LLU << (2*oligoLength)) - 1;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// reverseComplement                                                         //
+//  inputs: 2-bit encoded oligo <uns long long>                              //
+//  output: 2-bit encoded reverse complement <uns long long>                 //
+///////////////////////////////////////////////////////////////////////////////  
+
+unsigned long long MappabilityTrack::reverseComplement(unsigned long long code) {
+  unsigned long long rc = 0;
+  for (int i=0; i < oligoLength; ++i) {
+    rc = (rc << 2) | (3 - (code & 3));
+    code >>= 2;
+  }
+  return rc;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// hamming                                                                   //
+//  inputs: two 2-bit encoded oligos <uns long long>, bases to compare <int> //
+//  output: number of mismatched bases <int>                                 //
+///////////////////////////////////////////////////////////////////////////////  
+
+inline int MappabilityTrack::hamming(unsigned long long code1, unsigned long long code2, int nbases) {
+  unsigned long long diff = code1 ^ code2;
+  diff = (diff | (diff >> 1)) & 0x5555555555555555LLU & ((1LLU << (2*nbases)) - 1);
+  return __builtin_popcountll(diff);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// build                                                                     //
+//  inputs: sequence dbs <vector SequenceDb*>                                //
+//  output: none                                                             //
+//    desc: computes the track.  The db is indexed CHUNK_BASES positions at  //
+//          a time (about 40 bytes per base), and after each chunk every     //
+//          oligo of the db adds the sites that chunk holds to its count.    //
+//          Only the 2-bit counts span the whole db, so genomes of any size  //
+//          are built in one track.                                          //
+///////////////////////////////////////////////////////////////////////////////  
+
+void MappabilityTrack::build(std::vector<SequenceDb*> &dbs) {
+  
+  // lay the seqs end to end
+  unsigned long long total = 0;
+  for (unsigned int d=0; d < dbs.size(); ++d) {
+    for (int s=0; s < dbs[d]->getSeqCount(); ++s) {
+      seqDbs.push_back(dbs[d]);
+      seqIndex.push_back(s);
+      seqStarts.push_back(total);
+      total += (unsigned long long) dbs[d]->getSeqSize(s) * 4;
+    }
+  }
+  counts.assign((total+3)/4, 0);
+  
+  for (unsigned long long chunkStart=0; chunkStart < total; chunkStart += CHUNK_BASES) {
+    unsigned long long chunkEnd = std::min(total, chunkStart + CHUNK_BASES);
+    indexChunk(chunkStart, chunkEnd);
+    countChunk(chunkEnd == total);
+  }
+  std::sort(repeats.begin(), repeats.end());
+  repeats.erase(std::unique(repeats.begin(), repeats.end()), repeats.end());
+  
+  // the index and counts are only needed while building
+  for (int half=0; half < 2; ++half) {
+    halfIndex[half].clear();
+    halfCodes[half].clear();
+    bucketStart[half].clear();
+  }
+  counts.clear();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// readSeq                                                                   //
+//  inputs: seq number across the dbs <int>, buffer <vector char>            //
+//  output: number of bases <uns long long>                                  //
+///////////////////////////////////////////////////////////////////////////////  
+
+unsigned long long MappabilityTrack::readSeq(int t, std::vector<char> &buffer) {
+  unsigned int nbytes = seqDbs[t]->getSeqSize(seqIndex[t]);
+  buffer.resize(nbytes + 1);
+  seqDbs[t]->readSeq(seqIndex[t], 0, nbytes, &buffer[0]);
+  return (unsigned long long) nbytes * 4;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// indexChunk                                                                //
+//  inputs: first and last+1 positions of the chunk <uns long long>          //
+//  output: none                                                             //
+//    desc: indexes every position of the chunk by both halves of its        //
+//          oligo.  Any two oligos within k mismatches share one half with   //
+//          k/2 or fewer mismatches, so each query only visits the           //
+//          half-neighbourhoods of the oligo and its reverse complement.     //
+///////////////////////////////////////////////////////////////////////////////  
+
+void MappabilityTrack::indexChunk(unsigned long long chunkStart, unsigned long long chunkEnd) {
+  unsigned long long mask = codeMask();
+  
+  // record the oligo at every position of the chunk
+  codes.assign(chunkEnd - chunkStart, 0);
+  valid.assign(chunkEnd - chunkStart, 0);
+  std::vector<char> buffer;
+  for (unsigned int t=0; t < seqStarts.size(); ++t) {
+    unsigned long long seqStart = seqStarts[t];
+    unsigned long long seqEnd = seqStart + 4LLU*seqDbs[t]->getSeqSize(seqIndex[t]);
+    if (seqEnd <= chunkStart || seqStart >= chunkEnd) {
+      continue;
+    }
+    unsigned long long nbases = readSeq(t, buffer);
+    unsigned long long code = 0;
+    for (unsigned long long b=0; b < nbases; ++b) {
+      unsigned int base = (((unsigned char) buffer[b/4]) >> (6 - 2*(b%4))) & 3;
+      code = ((code << 2) | base) & mask;
+      unsigned long long p = seqStart + b + 1 - oligoLength;
+      if (b + 1 >= (unsigned long long) oligoLength && p >= chunkStart && p < chunkEnd) {
+        codes[p - chunkStart] = code;
+        valid[p - chunkStart] = 1;
+      }
+    }
+  }
+  
+  for (int half=0; half < 2; ++half) {
+    halfIndex[half].clear();
+    for (unsigned long long p=0; p < codes.size(); ++p) {
+      if (valid[p]) {
+        unsigned long long key = (half == 0) ? (codes[p] >> (2*halfLength[1])) :
+                                               (codes[p] & ((1LLU << (2*halfLength[1])) - 1));
+        halfIndex[half].push_back((key << 32) | p);
+      }
+    }
+    std::sort(halfIndex[half].begin(), halfIndex[half].end());
+    
+    // keep the oligos in index order so bucket scans stay sequential
+    halfCodes[half].resize(halfIndex[half].size());
+    for (unsigned long long i=0; i < halfIndex[half].size(); ++i) {
+      halfCodes[half][i] = codes[halfIndex[half][i] & LOW_WORD];
+    }
+    
+    // jump table over the leading bases of the key
+    bucketBases[half] = (halfLength[half] < BUCKET_BASES) ? halfLength[half] : BUCKET_BASES;
+    int shift = 32 + 2*(halfLength[half] - bucketBases[half]);
+    unsigned long long nbuckets = 1LLU << (2*bucketBases[half]);
+    bucketStart[half].resize(nbuckets + 1);
+    unsigned long long i = 0;
+    for (unsigned long long b=0; b <= nbuckets; ++b) {
+      while (i < halfIndex[half].size() && (halfIndex[half][i] >> shift) < b) {
+        ++i;
+      }
+      bucketStart[half][b] = i;
+    }
+  }
+  codes.clear();
+  valid.clear();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// countChunk                                                                //
+//  inputs: last chunk <bool>                                                //
+//  output: none                                                             //
+//    desc: adds the sites of the indexed chunk to the count of every oligo  //
+//          of the db, on both strands.  After the last chunk the oligos     //
+//          that are not unique go into the repeats table.                   //
+///////////////////////////////////////////////////////////////////////////////  
+
+void MappabilityTrack::countChunk(bool last) {
+  unsigned long long mask = codeMask();
+  std::vector<char> buffer;
+  for (unsigned int t=0; t < seqStarts.size(); ++t) {
+    unsigned long long nbases = readSeq(t, buffer);
+    unsigned long long code = 0;
+    for (unsigned long long b=0; b < nbases; ++b) {
+      unsigned int base = (((unsigned char) buffer[b/4]) >> (6 - 2*(b%4))) & 3;
+      code = ((code << 2) | base) & mask;
+      if (b + 1 < (unsigned long long) oligoLength) {
+        continue;
+      }
+      
+      unsigned long long p = seqStarts[t] + b + 1 - oligoLength;
+      int shift = 6 - 2*(p%4);
+      int count = (counts[p/4] >> shift) & 3;
+      unsigned long long rc = reverseComplement(code);
+      if (count < MAP_CAP) {
+        count += countNeighbours(code, MAP_CAP - count);
+        if (count < MAP_CAP && rc != code) {
+          count += countNeighbours(rc, MAP_CAP - count);
+        }
+        count = (count > MAP_CAP) ? MAP_CAP : count;
+        counts[p/4] = (counts[p/4] & ~(3 << shift)) | (count << shift);
+      }
+      
+      if (last && count > 1) {
+        unsigned long long canon = (rc < code) ? rc : code;
+        repeats.push_back((canon << 2) | count);
+      }
+    }
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// countNeighbours                                                           //
+//  inputs: 2-bit encoded oligo <uns long long>, cap <int>                  //
+//  output: sites within k mismatches of the oligo, up to cap <int>          //
+//    desc: a site is counted from the 5' half when that half has k/2 or     //
+//          fewer mismatches, otherwise from the 3' half, so no site is      //
+//          counted twice                                                    //
+///////////////////////////////////////////////////////////////////////////////  
+
+int MappabilityTrack::countNeighbours(unsigned long long code, int cap) {
+  int count = 0;
+  for (int half=0; half < 2 && count < cap; ++half) {
+    unsigned long long key = (half == 0) ? (code >> (2*halfLength[1])) :
+                                           (code & ((1LLU << (2*halfLength[1])) - 1));
+    countVariants(code, half, key, 0, maxMismatches/2, count, cap);
+  }
+  return count;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// countVariants                                                             //
+//  inputs: oligo <uns long long>, half <int>, half key <uns long long>,     //
+//          first base that may change <int>, substitutions left <int>,      //
+//          running count <int&>, cap <int>                                  //
+//  output: none                                                             //
+//    desc: visits every variant of one half with up to k/2 substitutions    //
+//          and counts the indexed sites that carry it                       //
+///////////////////////////////////////////////////////////////////////////////  
+
+void MappabilityTrack::countVariants(unsigned long long code, int half, unsigned long long key,
+                                     int pos, int subsLeft, int &count, int cap) {
+  unsigned long long bucket = key >> (2*(halfLength[half] - bucketBases[half]));
+  std::vector<unsigned long long>::iterator first = halfIndex[half].begin() + bucketStart[half][bucket];
+  std::vector<unsigned long long>::iterator last = halfIndex[half].begin() + bucketStart[half][bucket+1];
+  std::vector<unsigned long long>::iterator it = std::lower_bound(first, last, key << 32);
+  for (; it != last && ((*it) >> 32) == key && count < cap; ++it) {
+    unsigned long long site = halfCodes[half][it - halfIndex[half].begin()];
+    if (hamming(site, code, oligoLength) > maxMismatches) {
+      continue;
+    }
+    if (half == 1 && hamming(site >> (2*halfLength[1]), code >> (2*halfLength[1]), halfLength[0]) <= maxMismatches/2) {
+      continue; // already counted from the 5' half
+    }
+    ++count;
+  }
+  
+  if (subsLeft == 0) {
+    return;
+  }
+  for (int i=pos; i < halfLength[half] && count < cap; ++i) {
+    for (unsigned long long alt=1; alt < 4; ++alt) {
+      countVariants(code, half, key ^ (alt << (2*i)), i+1, subsLeft-1, count, cap);
+    }
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// write                                                                     //
+//  inputs: track filename <std::string>                                     //
+//  output: none                                                             //
+//    desc: track file format:                                               //
+//            magic[8], oligo length, max mismatches, cap  (ints)            //
+//            nrepeats <uns long long>, repeats table                        //
+//          Only the oligos that are not unique are kept, which is all that  //
+//          lookup() needs; the per-position counts are not written.         //
+///////////////////////////////////////////////////////////////////////////////  
+
+void MappabilityTrack::write(std::string filename) {
+  std::ofstream trackFile(filename.c_str(), std::ios::out | std::ios::binary);
+  if (!trackFile.is_open()) {
+    std::cerr << "Error opening mappability track file for writing: " << filename << "\n";
+    exit(1);
+  }
+  
+  int cap = MAP_CAP;
+  trackFile.write(MAP_MAGIC, sizeof(MAP_MAGIC));
+  trackFile.write((char*)&oligoLength, sizeof(int));
+  trackFile.write((char*)&maxMismatches, sizeof(int));
+  trackFile.write((char*)&cap, sizeof(int));
+  
+  unsigned long long nrepeats = repeats.size();
+  trackFile.write((char*)&nrepeats, sizeof(unsigned long long));
+  if (nrepeats > 0) {
+    trackFile.write((char*)&repeats[0], nrepeats*sizeof(unsigned long long));
+  }
+  trackFile.close();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// load                                                                      //
+//  inputs: track filename <std::string>                                     //
+//  output: none                                                             //
+//    desc: reads the header and repeats table of a track file               //
+///////////////////////////////////////////////////////////////////////////////  
+
+void MappabilityTrack::load(std::string filename) {
+  std::ifstream trackFile(filename.c_str(), std::ios::in | std::ios::binary);
+  if (!trackFile.is_open()) {
+    std::cerr << "Error opening mappability track file: " << filename << "\n";
+    exit(1);
+  }
+  
+  char magic[sizeof(MAP_MAGIC)];
+  int cap;
+  trackFile.read(magic, sizeof(MAP_MAGIC));
+  if (!trackFile || memcmp(magic, MAP_MAGIC, sizeof(MAP_MAGIC)) != 0) {
+    std::cerr << "Error: " << filename << " is not a pgrep mappability track (rebuild older tracks with pgrep-map).\n";
+    exit(1);
+  }
+  trackFile.read((char*)&oligoLength, sizeof(int));
+  trackFile.read((char*)&maxMismatches, sizeof(int));
+  trackFile.read((char*)&cap, sizeof(int));
+  halfLength[0] = oligoLength / 2;
+  halfLength[1] = oligoLength - halfLength[0];
+  
+  unsigned long long nrepeats = 0;
+  trackFile.read((char*)&nrepeats, sizeof(unsigned long long));
+  repeats.resize(nrepeats);
+  if (nrepeats > 0) {
+    trackFile.read((char*)&repeats[0], nrepeats*sizeof(unsigned long long));
+  }
+  if (!trackFile) {
+    std::cerr << "Error: Truncated mappability track file: " << filename << "\n";
+    exit(1);
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// lookup                                                                    //
+//  inputs: oligo sequence <std::string>                                     //
+//  output: saturated site count <int>                                       //
+//    desc: returns the track count of an oligo that occurs in the db.       //
+//          0 means the oligo is not repeated, or not in the db at all, so   //
+//          only counts > 1 should be used to reject anything.               //
+///////////////////////////////////////////////////////////////////////////////  
+
+int MappabilityTrack::lookup(std::string oligo) {
+  if ((int) oligo.length() != oligoLength) {
+    return 0;
+  }
+  
+  unsigned long long code = 0;
+  for (int i=0; i < oligoLength; ++i) {
+    code <<= 2;
+    switch (oligo[i]) {
+      case 'A': break;
+      case 'C': code |= 1; break;
+      case 'G': code |= 2; break;
+      case 'T': code |= 3; break;
+      default: return 0;
+    }
+  }
+  unsigned long long rc = reverseComplement(code);
+  unsigned long long canon = (rc < code) ? rc : code;
+  
+  std::vector<unsigned long long>::iterator it =
+    std::lower_bound(repeats.begin(), repeats.end(), canon << 2);
+  if (it != repeats.end() && ((*it) >> 2) == canon) {
+    return (*it) & 3;
+  }
+  return 0;
+}
@@ -0,0 +1,85 @@
+#ifndef MAPPABILITYTRACK_H__
+#define MAPPABILITYTRACK_H__
+
+#include <string>
+#include <vector>
+#include "Properties.h"
+#include "SequenceDb.h"
+
+/////////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2007 Affymetrix, Inc.                                         //
+//                                                                             //
+// This program is free software; you can redistribute it and/or modify        //
+// it under the terms of the GNU General Public License (version 2) as         //
+// published by the Free Software Foundation.                                  //
+//                                                                             //
+// This program is distributed in the hope that it will be useful,             //
+// but WITHOUT ANY WARRANTY; without even the implied warranty of              // 
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU            //
+// General Public License for more details.                                    //
+//                                                                             //
+// You should have received a copy of the GNU General Public License           //
+// along with this program;if not, write to the                                //
+//                                                                             //
+// Free Software Foundation, Inc.,                                             //
+// 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA                       // 
+/////////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+// MappabilityTrack                                                          //
+// - For every L-mer of a sequence db, the number of sites (either strand)   //
+//   matching it with k or fewer mismatches, saturated at MAP_CAP.  The      //
+//   L-mers that are not unique are kept in a sorted table so that primers   //
+//   can be looked up without knowing where they sit in the genome.          //
+///////////////////////////////////////////////////////////////////////////////  
+
+class MappabilityTrack {
+  public:
+    MappabilityTrack();
+    MappabilityTrack(int cOligoLength, int cMaxMismatches);
+    void build(std::vector<SequenceDb*> &dbs);
+    void write(std::string filename);
+    void load(std::string filename);
+    int lookup(std::string oligo);
+    int getOligoLength();
+    int getMaxMismatches();
+    
+    static const int MAP_CAP = 3; // counts saturate here (2 bits)
+    static const int MIN_OLIGO = 8;
+    static const int MAX_OLIGO = 30; // codes must leave 2 bits free for the count
+    static const int MAX_MISMATCHES = 4; // neighbourhoods grow quickly past this
+    static const int BUCKET_BASES = 10; // jump table size is 4^BUCKET_BASES
+    static const unsigned long long CHUNK_BASES = 1LLU << 28; // positions indexed at once while building
+    
+  private:
+    unsigned long long codeMask();
+    unsigned long long reverseComplement(unsigned long long code);
+    unsigned long long readSeq(int t, std::vector<char> &buffer);
+    void indexChunk(unsigned long long chunkStart, unsigned long long chunkEnd);
+    void countChunk(bool last);
+    int hamming(unsigned long long code1, unsigned long long code2, int nbases);
+    int countNeighbours(unsigned long long code, int cap);
+    void countVariants(unsigned long long code, int half, unsigned long long key,
+                       int pos, int subsLeft, int &count, int cap);
+    
+    int oligoLength;
+    int maxMismatches;
+    int halfLength[2];  // bases in the 5' and 3' halves of the oligo
+    
+    // build state
+    std::vector<SequenceDb*> seqDbs;               // db of each seq
+    std::vector<int> seqIndex;                     // its number in that db
+    std::vector<unsigned long long> seqStarts;     // first position of each seq
+    std::vector<unsigned long long> codes;         // L-mer at each chunk position
+    std::vector<unsigned char> valid;              // L-mer fits in seq
+    std::vector<unsigned long long> halfIndex[2];  // (half key << 32) | position
+    std::vector<unsigned long long> halfCodes[2];  // oligo of each index entry
+    std::vector<unsigned long long> bucketStart[2]; // index of first key per bucket
+    int bucketBases[2];                             // leading key bases per bucket
+    std::vector<unsigned char> counts;              // per db position, 4 per byte
+    
+    // repeats table - (canonical code << 2) | count, sorted
+    std::vector<unsigned long long> repeats;
+};
+
+#endif // MAPPABILITYTRACK_H__
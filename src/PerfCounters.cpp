@@ -0,0 +1,210 @@
+#include "PerfCounters.h"
+#include <iostream>
+#include <iomanip>
+#include <string.h>
+#include <errno.h>
+#ifdef __linux__
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+/////////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2007 Affymetrix, Inc.                                         //
+//                                                                             //
+// This program is free software; you can redistribute it and/or modify        //
+// it under the terms of the GNU General Public License (version 2) as         //
+// published by the Free Software Foundation.                                  //
+//                                                                             //
+// This program is distributed in the hope that it will be useful,             //
+// but WITHOUT ANY WARRANTY; without even the implied warranty of              // 
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU            //
+// General Public License for more details.                                    //
+//                                                                             //
+// You should have received a copy of the GNU General Public License           //
+// along with this program;if not, write to the                                //
+//                                                                             //
+// Free Software Foundation, Inc.,                                             //
+// 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA                       // 
+/////////////////////////////////////////////////////////////////////////////////
+
+PerfCounters *PerfCounters::active = NULL;
+
+static const char *EVENT_NAMES[NPERF] = {"cycles", "instructions", "branches", "branch-misses",
+                                         "L1d-misses", "LLC-misses"};
+
+///////////////////////////////////////////////////////////////////////////////
+// PerfCounters (constructor)                                                //
+///////////////////////////////////////////////////////////////////////////////  
+
+PerfCounters::PerfCounters() {
+  nOpen = 0;
+  for (int e=0; e < NPERF; ++e) {
+    fds[e] = -1;
+  }
+  for (int s=0; s < NPERF_SLOTS; ++s) {
+    calls[s] = 0;
+    bytes[s] = 0;
+    for (int e=0; e < NPERF; ++e) {
+      counts[s][e] = 0;
+    }
+  }
+}
+
+PerfCounters::~PerfCounters() {
+#ifdef __linux__
+  for (int e=0; e < NPERF; ++e) {
+    if (fds[e] >= 0) {
+      close(fds[e]);
+    }
+  }
+#endif
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// open                                                                      //
+//  inputs: reason for failure <std::string&>                                //
+//  output: true if at least the cycle counter could be opened <bool>        //
+//    desc: opens user space counters for this process.  There is no         //
+//          generic L2 event, so only L1d and last level misses count.       //
+///////////////////////////////////////////////////////////////////////////////  
+
+bool PerfCounters::open(std::string &reason) {
+#ifdef __linux__
+  for (int e=0; e < NPERF; ++e) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.type = PERF_TYPE_HARDWARE;
+    switch (e) {
+      case PERF_CYCLES:        attr.config = PERF_COUNT_HW_CPU_CYCLES; break;
+      case PERF_INSTRUCTIONS:  attr.config = PERF_COUNT_HW_INSTRUCTIONS; break;
+      case PERF_BRANCHES:      attr.config = PERF_COUNT_HW_BRANCH_INSTRUCTIONS; break;
+      case PERF_BRANCH_MISSES: attr.config = PERF_COUNT_HW_BRANCH_MISSES; break;
+      case PERF_L1D_MISSES:
+        attr.type = PERF_TYPE_HW_CACHE;
+        attr.config = PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                      (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        break;
+      case PERF_LLC_MISSES:
+        attr.type = PERF_TYPE_HW_CACHE;
+        attr.config = PERF_COUNT_HW_CACHE_LL | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                      (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        break;
+    }
+    fds[e] = syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+    if (fds[e] < 0) {
+      if (e == PERF_CYCLES) {
+        reason = strerror(errno);
+        return false;
+      }
+      continue;
+    }
+    ++nOpen;
+  }
+  return true;
+#else
+  reason = "not supported on this platform";
+  return false;
+#endif
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// read                                                                      //
+//  inputs: counter values <unsigned long long[NPERF]>                       //
+//  output: none                                                             //
+//    desc: current counts, 0 for counters that are not open                 //
+///////////////////////////////////////////////////////////////////////////////  
+
+void PerfCounters::read(unsigned long long values[NPERF]) {
+  for (int e=0; e < NPERF; ++e) {
+    values[e] = 0;
+#ifdef __linux__
+    if (fds[e] >= 0 && ::read(fds[e], &values[e], sizeof(values[e])) != sizeof(values[e])) {
+      values[e] = 0;
+    }
+#endif
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// add                                                                       //
+//  inputs: kernel slot <int>, counts at start of call                       //
+//          <unsigned long long[NPERF]>, packed bytes scanned <ull>          //
+//  output: none                                                             //
+//    desc: charges the counts since before to the slot.  Kernel slots       //
+//          include the revMatch and addPrimingSite calls they make.         //
+///////////////////////////////////////////////////////////////////////////////  
+
+void PerfCounters::add(int slot, unsigned long long before[NPERF], unsigned long long nbytes) {
+  unsigned long long after[NPERF];
+  read(after);
+  for (int e=0; e < NPERF; ++e) {
+    counts[slot][e] += after[e] - before[e];
+  }
+  bytes[slot] += nbytes;
+  ++calls[slot];
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// report                                                                    //
+//  inputs: none                                                             //
+//  output: none                                                             //
+//    desc: writes IPC, branch miss rate, cache misses and cycles per        //
+//          packed byte for each kernel used to STDERR                       //
+///////////////////////////////////////////////////////////////////////////////  
+
+void PerfCounters::report() {
+  std::ostream &out = std::cerr;
+  out << std::fixed << std::setprecision(3);
+  out << "PGREP hardware counters (user space)\n";
+  out << "  kernel\tcalls\tcycles/byte\tIPC\tbranch-miss%\tL1d-miss/KB\tLLC-miss/KB\n";
+  for (int s=0; s < NPERF_SLOTS; ++s) {
+    if (calls[s] == 0) {
+      continue;
+    }
+    unsigned long long *c = counts[s];
+    double kb = bytes[s] / 1024.0;
+    out << "  " << ((s == PERF_SITES) ? "addPrimingSite" : RunStats::kernelName(s)) << "\t" << calls[s] << "\t";
+    if (bytes[s] > 0) {
+      out << double(c[PERF_CYCLES]) / bytes[s];
+    }
+    else {
+      out << double(c[PERF_CYCLES]) / calls[s] << " per call";
+    }
+    out << "\t";
+    if (c[PERF_CYCLES] > 0 && fds[PERF_INSTRUCTIONS] >= 0) {
+      out << double(c[PERF_INSTRUCTIONS]) / c[PERF_CYCLES];
+    }
+    else {
+      out << "n/a";
+    }
+    out << "\t";
+    if (c[PERF_BRANCHES] > 0 && fds[PERF_BRANCH_MISSES] >= 0) {
+      out << 100.0 * c[PERF_BRANCH_MISSES] / c[PERF_BRANCHES];
+    }
+    else {
+      out << "n/a";
+    }
+    for (int e=PERF_L1D_MISSES; e <= PERF_LLC_MISSES; ++e) {
+      out << "\t";
+      if (fds[e] >= 0 && kb > 0) {
+        out << c[e] / kb;
+      }
+      else {
+        out << "n/a";
+      }
+    }
+    out << "\n";
+  }
+  out << "  counters open:";
+  for (int e=0; e < NPERF; ++e) {
+    if (fds[e] >= 0) {
+      out << " " << EVENT_NAMES[e];
+    }
+  }
+  out << "\n";
+}
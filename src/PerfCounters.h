@@ -0,0 +1,58 @@
+#ifndef PERFCOUNTERS_H__
+#define PERFCOUNTERS_H__
+
+#include <string>
+#include "RunStats.h"
+
+/////////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2007 Affymetrix, Inc.                                         //
+//                                                                             //
+// This program is free software; you can redistribute it and/or modify        //
+// it under the terms of the GNU General Public License (version 2) as         //
+// published by the Free Software Foundation.                                  //
+//                                                                             //
+// This program is distributed in the hope that it will be useful,             //
+// but WITHOUT ANY WARRANTY; without even the implied warranty of              // 
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU            //
+// General Public License for more details.                                    //
+//                                                                             //
+// You should have received a copy of the GNU General Public License           //
+// along with this program;if not, write to the                                //
+//                                                                             //
+// Free Software Foundation, Inc.,                                             //
+// 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA                       // 
+/////////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+// PerfCounters                                                              //
+// - Hardware performance counters (Linux perf_event_open) read around       //
+//   each search kernel call.  Counters that cannot be opened are            //
+//   reported as n/a; if none open the run goes on without them.             //
+///////////////////////////////////////////////////////////////////////////////  
+
+enum PerfEvent {PERF_CYCLES, PERF_INSTRUCTIONS, PERF_BRANCHES, PERF_BRANCH_MISSES, PERF_L1D_MISSES,
+                PERF_LLC_MISSES};
+const int NPERF = 6;
+const int PERF_SITES = NKERNELS; // slot for addPrimingSite bookkeeping
+const int NPERF_SLOTS = NKERNELS + 1;
+
+class PerfCounters {
+  public:
+    PerfCounters();
+    ~PerfCounters();
+    bool open(std::string &reason);
+    void read(unsigned long long values[NPERF]);
+    void add(int slot, unsigned long long before[NPERF], unsigned long long bytes);
+    void report();
+    
+    static PerfCounters *active; // set by --perf, NULL otherwise
+    
+  private:
+    int fds[NPERF];
+    int nOpen;
+    unsigned long long calls[NPERF_SLOTS];
+    unsigned long long bytes[NPERF_SLOTS];
+    unsigned long long counts[NPERF_SLOTS][NPERF];
+};
+
+#endif // PERFCOUNTERS_H__
@@ -63,6 +63,13 @@ PrimerSearch::PrimerSearch(PrimerPair *pp, WeightMatrix *wm, bool cNoRevC, bool
   
   // set up mismatch bit vectors
   setupMismatchVectors();
+  
+  // planes above kbits are never shifted but are still read when a hit is
+  // scored, so they must start (and stay) clear
+  for (int j=0; j < MAX_BITS; j++) {
+    forR[j] = 0LLU;
+    revR[j] = 0LLU;
+  }
 
   // record lengths to speed up search
   forPrimerLength = pp->getForPrimer().length();
@@ -71,28 +78,17 @@ PrimerSearch::PrimerSearch(PrimerPair *pp, WeightMatrix *wm, bool cNoRevC, bool
   // now create pattern arrays
   if (revPrimerLength > 0) {
     if (noRevC) {
-	  createPatternArray(FOR, REV, P5, false, true, pp->getForPrimer(), reverseComplement(pp->getRevPrimer()), forParray);
-      createPatternArray(FOR, REV, P3, true, false, pp->getRevPrimer(), reverseComplement(pp->getForPrimer()), revParray);
+	  createPatternArray(FOR, REV, P5, P5, false, false, pp->getForPrimer(), reverseComplement(pp->getRevPrimer()), forParray);
+      createPatternArray(REV, FOR, P3, P3, true, true, pp->getRevPrimer(), reverseComplement(pp->getForPrimer()), revParray);
     }
     else {
-	  createPatternArray(FOR, REV, P5, false, false, pp->getForPrimer(), pp->getRevPrimer(),forParray);
-	  createPatternArray(FOR, REV, P3, true, true, reverseComplement(pp->getRevPrimer()), reverseComplement(pp->getForPrimer()), revParray);
+	  createPatternArray(FOR, REV, P5, P5, false, false, pp->getForPrimer(), pp->getRevPrimer(),forParray);
+	  createPatternArray(REV, FOR, P3, P3, true, true, reverseComplement(pp->getRevPrimer()), reverseComplement(pp->getForPrimer()), revParray);
     }
-
-    // set up "hit buffers"...
-    // these are the bits to watch to see if we have a hit
-    forHitBuffer = 15LLU << (forPrimerLength-1);
-    forHitBuffer |= 15LLU << (revPrimerLength-1 + 32);
-    revHitBuffer = 15LLU << (revPrimerLength-1);
-    revHitBuffer |= 15LLU << (forPrimerLength-1 + 32);
   }
   else {
-	createPatternArray(FOR, REV, P5, false, false, pp->getForPrimer(), reverseComplement(pp->getForPrimer()),forParray);
-
-	// set up "hit buffers"...
-	// these are the bits to watch to see if we have a hit
-	forHitBuffer = 15LLU << (forPrimerLength-1);
-	forHitBuffer |= 15LLU << (forPrimerLength-1 + 32);
+	// the reverse complement half is the same primer on the other strand
+	createPatternArray(FOR, FOR, P5, P3, false, true, pp->getForPrimer(), reverseComplement(pp->getForPrimer()),forParray);
   }
   
  
@@ -115,9 +111,246 @@ PrimerSearch::PrimerSearch(PrimerPair *pp, WeightMatrix *wm, bool cNoRevC, bool
   else {
     maxAmpSize = int(pp->getAmpSize()*maxF);
   }
+  
+  // forward matches are stacked in the order their 3' ends are seen, so with
+  // primers of different lengths (or several hits in one 4-mer) a later
+  // entry can start a few bases before an earlier one.  Stack range checks
+  // allow for that; the per-site checks in revMatch stay exact.
+  stackRange = maxAmpSize + 3;
+  if (forPrimerLength > revPrimerLength) {
+    stackRange += forPrimerLength - revPrimerLength;
+  }
+  else {
+    stackRange += revPrimerLength - forPrimerLength;
+  }
 
   // init match count
   matchCount = 0;
+  siteBase = 0;
+  seqId = 0;
+  siteTable.resize(SITE_TABLE_START);
+  siteTableUsed = 0;
+  countOnly = false;
+  for (int i=0; i < CACHE_SIZE; i++) {
+    recentRecords[i] = NULL;
+    recentIndex[i] = -1;
+  }
+  tierLimit = 0;
+  overTier = MAX_TIERS;
+  memset(tierCounts, 0, sizeof(tierCounts));
+  ambRuns = NULL;
+  keepAmbiguous = false;
+  maskRuns = NULL;
+  skipMasked = false;
+  maskPenalty = 0;
+  regionRuns = NULL;
+  siteLog = NULL;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// ~PrimerSearch                                                             //
+//    desc: frees the priming sites found by the search                      //
+///////////////////////////////////////////////////////////////////////////////  
+
+PrimerSearch::~PrimerSearch() {
+  if (!countOnly) {
+    for (int i=0; i < matchCount - siteBase; i++) {
+      delete matchLocations[i];
+    }
+  }
+  for (int i=0; i < CACHE_SIZE; i++) {
+    delete recentRecords[i];
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// setCountOnly                                                              //
+//  inputs: count only flag <bool>                                           //
+//  output: none                                                             //
+//    desc: when set (before searching) only the number of sites is kept -   //
+//          getPrimingSite can then only return the last CACHE_SIZE sites    //
+///////////////////////////////////////////////////////////////////////////////  
+
+void PrimerSearch::setCountOnly(bool cCountOnly) {
+  countOnly = cCountOnly;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// setAmbiguities                                                            //
+//  inputs: ambiguous base runs of the seq being searched <vector BaseRun*>  //
+//  output: none                                                             //
+//    desc: set after each reset (which clears them).  NULL for none.        //
+///////////////////////////////////////////////////////////////////////////////  
+
+void PrimerSearch::setAmbiguities(const std::vector<BaseRun> *cAmbRuns) {
+  ambRuns = cAmbRuns;
+}
+
+const std::vector<BaseRun> *PrimerSearch::getAmbiguities() {
+  return ambRuns;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// setKeepAmbiguous                                                          //
+//  inputs: keep flag <bool>                                                 //
+//  output: none                                                             //
+//    desc: when set, sites with a primer over ambiguous bases are kept and  //
+//          scored against the random bases the db holds for them            //
+///////////////////////////////////////////////////////////////////////////////  
+
+void PrimerSearch::setKeepAmbiguous(bool cKeepAmbiguous) {
+  keepAmbiguous = cKeepAmbiguous;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// setMask                                                                   //
+//  inputs: masked base runs of the seq being searched <vector BaseRun*>     //
+//  output: none                                                             //
+//    desc: set after each reset (which clears them).  NULL for none.        //
+///////////////////////////////////////////////////////////////////////////////  
+
+void PrimerSearch::setMask(const std::vector<BaseRun> *cMaskRuns) {
+  maskRuns = cMaskRuns;
+}
+
+const std::vector<BaseRun> *PrimerSearch::getMask() {
+  return maskRuns;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// setMaskRule                                                               //
+//  inputs: skip flag <bool>, mismatch penalty <uns int>                     //
+//  output: none                                                             //
+//    desc: skip masked runs (and drop sites over them), or add the penalty  //
+//          to the score of each primer over a masked base.  Sites pushed    //
+//          over -k by the penalty are dropped.                              //
+///////////////////////////////////////////////////////////////////////////////  
+
+void PrimerSearch::setMaskRule(bool cSkipMasked, unsigned int cMaskPenalty) {
+  skipMasked = cSkipMasked;
+  maskPenalty = cMaskPenalty;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// setRegions                                                                //
+//  inputs: regions of the seq being searched <vector BaseRun*>              //
+//  output: none                                                             //
+//    desc: set after each reset (which clears them).  NULL keeps all sites. //
+///////////////////////////////////////////////////////////////////////////////  
+
+void PrimerSearch::setRegions(const std::vector<BaseRun> *cRegionRuns) {
+  regionRuns = cRegionRuns;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// setSiteLog                                                                //
+//  inputs: where to note the sites found <vector SiteCall*>                 //
+//  output: none                                                             //
+//    desc: the sites of the seq searched (as they passed the seq's own      //
+//          filters) and where the search checked -M, so replaySites can     //
+//          give the hits of a copy of it.  Not cleared by reset.  NULL to   //
+//          stop.                                                            //
+///////////////////////////////////////////////////////////////////////////////  
+
+void PrimerSearch::setSiteLog(std::vector<SiteCall> *cSiteLog) {
+  siteLog = cSiteLog;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// replaySites                                                               //
+//  inputs: sites noted by setSiteLog <vector SiteCall>, first and end of   //
+//          the ones to replay <uns int>, max hits <int>                     //
+//  output: true if too many hits <bool>                                     //
+//    desc: adds the sites to the seq set by reset (with the ambiguous and   //
+//          masked bases of the seq they were found in) as if it had been    //
+//          searched, stopping where that search would have                  //
+///////////////////////////////////////////////////////////////////////////////  
+
+bool PrimerSearch::replaySites(const std::vector<SiteCall> &calls, unsigned int first, unsigned int end, int maxHits) {
+  for (std::vector<SiteCall>::const_iterator call = calls.begin() + first; call != calls.begin() + end; ++call) {
+    keepSite(call->forPos, call->revPos, call->forDir, call->revDir, call->forScore, call->revScore);
+    if (call->check && matchCount - siteBase > maxHits) {
+      return true;
+    }
+  }
+  return false;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// setTierLimit                                                              //
+//  inputs: max hits worth counting in any one tier <int>                    //
+//  output: none                                                             //
+//    desc: when set (before searching) new sites are also counted by score, //
+//          so one search at k gives the hit counts of searches at 0 to k.   //
+//          The search ends once even exact matches are over the limit.      //
+///////////////////////////////////////////////////////////////////////////////  
+
+void PrimerSearch::setTierLimit(int cTierLimit) {
+  tierLimit = cTierLimit;
+  overTier = (kmm + 1 < (unsigned int) MAX_TIERS) ? kmm + 1 : MAX_TIERS;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// getTierCount                                                              //
+//  inputs: max mismatch score <uns int>                                     //
+//  output: number of hits a search at that k would find <int>               //
+//    desc: counts above the tier limit only mean "over the limit"           //
+///////////////////////////////////////////////////////////////////////////////  
+
+int PrimerSearch::getTierCount(unsigned int tier) {
+  int count = 0;
+  for (unsigned int t=0; t <= tier && t < (unsigned int) MAX_TIERS; ++t) {
+    count += tierCounts[t];
+  }
+  return count;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// countTier                                                                 //
+//  inputs: score tier of a new site <uns int>                               //
+//  output: none                                                             //
+//    desc: counts the site and moves overTier down to the lowest tier now   //
+//          over the limit                                                   //
+///////////////////////////////////////////////////////////////////////////////  
+
+void PrimerSearch::countTier(unsigned int tier) {
+  ++tierCounts[tier];
+  int count = 0;
+  for (unsigned int t=0; t < overTier; ++t) {
+    count += tierCounts[t];
+    if (count > tierLimit) {
+      overTier = t;
+    }
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// releaseSites                                                              //
+//  inputs: site number <int>                                                //
+//  output: none                                                             //
+//    desc: frees the sites before the given one once they have been used    //
+//          (between calls to findPattern only).  The site count carries     //
+//          on; getPrimingSite can then only return the later sites.         //
+///////////////////////////////////////////////////////////////////////////////  
+
+void PrimerSearch::releaseSites(int upTo) {
+  if (countOnly || upTo <= siteBase) {
+    return;
+  }
+  int nReleased = upTo - siteBase;
+  for (int i=0; i < nReleased; i++) {
+    delete matchLocations[i];
+  }
+  for (int i=nReleased; i < matchCount - siteBase; i++) {
+    matchLocations[i - nReleased] = matchLocations[i];
+  }
+  siteBase = upTo;
+  
+  // every later site ends further along the seq (or on another one), so
+  // none of them can repeat a site already found
+  SiteKey empty = {0, 0, 0};
+  siteTable.assign(SITE_TABLE_START, empty);
+  siteTableUsed = 0;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -131,13 +364,18 @@ void PrimerSearch::reset(char* cSeqName) {
   
   // record the name of the seq we are searching
 
+  // (its id is only looked up once it has a site - most seqs never do)
   strcpy(seqName,cSeqName);
+  seqId = 0;
   
   rightIndex = 0;
   for (unsigned int j=0; j <= kbits; j++) {
     forR[j] = ~((unsigned long long int) 0);
     revR[j] = ~((unsigned long long int) 0);
   }
+  ambRuns = NULL;
+  maskRuns = NULL;
+  regionRuns = NULL;
 
 }
 
@@ -150,9 +388,33 @@ int PrimerSearch::getMatchCount() {
 }
 
 PrimingSite *PrimerSearch::getPrimingSite(int mc) {
-  return matchLocations[mc];
+  if (!countOnly) {
+    return matchLocations[mc - siteBase];
+  }
+  if (mc < getFirstSite() || mc >= matchCount) {
+    return NULL;
+  }
+  int slot = mc % CACHE_SIZE;
+  if (recentIndex[slot] != mc) {
+    SiteKey &site = recentSites[slot];
+    PrimerDirection forDir = recentDirs[slot][0];
+    PrimerDirection revDir = recentDirs[slot][1];
+    delete recentRecords[slot];
+    recentRecords[slot] = new PrimingSite((char*) seqNames[site.seq-1].c_str(), site.forPos, site.revPos,
+                                          forDir, revDir, (forDir == REV && revDir == FOR) ? MS : PS,
+                                          recentScores[slot][0], recentScores[slot][1]);
+    recentIndex[slot] = mc;
+  }
+  return recentRecords[slot];
 }            
 
+int PrimerSearch::getFirstSite() {
+  if (countOnly) {
+    return (matchCount > CACHE_SIZE) ? matchCount - CACHE_SIZE : 0;
+  }
+  return siteBase;
+}
+
 PrimerPair *PrimerSearch::getPrimerPair() {
   return primerPair;
 }
@@ -161,6 +423,14 @@ int PrimerSearch::getNoRevC() {
   return noRevC;
 }
 
+unsigned int PrimerSearch::getMaxAmpSize() {
+  return maxAmpSize;
+}
+
+SearchStats &PrimerSearch::getStats() {
+  return stats;
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 // complement                                                                //
 //  inputs: base (char)                                                      //
@@ -184,6 +454,31 @@ char PrimerSearch::complement(char base) {
     case 'T' :
       cbase = 'A';
       break;
+    // degenerate bases complement as sets (S, W and N are their own)
+    case 'R' :
+      cbase = 'Y';
+      break;
+    case 'Y' :
+      cbase = 'R';
+      break;
+    case 'K' :
+      cbase = 'M';
+      break;
+    case 'M' :
+      cbase = 'K';
+      break;
+    case 'B' :
+      cbase = 'V';
+      break;
+    case 'V' :
+      cbase = 'B';
+      break;
+    case 'D' :
+      cbase = 'H';
+      break;
+    case 'H' :
+      cbase = 'D';
+      break;
     default:
       // do nothing to strange bases
       cbase = base;
@@ -226,7 +521,7 @@ std::string PrimerSearch::reverseComplement(std::string primer) {
 // covertToSequence                                                          //
 //  inputs: seq buffer <char*>, buffer size <int>, buffer loc start <int>    //
 //          size of seq to return <int>                                      //
-//  output: sequence <char*>                                                 //
+//  output: sequence <char*> - the caller deletes it                         //
 //    desc: decodes a portion of the sequence buffer                         //                                                   
 ///////////////////////////////////////////////////////////////////////////////  
 
@@ -234,19 +529,7 @@ char* PrimerSearch::convertToSequence(char *cBuffer, int sBufferSize, int bStart
   
   // create char array to hold results
   char* sequence = new char[size*4+1];
-  
-  // copy seq data into our sequence being careful to avoid buffer boundaries
-  char* fourmer;  
-  for (int i=0; i < size; i++) {
-    int bufPos = (bStart + i) % sBufferSize;
-    if (bufPos <  0) {
-      bufPos += sBufferSize;
-    }
-    fourmer = bits2chars((unsigned int) cBuffer[bufPos]);
-    for (int k=0; k < 4; k++) {
-      sequence[i*4+k] = fourmer[k];
-    }
-  }
+  decodeBases(cBuffer, sBufferSize, bStart, 0, size*4, sequence);
   sequence[size*4] = '\0';
   
   return sequence;
@@ -307,138 +590,152 @@ inline int PrimerSearch::getBasecode(char base) {
 }
 
 ///////////////////////////////////////////////////////////////////////////////
-// countMismatches                                                           //
-//  inputs: primer F/R (0,1) <int>, 5' or 3' dir <int>, comp flag <int>,     //
-//          primer seq <string>, template four-mer <char>, start <int>,      //
-//          stop <int>                                                       // 
-//  output: mismatch penalty score <int>                                     //
-//    desc: given a primer sequence and a possible template 4-mer (4 bases)  //
-//          returns the weighted mismatch penalty score                      //                                                   
+// decodeBases                                                               //
+//  inputs: seq buffer <char*>, buffer size <int>, buffer loc start <int>,   //
+//          bases to skip in the first byte <int>, number of bases <int>,    //
+//          where to put them <char*>                                        //
+//  output: none                                                             //
+//    desc: decodes bases from the (circular) sequence buffer a byte at a    //
+//          time through a table of the 4 bases of every byte                //
 ///////////////////////////////////////////////////////////////////////////////  
 
-unsigned int PrimerSearch::countMismatches(PrimerDirection primer, PrimerEnd dir, bool isComp, std::string pattern, char* fourmer, int start, int stop) { 
-  int patLength = pattern.length();
-  int mmc = 0;
+void PrimerSearch::decodeBases(const char *cBuffer, int sBufferSize, int bStart, int offset, int length, char *sequence) {
+  const char *table = fourmerTable();
   
-  for (int i=start; i<=stop; ++i) {
-    if ((i >= 0) && (i < patLength)) {
-      char pbase = pattern[i];
-	  char fbase = fourmer[i-start];
-	  if (isComp) {
-        pbase = complement(pbase);
-		fbase = complement(fbase);
-	  }
-      int wt = weights->getWeight(primer, ((patLength - 1) - i)*dir + (1-dir)*i,
-                                  ((patLength - 1) - i)*(1-dir) + dir*i,
-                                  pbase, fbase); 
-      mmc += wt;
+  int bufPos = bStart % sBufferSize;
+  if (bufPos < 0) {
+    bufPos += sBufferSize;
+  }
+  int done = 0;
+  while (done < length) {
+    const char *fourmer = table + 4*(unsigned char) cBuffer[bufPos];
+    int n = 4 - offset;
+    if (n > length - done) {
+      n = length - done;
+    }
+    if (n == 4) {
+      memcpy(sequence + done, fourmer, 4);
+    }
+    else {
+      memcpy(sequence + done, fourmer + offset, n);
+    }
+    done += n;
+    offset = 0;
+    if (++bufPos == sBufferSize) {
+      bufPos = 0;
     }
   }
-  
-  return mmc;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
-// bits2chars                                                                //
-//  inputs: bit encrypted 4-mer <unsigned int>                               //
-//  output: 4-mer <char*>                                                    //
-//    desc: converts back a bit encoded 4-mer into 4 bases                   //                                                 
+// fourmerTable                                                              //
+//  inputs: none                                                             //
+//  output: the 4 bases of each byte value, 4 chars apiece <char*>           //
+//    desc: builds the decoding table on first use (first base in the high   //
+//          bits)                                                            //
 ///////////////////////////////////////////////////////////////////////////////  
 
-char* PrimerSearch::bits2chars(unsigned int pat) {
-  char *fourmer = new char[4];
-  
-  //for (int i=strlen(pattern)-1; i >= 0; i--) {
-  for (int i=3; i >= 0; --i) {
-    unsigned int base = pat & 3; 
-    switch (base) {
-      case 0: 
-        fourmer[i] = 'A';
-        break;
-      case 1:
-        fourmer[i] = 'C';
-        break;
-      case 2:
-        fourmer[i] = 'G';
-        break;
-      case 3:
-        fourmer[i] = 'T';
-        break;
-    };
-    pat >>= 2;
-  }
-  return fourmer;
+const char *PrimerSearch::fourmerTable() {
+  static char table[NFOURMERS*4];
+  static bool built = false;
+  if (!built) {
+    const char bases[] = "ACGT";
+    for (unsigned int pat=0; pat < NFOURMERS; pat++) {
+      for (int i=0; i < 4; i++) {
+        table[pat*4 + i] = bases[(pat >> (6 - 2*i)) & 3];
+      }
+    }
+    built = true;
+  }
+  return table;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
-// createPatternArray                                                        //
-//  inputs: primer direction <PrimerDirection>, primer end (5' or 3')        //
-//          <PrimerEnd>, is complented flag <bool>, primer seq <string>,     //
-//          pattern array <long[][]>                                         //
+// weightRows                                                                //
+//  inputs: primer F/R <PrimerDirection>, 5' or 3' dir <PrimerEnd>, comp     //
+//          flag <bool>, primer seq <string>, rows to fill <int[][]>         //
 //  output: none                                                             //
-//    desc: sets up a pattern array for every possible 4-mer and one of our  //
-//          primers                                                          //                                                 
+//    desc: looks up once from the weight matrix the penalty of each         //
+//          primer position against each template base (A, C, G, T), so      //
+//          4-mer scores are a few table adds.  A degenerate position gets   //
+//          the best penalty of its bases, so one pattern covers the family. //
 ///////////////////////////////////////////////////////////////////////////////  
 
-void PrimerSearch::createPatternArray(PrimerDirection primer1, PrimerDirection primer2, PrimerEnd dir, bool isComp1, bool isComp2, std::string pattern1, std::string pattern2, unsigned long long patternArray[][NFOURMERS]) {
-     
-  // do primers in reverse order since bits get shifted left
-  // primer2
-  int patLength = pattern2.length();
+void PrimerSearch::weightRows(PrimerDirection primer, PrimerEnd dir, bool isComp, const std::string &pattern, int rows[][NBASES]) {
+  int patLength = pattern.length();
   
-  for (unsigned long i=0; i < NFOURMERS; i++) {
-    
-    char* fourmer = bits2chars(i);
-    
-    // clear pattern bits
-    for (int k=0; k < MAX_BITS; k++) {
-      patternArray[k][i] = 0LLU;
+  for (int i=0; i < patLength; ++i) {
+    char pbase = (isComp) ? complement(pattern[i]) : pattern[i];
+    int p5 = (dir == P5) ? i : (patLength - 1) - i;
+    for (int b=0; b < NBASES; ++b) {
+      char tbase = (isComp) ? complement("ACGT"[b]) : "ACGT"[b];
+      rows[i][b] = weights->getWeight(primer, p5, (patLength - 1) - p5, pbase, tbase);
     }
-    
-    for (int j = patLength+2; j >= 0; --j) {
-      unsigned int mmc = countMismatches(primer2, dir, isComp2, pattern2, fourmer, j-3, j);
-     
-      for (int nmm = 0; nmm < MAX_BITS; ++nmm) {
-        patternArray[nmm][i] <<= 1;
-        if (mmc & 1 || (mmc > kmm)) {
-          patternArray[nmm][i] |= 1LLU;
-        }
-        mmc >>= 1;
-      }
-    }
-  }
-
-  // space to 32 bits
-  patLength = pattern1.length();
-  for (unsigned long i=0; i < NFOURMERS; i++) {
-	for (int j = 32 - (patLength+4); j >= 0; --j) {
-      for (int nmm = 0; nmm < MAX_BITS; ++nmm) {
-		patternArray[nmm][i] <<= 1;
-      }
-	}
   }
+}
 
-  // primer1
-
-  for (unsigned long i=0; i < NFOURMERS; i++) {
-
-    char* fourmer = bits2chars(i);
-
-    for (int j = patLength+2; j >= 0; --j) {
-      unsigned int mmc = countMismatches(primer1, dir, isComp1, pattern1, fourmer, j-3, j);
+///////////////////////////////////////////////////////////////////////////////
+// addPatternBits                                                            //
+//  inputs: primer F/R <PrimerDirection>, 5' or 3' dir <PrimerEnd>, comp     //
+//          flag <bool>, primer seq <string>, bit offset <int>, pattern      //
+//          array <long[][]>                                                 //
+//  output: none                                                             //
+//    desc: sets the bits for one primer at the offset (0 or 32) in the      //
+//          planes of every 4-mer.  Bit j holds the score of primer          //
+//          positions j-3 to j against the 4-mer; a score over k sets the    //
+//          bit in every plane the kernel for k reads.                       //
+///////////////////////////////////////////////////////////////////////////////  
 
-      for (int nmm = 0; nmm < MAX_BITS; ++nmm) {
-        patternArray[nmm][i] <<= 1;
-        if (mmc & 1 || (mmc > kmm)) {
-          patternArray[nmm][i] |= 1LLU;
-        }
-        mmc >>= 1;
+void PrimerSearch::addPatternBits(PrimerDirection primer, PrimerEnd dir, bool isComp, const std::string &pattern, int offset, unsigned long long patternArray[][NFOURMERS]) {
+  // primer position i is row i+3, with zero rows either side for the
+  // 4-mers hanging off the ends
+  int rows[MAXPRIMERSIZE + 6][NBASES];
+  int patLength = pattern.length();
+  memset(rows, 0, sizeof(rows));
+  weightRows(primer, dir, isComp, pattern, rows + 3);
+  
+  // the kernels only read planes 0-kbits
+  unsigned int nplanes = (kbits < MAX_BITS) ? kbits : MAX_BITS - 1;
+  
+  for (unsigned int i=0; i < NFOURMERS; i++) {
+    // first base in the high bits
+    unsigned int fourmer[4] = {(i >> 6) & 3, (i >> 4) & 3, (i >> 2) & 3, i & 3};
+    
+    unsigned long long int planes[MAX_BITS] = {0LLU};
+    for (int j=0; j < patLength + 3; ++j) {
+      unsigned int mmc = rows[j][fourmer[0]] + rows[j+1][fourmer[1]] +
+                         rows[j+2][fourmer[2]] + rows[j+3][fourmer[3]];
+      if (mmc > kmm) {
+        mmc = ~0U;
       }
+      for (unsigned int nmm = 0; nmm <= nplanes; ++nmm) {
+        planes[nmm] |= (unsigned long long int) ((mmc >> nmm) & 1) << j;
+      }
+    }
+    
+    for (int nmm = 0; nmm < MAX_BITS; ++nmm) {
+      patternArray[nmm][i] |= planes[nmm] << offset;
     }
   }
+}
 
+///////////////////////////////////////////////////////////////////////////////
+// createPatternArray                                                        //
+//  inputs: primer direction <PrimerDirection>, primer end (5' or 3')        //
+//          <PrimerEnd>, is complented flag <bool>, primer seq <string>,     //
+//          each given for both halves, pattern array <long[][]>             //
+//  output: none                                                             //
+//    desc: sets up a pattern array for every possible 4-mer and our two     //
+//          primers, the first in the low 32 bits and the second in the high //
+///////////////////////////////////////////////////////////////////////////////  
+
+void PrimerSearch::createPatternArray(PrimerDirection primer1, PrimerDirection primer2, PrimerEnd dir1, PrimerEnd dir2, bool isComp1, bool isComp2, std::string pattern1, std::string pattern2, unsigned long long patternArray[][NFOURMERS]) {
+  memset(patternArray, 0, sizeof(unsigned long long) * MAX_BITS * NFOURMERS);
+  addPatternBits(primer1, dir1, isComp1, pattern1, 0, patternArray);
+  addPatternBits(primer2, dir2, isComp2, pattern2, 32, patternArray);
 }
 
+
 ///////////////////////////////////////////////////////////////////////////////
 // forMatch                                                                  //
 //  inputs: position of for match <int>                                      //
@@ -447,13 +744,16 @@ void PrimerSearch::createPatternArray(PrimerDirection primer1, PrimerDirection p
 ///////////////////////////////////////////////////////////////////////////////  
 
 inline void PrimerSearch::forMatch(unsigned int position) {
+  const unsigned long long int forHitBuffer = hitMask(forPrimerLength, revPrimerLength);
+
+  int firstIndex = rightIndex;
 
   unsigned long long int offbit =   (forHitBuffer & (
          ((~forR[4] & mismBits[4]) |
          ((~forR[4] | mismBits[4]) & (~forR[3] & mismBits[3])) |
          ((~forR[4] | mismBits[4]) & (~forR[3] | mismBits[3]) & (~forR[2] & mismBits[2])) |
          ((~forR[4] | mismBits[4]) & (~forR[3] | mismBits[3]) & (~forR[2] | mismBits[2]) & (~forR[1] & mismBits[1])) |
-         ((~forR[4] | mismBits[4]) & (~forR[3] | mismBits[3]) & (~forR[2] | mismBits[2]) & (~forR[1] | mismBits[1])) & (~forR[0] | mismBits[0]))));
+         ((~forR[4] | mismBits[4]) & (~forR[3] | mismBits[3]) & (~forR[2] | mismBits[2]) & (~forR[1] | mismBits[1]) & (~forR[0] | mismBits[0])))));
   unsigned long long int offbitPS = offbit >> (forPrimerLength-1);
   unsigned long long int offbitMS = offbit >> (revPrimerLength-1 + 32);
 
@@ -463,24 +763,28 @@ inline void PrimerSearch::forMatch(unsigned int position) {
 	if (offbitPS & 1) {
       forMatches[rightIndex] = position -(forPrimerLength-4)+1;
       forMatchDir[rightIndex] = FOR;
+      forMatchScore[rightIndex] = planeScore(forR, forPrimerLength-1);
       rightIndex++;
     }
 
     if (offbitPS & 2) {
       forMatches[rightIndex] = position -(forPrimerLength-4);
       forMatchDir[rightIndex] = FOR;
+      forMatchScore[rightIndex] = planeScore(forR, forPrimerLength);
       rightIndex++;
     }
 
     if (offbitPS & 4) {
       forMatches[rightIndex] = position -(forPrimerLength-4) - 1;
       forMatchDir[rightIndex] = FOR;
+      forMatchScore[rightIndex] = planeScore(forR, forPrimerLength + 1);
       rightIndex++;
     }
   
     if (offbitPS & 8) {
       forMatches[rightIndex] = position -(forPrimerLength-4) - 2;
       forMatchDir[rightIndex] = FOR;
+      forMatchScore[rightIndex] = planeScore(forR, forPrimerLength + 2);
       rightIndex++;
     }
 
@@ -491,28 +795,36 @@ inline void PrimerSearch::forMatch(unsigned int position) {
     if (offbitMS & 1) {
       forMatches[rightIndex] = position -(revPrimerLength-4)+1;
       forMatchDir[rightIndex] = REV;
+      forMatchScore[rightIndex] = planeScore(forR, revPrimerLength-1 + 32);
       rightIndex++;
     }
 
     if (offbitMS & 2) {
       forMatches[rightIndex] = position -(revPrimerLength-4);
       forMatchDir[rightIndex] = REV;
+      forMatchScore[rightIndex] = planeScore(forR, revPrimerLength + 32);
       rightIndex++;
     }
 
     if (offbitMS & 4) {
       forMatches[rightIndex] = position -(revPrimerLength-4) - 1;
       forMatchDir[rightIndex] = REV;
+      forMatchScore[rightIndex] = planeScore(forR, revPrimerLength + 32 + 1);
       rightIndex++;
     }
   
     if (offbitMS & 8) {
       forMatches[rightIndex] = position -(revPrimerLength-4) - 2;
       forMatchDir[rightIndex] = REV;
+      forMatchScore[rightIndex] = planeScore(forR, revPrimerLength + 32 + 2);
       rightIndex++;
     }
 
   }
+  stats.forCandidates += rightIndex - firstIndex;
+  if (rightIndex > stats.peakMatchDepth) {
+    stats.peakMatchDepth = rightIndex;
+  }
   if (rightIndex >= MATCH_BUFFER) {
     std::cerr << "ERROR:  Exceeded max forward matches.  Please reduce allowed number of mismatches or increase weight matrix.\n";
     exit(0);
@@ -528,13 +840,14 @@ inline void PrimerSearch::forMatch(unsigned int position) {
 ///////////////////////////////////////////////////////////////////////////////
 
 inline bool PrimerSearch::forOneMatch(unsigned int position, int maxHits) {
+  const unsigned long long int forHitBuffer = hitMask(forPrimerLength, forPrimerLength);
 
   unsigned long long int offbit =   (forHitBuffer & (
          ((~forR[4] & mismBits[4]) |
          ((~forR[4] | mismBits[4]) & (~forR[3] & mismBits[3])) |
          ((~forR[4] | mismBits[4]) & (~forR[3] | mismBits[3]) & (~forR[2] & mismBits[2])) |
          ((~forR[4] | mismBits[4]) & (~forR[3] | mismBits[3]) & (~forR[2] | mismBits[2]) & (~forR[1] & mismBits[1])) |
-         ((~forR[4] | mismBits[4]) & (~forR[3] | mismBits[3]) & (~forR[2] | mismBits[2]) & (~forR[1] | mismBits[1])) & (~forR[0] | mismBits[0]))));
+         ((~forR[4] | mismBits[4]) & (~forR[3] | mismBits[3]) & (~forR[2] | mismBits[2]) & (~forR[1] | mismBits[1]) & (~forR[0] | mismBits[0])))));
   unsigned long long int offbitPS = offbit >> (forPrimerLength-1);
   unsigned long long int offbitMS = offbit >> (forPrimerLength-1 + 32);
 
@@ -542,19 +855,19 @@ inline bool PrimerSearch::forOneMatch(unsigned int position, int maxHits) {
     // for hits
 
 	if (offbitPS & 1) {
-      addPrimingSite(position -(forPrimerLength-4)+1, position + 4, FOR, REV);
+      addPrimingSite(position -(forPrimerLength-4)+1, position + 4, FOR, REV, planeScore(forR, forPrimerLength-1), 0);
     }
 
     if (offbitPS & 2) {
-      addPrimingSite(position -(forPrimerLength-4), position + 3, FOR, REV);
+      addPrimingSite(position -(forPrimerLength-4), position + 3, FOR, REV, planeScore(forR, forPrimerLength), 0);
     }
 
     if (offbitPS & 4) {
-      addPrimingSite(position -(forPrimerLength-4) - 1, position + 2, FOR, REV);
+      addPrimingSite(position -(forPrimerLength-4) - 1, position + 2, FOR, REV, planeScore(forR, forPrimerLength + 1), 0);
     }
 
     if (offbitPS & 8) {
-      addPrimingSite(position -(forPrimerLength-4) - 2, position + 1, FOR, REV);
+      addPrimingSite(position -(forPrimerLength-4) - 2, position + 1, FOR, REV, planeScore(forR, forPrimerLength + 2), 0);
     }
 
   }
@@ -564,23 +877,24 @@ inline bool PrimerSearch::forOneMatch(unsigned int position, int maxHits) {
 	forMatchDir[rightIndex] = REV;
 
     if (offbitMS & 1) {
-      addPrimingSite(position -(forPrimerLength-4) + 1, position + 4, REV, FOR);
+      addPrimingSite(position -(forPrimerLength-4) + 1, position + 4, REV, FOR, 0, planeScore(forR, forPrimerLength-1 + 32));
     }
 
     if (offbitMS & 2) {
-      addPrimingSite(position -(forPrimerLength-4), position + 3, REV, FOR);
+      addPrimingSite(position -(forPrimerLength-4), position + 3, REV, FOR, 0, planeScore(forR, forPrimerLength + 32));
     }
 
     if (offbitMS & 4) {
-      addPrimingSite(position -(forPrimerLength-4) - 1, position + 2, REV, FOR);
+      addPrimingSite(position -(forPrimerLength-4) - 1, position + 2, REV, FOR, 0, planeScore(forR, forPrimerLength + 32 + 1));
     }
 
     if (offbitMS & 8) {
-      addPrimingSite(position -(forPrimerLength-4) - 2, position + 1, REV, FOR);
+      addPrimingSite(position -(forPrimerLength-4) - 2, position + 1, REV, FOR, 0, planeScore(forR, forPrimerLength + 32 + 2));
     }
 
   }
-  if (matchCount > maxHits) {
+  markCheck();
+  if (matchCount - siteBase > maxHits) {
     return true;
   }
   return false;
@@ -588,44 +902,220 @@ inline bool PrimerSearch::forOneMatch(unsigned int position, int maxHits) {
 }
 
 
+///////////////////////////////////////////////////////////////////////////////
+// fivePrimeOver / threePrimeOver                                            //
+//  inputs: sorted runs <vector BaseRun>, for (rev) position <int>, 5' (3')  //
+//          match primer                                                     //
+//  output: true if that end's primer covers a base of the runs              //
+//    desc: positions are 1-based, the first and last bases of the site      //
+///////////////////////////////////////////////////////////////////////////////  
+
+inline unsigned int PrimerSearch::primerLength(PrimerDirection dir) {
+  return (dir == REV && revPrimerLength > 0) ? revPrimerLength : forPrimerLength;
+}
+
+inline bool PrimerSearch::fivePrimeOver(const std::vector<BaseRun> &runs, unsigned int forPos, PrimerDirection forDir) {
+  return AmbiguityTable::overlaps(runs, forPos - 1, forPos - 1 + primerLength(forDir));
+}
+
+inline bool PrimerSearch::threePrimeOver(const std::vector<BaseRun> &runs, unsigned int revPos, PrimerDirection revDir) {
+  return AmbiguityTable::overlaps(runs, revPos - primerLength(revDir), revPos);
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 // addPrimingSite                                                            //
 //  inputs: for position <int>, rev position <int>, 5' match primer,         //
-//          3' match primer                                                  //
+//          3' match primer, 5' match score <int>, 3' match score <int>      //
 //  output: none                                                             //
-//    desc: adds priming site to list while making sure site is unique       //                                                 
+//    desc: adds priming site to list while making sure site is unique.      //
+//          The site keeps the FOR primer's score as its for score, so on    //
+//          the minus strand the scores swap ends.                           //                                                 
 ///////////////////////////////////////////////////////////////////////////////  
 
-inline void PrimerSearch::addPrimingSite(unsigned int forPos, unsigned int revPos, PrimerDirection forDir, PrimerDirection revDir) {
+inline void PrimerSearch::addPrimingSite(unsigned int forPos, unsigned int revPos, PrimerDirection forDir, PrimerDirection revDir,
+                                         unsigned int forScore, unsigned int revScore) {
 
   // skip if we're not doing F-F or R-R hits and that's what we have
   if (forDir == revDir && noSelfSelf) {
 	  return;
   }
+  
+  // or if the amplicon misses every region searched
+  if (regionRuns != NULL && !AmbiguityTable::overlaps(*regionRuns, forPos - 1, revPos)) {
+    return;
+  }
+  
+  // or if a primer sits on bases the db does not really have
+  if (ambRuns != NULL && (fivePrimeOver(*ambRuns, forPos, forDir) || threePrimeOver(*ambRuns, revPos, revDir))) {
+    ++stats.sitesAmbiguous;
+    if (!keepAmbiguous) {
+      return;
+    }
+  }
+  
+  // or on masked bases, unless the mask penalty still leaves it under -k
+  if (maskRuns != NULL) {
+    bool forMasked = fivePrimeOver(*maskRuns, forPos, forDir);
+    bool revMasked = threePrimeOver(*maskRuns, revPos, revDir);
+    if (forMasked || revMasked) {
+      forScore += (forMasked) ? maskPenalty : 0;
+      revScore += (revMasked) ? maskPenalty : 0;
+      if (skipMasked || std::max(forScore, revScore) > kmm) {
+        ++stats.sitesMasked;
+        return;
+      }
+    }
+  }
+  
+  // the rest depends on the sites found so far, not on the seq, so a
+  // copy of it starts from here (see replaySites)
+  if (siteLog != NULL) {
+    SiteCall call = {forPos, revPos, forDir, revDir, forScore, revScore, false};
+    siteLog->push_back(call);
+  }
+  keepSite(forPos, revPos, forDir, revDir, forScore, revScore);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// keepSite                                                                  //
+//  inputs: as for addPrimingSite, after its filters                         //
+//  output: none                                                             //
+//    desc: drops the site if its tier is full or it was seen before,        //
+//          otherwise adds it                                                //
+///////////////////////////////////////////////////////////////////////////////  
+
+inline void PrimerSearch::keepSite(unsigned int forPos, unsigned int revPos, PrimerDirection forDir, PrimerDirection revDir,
+                                   unsigned int forScore, unsigned int revScore) {
 
-  // create a new priming site, ignore scores for now
+  // when counting tiers, skip it if its tier already has too many hits
+  unsigned int tier = std::max(forScore, revScore);
+  if (tierLimit > 0 && tier >= overTier) {
+    return;
+  }
+
+  // create a new priming site
   // always use Plus Strand unless (Rev, For) match
   DNAStrand strand = PS;
   if (forDir == REV && revDir == FOR) {
 	  strand = MS;
+	  std::swap(forScore, revScore);
   }
 
-  PrimingSite *ps = new PrimingSite(seqName, forPos, revPos, forDir, revDir, strand, 0, 0);
+  double start = (RunStats::enabled) ? RunStats::wallSeconds() : 0;
+  unsigned long long before[NPERF];
+  if (PerfCounters::active != NULL) {
+    PerfCounters::active->read(before);
+  }
+  ++stats.sitesAdded;
+  if (seqId == 0) {
+    internSeqName();
+  }
   
-  // search all previous sites to make sure we don't already have this
-  // - for now, simple loop search will do.  If we plan on keeping many
-  //   hits we should move this to a hash
-  for (int i=0; i < matchCount; i++) {
-    if (ps->compare(matchLocations[i]) == 0) {
-      // already seen
-      delete ps;
-      return; 
+  if (!insertSite(forPos, revPos)) {
+    // already seen
+    ++stats.sitesDuplicate;
+    tier = MAX_TIERS;
+  }
+  else if (countOnly) {
+    // a new one - just note it in case it is needed to seed the cache
+    int slot = matchCount % CACHE_SIZE;
+    recentSites[slot].seq = seqId;
+    recentSites[slot].forPos = forPos;
+    recentSites[slot].revPos = revPos;
+    recentDirs[slot][0] = forDir;
+    recentDirs[slot][1] = revDir;
+    recentScores[slot][0] = forScore;
+    recentScores[slot][1] = revScore;
+    matchCount++;
+  }
+  else {
+    // a new one!
+    matchLocations[matchCount - siteBase] = new PrimingSite(seqName, forPos, revPos, forDir, revDir, strand, forScore, revScore);
+    matchCount++;
+  }
+  
+  if (tierLimit > 0 && tier < overTier) {
+    countTier(tier);
+  }
+  
+  if (RunStats::enabled) {
+    stats.siteSeconds += RunStats::wallSeconds() - start;
+  }
+  if (PerfCounters::active != NULL) {
+    PerfCounters::active->add(PERF_SITES, before, 0);
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// internSeqName                                                             //
+//  inputs: none                                                             //
+//  output: none                                                             //
+//    desc: sets seqId for the current seq, adding its name if it is new     //
+///////////////////////////////////////////////////////////////////////////////  
+
+void PrimerSearch::internSeqName() {
+  std::map<std::string, unsigned int>::iterator id = seqIds.find(seqName);
+  if (id == seqIds.end()) {
+    seqNames.push_back(seqName);
+    seqId = seqNames.size();
+    seqIds[seqName] = seqId;
+  }
+  else {
+    seqId = id->second;
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// insertSite                                                                //
+//  inputs: for position <int>, rev position <int>                           //
+//  output: true if the site is new for the current seq, false otherwise     //
+//    desc: records a site in the hash of sites seen so far                  //
+///////////////////////////////////////////////////////////////////////////////  
+
+inline bool PrimerSearch::insertSite(unsigned int forPos, unsigned int revPos) {
+  unsigned int mask = siteTable.size() - 1;
+  unsigned int h = (seqId * 0x9E3779B1u) ^ (forPos * 0x85EBCA6Bu) ^ (revPos * 0xC2B2AE35u);
+  h = (h ^ (h >> 15)) & mask;
+  while (siteTable[h].seq != 0) {
+    if (siteTable[h].seq == seqId && siteTable[h].forPos == forPos &&
+        siteTable[h].revPos == revPos) {
+      return false;
     }
+    h = (h + 1) & mask;
   }
+  siteTable[h].seq = seqId;
+  siteTable[h].forPos = forPos;
+  siteTable[h].revPos = revPos;
   
-  // a new one!
-  matchLocations[matchCount] = ps;
-  matchCount++;
+  // keep the table at most half full
+  if (++siteTableUsed * 2 > siteTable.size()) {
+    growSiteTable();
+  }
+  return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// growSiteTable                                                             //
+//  inputs: none                                                             //
+//  output: none                                                             //
+//    desc: doubles the site hash and re-inserts the sites seen so far       //
+///////////////////////////////////////////////////////////////////////////////  
+
+void PrimerSearch::growSiteTable() {
+  std::vector<SiteKey> old;
+  old.swap(siteTable);
+  SiteKey empty = {0, 0, 0};
+  siteTable.assign(old.size() * 2, empty);
+  siteTableUsed = 0;
+  
+  unsigned int saveSeqId = seqId;
+  for (unsigned int i=0; i < old.size(); i++) {
+    if (old[i].seq != 0) {
+      seqId = old[i].seq;
+      insertSite(old[i].forPos, old[i].revPos);
+    }
+  }
+  seqId = saveSeqId;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -638,16 +1128,18 @@ inline void PrimerSearch::addPrimingSite(unsigned int forPos, unsigned int revPo
 ///////////////////////////////////////////////////////////////////////////////  
 
 inline bool PrimerSearch::revMatch(unsigned int position, int maxHits) {
+  const unsigned long long int revHitBuffer = hitMask(revPrimerLength, forPrimerLength);
 
   unsigned int matchPosition = position + 3;
   //bool foundGoodAmp = false;
   unsigned int forPos = 0;
   unsigned int firstHit = 0;
   unsigned int lastHit = 0;
+  ++stats.revMatches;
     
   for (int i=rightIndex-1; i >= 0; i--) {
     // the constants I +/- here are because we jump 4 bps at a time
-    if (matchPosition - 2 - forMatches[i] > maxAmpSize) {
+    if (matchPosition - 2 - forMatches[i] > stackRange) {
       // any remaining hits will also be too far out
       lastHit = i + 1;
       break;
@@ -672,7 +1164,7 @@ inline bool PrimerSearch::revMatch(unsigned int position, int maxHits) {
          ((~revR[4] | mismBits[4]) & (~revR[3] & mismBits[3])) |
          ((~revR[4] | mismBits[4]) & (~revR[3] | mismBits[3]) & (~revR[2] & mismBits[2])) |
          ((~revR[4] | mismBits[4]) & (~revR[3] | mismBits[3]) & (~revR[2] | mismBits[2]) & (~revR[1] & mismBits[1])) |
-         ((~revR[4] | mismBits[4]) & (~revR[3] | mismBits[3]) & (~revR[2] | mismBits[2]) & (~revR[1] | mismBits[1])) & (~revR[0] | mismBits[0]))));
+         ((~revR[4] | mismBits[4]) & (~revR[3] | mismBits[3]) & (~revR[2] | mismBits[2]) & (~revR[1] | mismBits[1]) & (~revR[0] | mismBits[0])))));
 
     unsigned long long int offbitPS = offbit >> (revPrimerLength-1);
     unsigned long long int offbitMS = offbit >> (forPrimerLength-1 + 32);
@@ -682,22 +1174,26 @@ inline bool PrimerSearch::revMatch(unsigned int position, int maxHits) {
 
 	  if (offbitPS & 1 && (matchPosition + 2 - forPos <= maxAmpSize && matchPosition + 2 - forPos >= minAmpSize)) {
         //std::cerr << "R Hit, PP at: " << seqName << " : " << forPos << " - " << (matchPosition +1) << " - " << (matchPosition + 2 - forPos) << " - " << minAmpSize << "\n";
-        addPrimingSite(forPos,(matchPosition + 1), forDir, REV);
+        addPrimingSite(forPos,(matchPosition + 1), forDir, REV,
+                       forMatchScore[i], planeScore(revR, revPrimerLength-1));
       }
   
       if (offbitPS & 2 && (matchPosition + 1 - forPos <= maxAmpSize && matchPosition + 1 - forPos >= minAmpSize)) {
         //std::cerr << "R Hit, PP at: " << seqName << " : " << forPos << " - " << (matchPosition) << " - " << (matchPosition + 1 - forPos) << " - " << minAmpSize<<"\n";
-        addPrimingSite(forPos,(matchPosition), forDir, REV);
+        addPrimingSite(forPos,(matchPosition), forDir, REV,
+                       forMatchScore[i], planeScore(revR, revPrimerLength));
       }
     
       if (offbitPS & 4 && (matchPosition - forPos <= maxAmpSize && matchPosition - forPos >= minAmpSize)) {
         //std::cerr << "R Hit, PP at: " << seqName << " : " << forPos << " - " << (matchPosition - 1) << " - " << (matchPosition - forPos) << " - " << minAmpSize<<"\n";
-        addPrimingSite(forPos,(matchPosition - 1), forDir, REV);
+        addPrimingSite(forPos,(matchPosition - 1), forDir, REV,
+                       forMatchScore[i], planeScore(revR, revPrimerLength + 1));
       }
   
       if (offbitPS & 8 && (matchPosition - 1 - forPos <= maxAmpSize && matchPosition - 1 - forPos >= minAmpSize)) {
         //std::cerr << "R Hit, PP at: " << seqName << " : " << forPos << " - " << (matchPosition - 2) << " - " << (matchPosition -1 - forPos) << " - " << minAmpSize<< "\n";
-        addPrimingSite(forPos,(matchPosition - 2), forDir, REV);
+        addPrimingSite(forPos,(matchPosition - 2), forDir, REV,
+                       forMatchScore[i], planeScore(revR, revPrimerLength + 2));
       }
     }
 
@@ -706,26 +1202,31 @@ inline bool PrimerSearch::revMatch(unsigned int position, int maxHits) {
 
 	  if (offbitMS & 1 && (matchPosition + 2 - forPos <= maxAmpSize && matchPosition + 2 - forPos >= minAmpSize)) {
         //std::cerr << "R Hit, PP at: " << seqName << " : " << forPos << " - " << (matchPosition +1) << " - " << (matchPosition + 2 - forPos) << " - " << minAmpSize<< "\n";
-        addPrimingSite(forPos,(matchPosition + 1), forDir, FOR);
+        addPrimingSite(forPos,(matchPosition + 1), forDir, FOR,
+                       forMatchScore[i], planeScore(revR, forPrimerLength-1 + 32));
       }
 
       if (offbitMS & 2 && (matchPosition + 1 - forPos <= maxAmpSize && matchPosition + 1 - forPos >= minAmpSize)) {
         //std::cerr << "R Hit, PP at: " << seqName << " : " << forPos << " - " << (matchPosition) << " - " << (matchPosition + 1 - forPos) << " - " << minAmpSize<< "\n";
-        addPrimingSite(forPos,(matchPosition), forDir, FOR);
+        addPrimingSite(forPos,(matchPosition), forDir, FOR,
+                       forMatchScore[i], planeScore(revR, forPrimerLength + 32));
       }
 
       if (offbitMS & 4 && (matchPosition - forPos <= maxAmpSize && matchPosition - forPos >= minAmpSize)) {
         //std::cerr << "R Hit, PP at: " << seqName << " : " << forPos << " - " << (matchPosition - 1) << " - " << (matchPosition - forPos) << " - " << minAmpSize<<"\n";
-        addPrimingSite(forPos,(matchPosition - 1), forDir, FOR);
+        addPrimingSite(forPos,(matchPosition - 1), forDir, FOR,
+                       forMatchScore[i], planeScore(revR, forPrimerLength + 32 + 1));
       }
 
       if (offbitMS & 8 && (matchPosition - 1 - forPos <= maxAmpSize && matchPosition - 1 - forPos >= minAmpSize)) {
         //std::cerr << "R Hit, PP at: " << seqName << " : " << forPos << " - " << (matchPosition - 2) << " - " << (matchPosition -1 - forPos) << " - " << minAmpSize<<"\n";
-        addPrimingSite(forPos,(matchPosition - 2), forDir, FOR);
+        addPrimingSite(forPos,(matchPosition - 2), forDir, FOR,
+                       forMatchScore[i], planeScore(revR, forPrimerLength + 32 + 2));
       }
     }
 
-    if (matchCount > maxHits) {
+    markCheck();
+    if (matchCount - siteBase > maxHits) {
       return true;
     }
   }
@@ -744,30 +1245,134 @@ inline bool PrimerSearch::revMatch(unsigned int position, int maxHits) {
 //          to maintain, but runs much faster than leaving in conditionals.  //
 //          Searches are done on sense/antisense strands simultaneously.     //
 //          Fork if only a one primer search.                                //
+//          Long runs of ambiguous bases (see setAmbiguities) are skipped,   //
+//          and so are masked runs when skipMasked is set (see setMask).     //
 ///////////////////////////////////////////////////////////////////////////////  
 
 bool PrimerSearch::findPattern(char* buffer, int bufferStart, int bufferEnd,
                  unsigned int startPosition, int maxHits) {
+  bool skipMask = (skipMasked && maskRuns != NULL);
+  if (ambRuns == NULL && !skipMask) {
+    return scanRange(buffer, bufferStart, bufferEnd, startPosition, maxHits);
+  }
+  
+  // skip the whole bytes of long ambiguous runs and (with skipMasked)
+  // masked runs, taking the two in order.  The registers restart after
+  // each gap so no primer match spans it, but 5' matches already found
+  // still pair with sites past it.
+  static const std::vector<BaseRun> noRuns;
+  const std::vector<BaseRun> &ambs = (ambRuns != NULL) ? *ambRuns : noRuns;
+  const std::vector<BaseRun> &masks = (skipMask) ? *maskRuns : noRuns;
+  unsigned int endPosition = startPosition + (bufferEnd - bufferStart)*4;
+  std::vector<BaseRun>::const_iterator amb = AmbiguityTable::firstRun(ambs, startPosition);
+  std::vector<BaseRun>::const_iterator mask = AmbiguityTable::firstRun(masks, startPosition);
+  while (true) {
+    while (amb != ambs.end() && amb->length < AMB_SKIP_RUN) {
+      ++amb;
+    }
+    std::vector<BaseRun>::const_iterator run;
+    if (amb != ambs.end() && (mask == masks.end() || amb->start <= mask->start)) {
+      run = amb++;
+    }
+    else if (mask != masks.end()) {
+      run = mask++;
+    }
+    else {
+      break;
+    }
+    if (run->start >= endPosition) {
+      break;
+    }
+    
+    unsigned int gapFirst = std::max(run->start, startPosition);
+    unsigned int gapLast = std::min(run->start + run->length, endPosition);
+    if (gapLast <= gapFirst) {
+      continue;
+    }
+    int gapStart = bufferStart + (gapFirst - startPosition + 3)/4;
+    int gapEnd = bufferStart + (gapLast - startPosition)/4;
+    if (gapEnd <= gapStart) {
+      continue;
+    }
+    if (scanRange(buffer, bufferStart, gapStart, startPosition, maxHits)) {
+      return true;
+    }
+    stats.bytesSkipped += gapEnd - gapStart;
+    for (unsigned int j=0; j <= kbits; j++) {
+      forR[j] = ~((unsigned long long int) 0);
+      revR[j] = ~((unsigned long long int) 0);
+    }
+    startPosition += (gapEnd - bufferStart)*4;
+    bufferStart = gapEnd;
+  }
+  return scanRange(buffer, bufferStart, bufferEnd, startPosition, maxHits);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// scanRange                                                                 //
+//  inputs: as findPattern                                                   //
+//  output: true if exceed max hits <bool>                                   //
+//    desc: runs the kernel over a stretch of the buffer.  Counts scanned    //
+//          bytes, and times the kernel when --stats is on.  With --perf the //
+//          hardware counters are read around it as well.                    //
+///////////////////////////////////////////////////////////////////////////////  
+
+bool PrimerSearch::scanRange(char* buffer, int bufferStart, int bufferEnd,
+                 unsigned int startPosition, int maxHits) {
+  if (bufferEnd <= bufferStart) {
+    return false;
+  }
+  int kernel = kbits + ((revPrimerLength > 0) ? 0 : NKERNELS/2);
+  stats.bytesScanned[kernel] += bufferEnd - bufferStart;
+  if (!RunStats::enabled) {
+    return runKernel(buffer, bufferStart, bufferEnd, startPosition, maxHits);
+  }
+  
+  unsigned long long before[NPERF];
+  if (PerfCounters::active != NULL) {
+    PerfCounters::active->read(before);
+  }
+  double start = RunStats::wallSeconds();
+  bool exceeded = runKernel(buffer, bufferStart, bufferEnd, startPosition, maxHits);
+  stats.kernelSeconds[kernel] += RunStats::wallSeconds() - start;
+  if (PerfCounters::active != NULL) {
+    PerfCounters::active->add(kernel, before, bufferEnd - bufferStart);
+  }
+  return exceeded;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// runKernel                                                                 //
+//  inputs: as findPattern                                                   //
+//  output: true if exceed max hits <bool>                                   //
+//    desc: dispatches to the search kernel for this k and primer count      //
+///////////////////////////////////////////////////////////////////////////////  
+
+bool PrimerSearch::runKernel(char* buffer, int bufferStart, int bufferEnd,
+                 unsigned int startPosition, int maxHits) {
                  	
+  bool exceeded = false;
   if (revPrimerLength > 0) {
 	switch (kbits) {
-      case 0: return findPattern0(buffer, bufferStart, bufferEnd, startPosition, maxHits);
-      case 1: return findPattern1(buffer, bufferStart, bufferEnd, startPosition, maxHits);
-      case 2: return findPattern2(buffer, bufferStart, bufferEnd, startPosition, maxHits);
-      case 3: return findPattern3(buffer, bufferStart, bufferEnd, startPosition, maxHits);
+      case 0: exceeded = findPattern0(buffer, bufferStart, bufferEnd, startPosition, maxHits); break;
+      case 1: exceeded = findPattern1(buffer, bufferStart, bufferEnd, startPosition, maxHits); break;
+      case 2: exceeded = findPattern2(buffer, bufferStart, bufferEnd, startPosition, maxHits); break;
+      case 3: exceeded = findPattern3(buffer, bufferStart, bufferEnd, startPosition, maxHits); break;
       //case 4: return findPattern4(buffer, bufferStart, bufferEnd, startPosition, maxHits);
     }
   }
   else {
 	switch (kbits) {
-	  case 0: return findOnePattern0(buffer, bufferStart, bufferEnd, startPosition, maxHits);
-	  case 1: return findOnePattern1(buffer, bufferStart, bufferEnd, startPosition, maxHits);
-	  case 2: return findOnePattern2(buffer, bufferStart, bufferEnd, startPosition, maxHits);
+	  case 0: exceeded = findOnePattern0(buffer, bufferStart, bufferEnd, startPosition, maxHits); break;
+	  case 1: exceeded = findOnePattern1(buffer, bufferStart, bufferEnd, startPosition, maxHits); break;
+	  case 2: exceeded = findOnePattern2(buffer, bufferStart, bufferEnd, startPosition, maxHits); break;
 	  //case 3: return findPattern3(buffer, bufferStart, bufferEnd, startPosition, maxHits);
 	  //case 4: return findPattern4(buffer, bufferStart, bufferEnd, startPosition, maxHits);
 	}
   }
-  return false;
+  
+  // with tiers the search is over once even exact matches are too many
+  return exceeded || (tierLimit > 0 && overTier == 0);
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -781,6 +1386,8 @@ bool PrimerSearch::findPattern(char* buffer, int bufferStart, int bufferEnd,
 
 bool PrimerSearch::findPattern0(char* buffer, int bufferStart, int bufferEnd,
                  unsigned int startPosition, int maxHits) {
+  const unsigned long long int forHitBuffer = hitMask(forPrimerLength, revPrimerLength);
+  const unsigned long long int revHitBuffer = hitMask(revPrimerLength, forPrimerLength);
   
   unsigned char fourmer;
 
@@ -804,7 +1411,7 @@ bool PrimerSearch::findPattern0(char* buffer, int bufferStart, int bufferEnd,
 
       // make sure we are still within range 
       int curPosition = startPosition + (i-bufferStart)*4;
-      if (curPosition - forMatches[rightIndex-1] > maxAmpSize) {
+      if (curPosition - forMatches[rightIndex-1] > stackRange) {
         // out of range... reset!
         rightIndex = 0;
         revR[0] = ~(0LLU);
@@ -847,6 +1454,7 @@ bool PrimerSearch::findPattern0(char* buffer, int bufferStart, int bufferEnd,
 
 bool PrimerSearch::findOnePattern0(char* buffer, int bufferStart, int bufferEnd,
                  unsigned int startPosition, int maxHits) {
+  const unsigned long long int forHitBuffer = hitMask(forPrimerLength, forPrimerLength);
 
   unsigned char fourmer;
 
@@ -884,6 +1492,8 @@ bool PrimerSearch::findOnePattern0(char* buffer, int bufferStart, int bufferEnd,
 
 bool PrimerSearch::findPattern1(char* buffer, int bufferStart, int bufferEnd,
                  unsigned int startPosition, int maxHits) {
+  const unsigned long long int forHitBuffer = hitMask(forPrimerLength, revPrimerLength);
+  const unsigned long long int revHitBuffer = hitMask(revPrimerLength, forPrimerLength);
   
   unsigned char fourmer;
   unsigned long long int carry1;
@@ -906,7 +1516,7 @@ bool PrimerSearch::findPattern1(char* buffer, int bufferStart, int bufferEnd,
     // check forward primers for a match
     if (!(!(forHitBuffer & (~forR[1] | mismBits[1])) ||
           !(forHitBuffer & (~forR[1] | mismBits[1]) &
-                              (~forR[0] | mismBits[0] | ~forR[1] & mismBits[1]))
+                              (~forR[0] | mismBits[0] | (~forR[1] & mismBits[1])))
                               )) {
       
       // have a match, add to stack
@@ -919,7 +1529,7 @@ bool PrimerSearch::findPattern1(char* buffer, int bufferStart, int bufferEnd,
 
       // make sure we are still within range 
       int curPosition = startPosition + (i-bufferStart)*4;
-      if (curPosition - forMatches[rightIndex-1] > maxAmpSize) {
+      if (curPosition - forMatches[rightIndex-1] > stackRange) {
         // out of range... reset!
         rightIndex = 0;
         revR[0] = ~(0LLU);
@@ -942,7 +1552,7 @@ bool PrimerSearch::findPattern1(char* buffer, int bufferStart, int bufferEnd,
         // check reverse primers for a match
         if (!(!(revHitBuffer & (~revR[1] | mismBits[1])) ||
           !(revHitBuffer & (~revR[1] | mismBits[1]) &
-                              (~revR[0] | mismBits[0] | ~revR[1] & mismBits[1]))
+                              (~revR[0] | mismBits[0] | (~revR[1] & mismBits[1])))
                               )) {
         
           // have a match, add to matches
@@ -972,6 +1582,7 @@ bool PrimerSearch::findPattern1(char* buffer, int bufferStart, int bufferEnd,
 
 bool PrimerSearch::findOnePattern1(char* buffer, int bufferStart, int bufferEnd,
                  unsigned int startPosition, int maxHits) {
+  const unsigned long long int forHitBuffer = hitMask(forPrimerLength, forPrimerLength);
 
   unsigned char fourmer;
   unsigned long long int carry1;
@@ -994,7 +1605,7 @@ bool PrimerSearch::findOnePattern1(char* buffer, int bufferStart, int bufferEnd,
     // check forward primers for a match
     if (!(!(forHitBuffer & (~forR[1] | mismBits[1])) ||
           !(forHitBuffer & (~forR[1] | mismBits[1]) &
-                              (~forR[0] | mismBits[0] | ~forR[1] & mismBits[1]))
+                              (~forR[0] | mismBits[0] | (~forR[1] & mismBits[1])))
                               )) {
 
       // have a match, add to stack
@@ -1022,6 +1633,8 @@ bool PrimerSearch::findOnePattern1(char* buffer, int bufferStart, int bufferEnd,
 
 bool PrimerSearch::findPattern2(char* buffer, int bufferStart, int bufferEnd,
                  unsigned int startPosition, int maxHits) {
+  const unsigned long long int forHitBuffer = hitMask(forPrimerLength, revPrimerLength);
+  const unsigned long long int revHitBuffer = hitMask(revPrimerLength, forPrimerLength);
 
   unsigned char fourmer;
   unsigned long long int carry1;
@@ -1041,7 +1654,7 @@ bool PrimerSearch::findPattern2(char* buffer, int bufferStart, int bufferEnd,
     carry1     = forR[0] & forParray[0][fourmer];
     forR[0] = forR[0] ^ forParray[0][fourmer];
     
-    carry2     = carry1 & forR[1] | carry1 & forParray[1][fourmer] | forR[1] & forParray[1][fourmer];
+    carry2     = (carry1 & forR[1]) | (carry1 & forParray[1][fourmer]) | (forR[1] & forParray[1][fourmer]);
     forR[1] = carry1 ^ forR[1] ^ forParray[1][fourmer];
     
     forR[2] = carry2 | forR[2] | forParray[2][fourmer];
@@ -1049,10 +1662,10 @@ bool PrimerSearch::findPattern2(char* buffer, int bufferStart, int bufferEnd,
     // check forward primers for a match
     if (!(!(forHitBuffer & (~forR[2] | mismBits[2])) ||
           !(forHitBuffer & (~forR[2] | mismBits[2]) &
-                              (~forR[1] | mismBits[1] | ~forR[2] & mismBits[2])) ||
+                              (~forR[1] | mismBits[1] | (~forR[2] & mismBits[2]))) ||
           !(forHitBuffer & (~forR[2] | mismBits[2]) &
-                              (~forR[1] | mismBits[1] | ~forR[2] & mismBits[2]) &
-                              (~forR[0] | mismBits[0] | ~forR[2] & mismBits[2] | ~forR[1] & mismBits[1]))
+                              (~forR[1] | mismBits[1] | (~forR[2] & mismBits[2])) &
+                              (~forR[0] | mismBits[0] | (~forR[2] & mismBits[2]) | (~forR[1] & mismBits[1])))
                               )) {
       
       // have a match, add to stack
@@ -1065,7 +1678,7 @@ bool PrimerSearch::findPattern2(char* buffer, int bufferStart, int bufferEnd,
       
       // make sure we are still within range 
       int curPosition = startPosition + (i-bufferStart)*4;
-      if (curPosition - forMatches[rightIndex-1] > maxAmpSize) {
+      if (curPosition - forMatches[rightIndex-1] > stackRange) {
         // out of range... reset!
         rightIndex = 0;
         revR[0] = ~(0LLU);
@@ -1088,7 +1701,7 @@ bool PrimerSearch::findPattern2(char* buffer, int bufferStart, int bufferEnd,
         carry1     = revR[0] & revParray[0][fourmer];
         revR[0] = revR[0] ^ revParray[0][fourmer];
     
-        carry2     = carry1 & revR[1] | carry1 & revParray[1][fourmer] | revR[1] & revParray[1][fourmer];
+        carry2     = (carry1 & revR[1]) | (carry1 & revParray[1][fourmer]) | (revR[1] & revParray[1][fourmer]);
         revR[1] = carry1 ^ revR[1] ^ revParray[1][fourmer];
     
         revR[2] = carry2 | revR[2] | revParray[2][fourmer];
@@ -1097,10 +1710,10 @@ bool PrimerSearch::findPattern2(char* buffer, int bufferStart, int bufferEnd,
         // check reverse primers for a match
         if (!(!(revHitBuffer & (~revR[2] | mismBits[2])) ||
           !(revHitBuffer & (~revR[2] | mismBits[2]) &
-                              (~revR[1] | mismBits[1] | ~revR[2] & mismBits[2])) ||
+                              (~revR[1] | mismBits[1] | (~revR[2] & mismBits[2]))) ||
           !(revHitBuffer & (~revR[2] | mismBits[2]) &
-                              (~revR[1] | mismBits[1] | ~revR[2] & mismBits[2]) &
-                              (~revR[0] | mismBits[0] | ~revR[2] & mismBits[2] | ~revR[1] & mismBits[1]))
+                              (~revR[1] | mismBits[1] | (~revR[2] & mismBits[2])) &
+                              (~revR[0] | mismBits[0] | (~revR[2] & mismBits[2]) | (~revR[1] & mismBits[1])))
                               )) {
         
           // have a match, add to matches
@@ -1129,6 +1742,7 @@ bool PrimerSearch::findPattern2(char* buffer, int bufferStart, int bufferEnd,
 
 bool PrimerSearch::findOnePattern2(char* buffer, int bufferStart, int bufferEnd,
                  unsigned int startPosition, int maxHits) {
+  const unsigned long long int forHitBuffer = hitMask(forPrimerLength, forPrimerLength);
 
   unsigned char fourmer;
   unsigned long long int carry1;
@@ -1148,7 +1762,7 @@ bool PrimerSearch::findOnePattern2(char* buffer, int bufferStart, int bufferEnd,
     carry1     = forR[0] & forParray[0][fourmer];
     forR[0] = forR[0] ^ forParray[0][fourmer];
 
-    carry2     = carry1 & forR[1] | carry1 & forParray[1][fourmer] | forR[1] & forParray[1][fourmer];
+    carry2     = (carry1 & forR[1]) | (carry1 & forParray[1][fourmer]) | (forR[1] & forParray[1][fourmer]);
     forR[1] = carry1 ^ forR[1] ^ forParray[1][fourmer];
 
     forR[2] = carry2 | forR[2] | forParray[2][fourmer];
@@ -1156,10 +1770,10 @@ bool PrimerSearch::findOnePattern2(char* buffer, int bufferStart, int bufferEnd,
     // check forward primers for a match
     if (!(!(forHitBuffer & (~forR[2] | mismBits[2])) ||
           !(forHitBuffer & (~forR[2] | mismBits[2]) &
-                              (~forR[1] | mismBits[1] | ~forR[2] & mismBits[2])) ||
+                              (~forR[1] | mismBits[1] | (~forR[2] & mismBits[2]))) ||
           !(forHitBuffer & (~forR[2] | mismBits[2]) &
-                              (~forR[1] | mismBits[1] | ~forR[2] & mismBits[2]) &
-                              (~forR[0] | mismBits[0] | ~forR[2] & mismBits[2] | ~forR[1] & mismBits[1]))
+                              (~forR[1] | mismBits[1] | (~forR[2] & mismBits[2])) &
+                              (~forR[0] | mismBits[0] | (~forR[2] & mismBits[2]) | (~forR[1] & mismBits[1])))
                               )) {
 
       // have a match, add to stack
@@ -1187,6 +1801,8 @@ bool PrimerSearch::findOnePattern2(char* buffer, int bufferStart, int bufferEnd,
 
 bool PrimerSearch::findPattern3(char* buffer, int bufferStart, int bufferEnd,
                  unsigned int startPosition, int maxHits) {
+  const unsigned long long int forHitBuffer = hitMask(forPrimerLength, revPrimerLength);
+  const unsigned long long int revHitBuffer = hitMask(revPrimerLength, forPrimerLength);
   
   unsigned char fourmer;
   unsigned long long int carry1;
@@ -1209,10 +1825,10 @@ bool PrimerSearch::findPattern3(char* buffer, int bufferStart, int bufferEnd,
     carry1     = forR[0] & forParray[0][fourmer];
     forR[0] = forR[0] ^ forParray[0][fourmer];
     
-    carry2     = carry1 & forR[1] | carry1 & forParray[1][fourmer] | forR[1] & forParray[1][fourmer];
+    carry2     = (carry1 & forR[1]) | (carry1 & forParray[1][fourmer]) | (forR[1] & forParray[1][fourmer]);
     forR[1] = carry1 ^ forR[1] ^ forParray[1][fourmer];
     
-    carry3     = carry2 & forR[2] | carry2 & forParray[2][fourmer] | forR[2] & forParray[2][fourmer];
+    carry3     = (carry2 & forR[2]) | (carry2 & forParray[2][fourmer]) | (forR[2] & forParray[2][fourmer]);
     forR[2] = carry2 ^ forR[2] ^ forParray[2][fourmer];
 
     forR[3] = forR[3] | carry3 | forParray[3][fourmer];
@@ -1220,14 +1836,14 @@ bool PrimerSearch::findPattern3(char* buffer, int bufferStart, int bufferEnd,
     // check forward primers for a match
     if (!(!(forHitBuffer & (~forR[3] | mismBits[3])) ||
           !(forHitBuffer & (~forR[3] | mismBits[3]) &
-                              (~forR[2] | mismBits[2] | ~forR[3] & mismBits[3])) ||
+                              (~forR[2] | mismBits[2] | (~forR[3] & mismBits[3]))) ||
           !(forHitBuffer & (~forR[3] | mismBits[3]) &
-                              (~forR[2] | mismBits[2] | ~forR[3] & mismBits[3]) &
-                              (~forR[1] | mismBits[1] | ~forR[3] & mismBits[3] | ~forR[2] & mismBits[2])) ||
+                              (~forR[2] | mismBits[2] | (~forR[3] & mismBits[3])) &
+                              (~forR[1] | mismBits[1] | (~forR[3] & mismBits[3]) | (~forR[2] & mismBits[2]))) ||
           !(forHitBuffer & (~forR[3] | mismBits[3]) &
-                              (~forR[2] | mismBits[2] | ~forR[3] & mismBits[3]) &
-                              (~forR[1] | mismBits[1] | ~forR[3] & mismBits[3] | ~forR[2] & mismBits[2]) &
-                              (~forR[0] | mismBits[0] | ~forR[3] & mismBits[3] | ~forR[2] & mismBits[2] | ~forR[1] & mismBits[1]))
+                              (~forR[2] | mismBits[2] | (~forR[3] & mismBits[3])) &
+                              (~forR[1] | mismBits[1] | (~forR[3] & mismBits[3]) | (~forR[2] & mismBits[2])) &
+                              (~forR[0] | mismBits[0] | (~forR[3] & mismBits[3]) | (~forR[2] & mismBits[2]) | (~forR[1] & mismBits[1])))
                               
                               )) {
       
@@ -1241,7 +1857,7 @@ bool PrimerSearch::findPattern3(char* buffer, int bufferStart, int bufferEnd,
       
       // make sure we are still within range 
       int curPosition = startPosition + (i-bufferStart)*4;
-      if (curPosition - forMatches[rightIndex-1] > maxAmpSize) {
+      if (curPosition - forMatches[rightIndex-1] > stackRange) {
         // out of range... reset!
         rightIndex = 0;
         revR[0] = ~(0LLU);
@@ -1264,10 +1880,10 @@ bool PrimerSearch::findPattern3(char* buffer, int bufferStart, int bufferEnd,
         carry1     = revR[0] & revParray[0][fourmer];
         revR[0] = revR[0] ^ revParray[0][fourmer];
     
-        carry2     = carry1 & revR[1] | carry1 & revParray[1][fourmer] | revR[1] & revParray[1][fourmer];
+        carry2     = (carry1 & revR[1]) | (carry1 & revParray[1][fourmer]) | (revR[1] & revParray[1][fourmer]);
         revR[1] = carry1 ^ revR[1] ^ revParray[1][fourmer];
     
-        carry3     = carry2 & revR[2] | carry2 & revParray[2][fourmer] | revR[2] & revParray[2][fourmer];
+        carry3     = (carry2 & revR[2]) | (carry2 & revParray[2][fourmer]) | (revR[2] & revParray[2][fourmer]);
         revR[2] = carry2 ^ revR[2] ^ revParray[2][fourmer];
 
         revR[3] = revR[3] | carry3 | revParray[3][fourmer];
@@ -1276,14 +1892,14 @@ bool PrimerSearch::findPattern3(char* buffer, int bufferStart, int bufferEnd,
         // check reverse primers for a match
         if (!(!(revHitBuffer & (~revR[3] | mismBits[3])) ||
           !(revHitBuffer & (~revR[3] | mismBits[3]) &
-                              (~revR[2] | mismBits[2] | ~revR[3] & mismBits[3])) ||
+                              (~revR[2] | mismBits[2] | (~revR[3] & mismBits[3]))) ||
           !(revHitBuffer & (~revR[3] | mismBits[3]) &
-                              (~revR[2] | mismBits[2] | ~revR[3] & mismBits[3]) &
-                              (~revR[1] | mismBits[1] | ~revR[3] & mismBits[3] | ~revR[2] & mismBits[2])) ||
+                              (~revR[2] | mismBits[2] | (~revR[3] & mismBits[3])) &
+                              (~revR[1] | mismBits[1] | (~revR[3] & mismBits[3]) | (~revR[2] & mismBits[2]))) ||
           !(revHitBuffer & (~revR[3] | mismBits[3]) &
-                              (~revR[2] | mismBits[2] | ~revR[3] & mismBits[3]) &
-                              (~revR[1] | mismBits[1] | ~revR[3] & mismBits[3] | ~revR[2] & mismBits[2]) &
-                              (~revR[0] | mismBits[0] | ~revR[3] & mismBits[3] | ~revR[2] & mismBits[2] | ~revR[1] & mismBits[1]))
+                              (~revR[2] | mismBits[2] | (~revR[3] & mismBits[3])) &
+                              (~revR[1] | mismBits[1] | (~revR[3] & mismBits[3]) | (~revR[2] & mismBits[2])) &
+                              (~revR[0] | mismBits[0] | (~revR[3] & mismBits[3]) | (~revR[2] & mismBits[2]) | (~revR[1] & mismBits[1])))
                               
                               )) {
         
@@ -4,10 +4,15 @@
 #include <iostream>
 #include <algorithm>
 #include <string>
+#include <vector>
+#include <map>
 #include "Properties.h"
 #include "PrimerPair.h"
 #include "PrimingSite.h"
 #include "WeightMatrix.h"
+#include "RunStats.h"
+#include "PerfCounters.h"
+#include "AmbiguityTable.h"
 
 /////////////////////////////////////////////////////////////////////////////////
 // Copyright (C) 2007 Affymetrix, Inc.                                         //
@@ -28,6 +33,18 @@
 // 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA                       // 
 /////////////////////////////////////////////////////////////////////////////////
 
+// a site as it passed the filters of the seq it was found in, and whether
+// the search checked -M right after it
+struct SiteCall {
+  unsigned int forPos;
+  unsigned int revPos;
+  PrimerDirection forDir;
+  PrimerDirection revDir;
+  unsigned int forScore;
+  unsigned int revScore;
+  bool check;
+};
+
 ///////////////////////////////////////////////////////////////////////////////
 // PrimerSearch                                                              //
 // - The main workhorse which searches with one primer pair against a seq db //                                                  
@@ -37,7 +54,7 @@ class PrimerSearch {
   public:
 
     PrimerSearch(PrimerPair *pp, WeightMatrix *wm, bool cNoRevC, bool noSelfSelf, double minF, double maxF, int minA, int maxA, int ckmm);
-    static char* bits2chars(unsigned int pat);
+    ~PrimerSearch();
     unsigned long char2bits(char *pattern);
     void reset(char* cSeqName);
     void setupMismatchVectors();
@@ -45,35 +62,60 @@ class PrimerSearch {
                  unsigned int startPosition, int maxHits);
     int getMatchCount();
     int getNoRevC();
+    unsigned int getMaxAmpSize();
     int getWeight(PrimerDirection primer, int p5, int p3, char b1, char b2);
     
     PrimingSite *getPrimingSite(int mc);             
+    int getFirstSite();
+    void setCountOnly(bool cCountOnly);
+    void setTierLimit(int cTierLimit);
+    void setAmbiguities(const std::vector<BaseRun> *cAmbRuns);
+    const std::vector<BaseRun> *getAmbiguities();
+    void setKeepAmbiguous(bool cKeepAmbiguous);
+    void setMask(const std::vector<BaseRun> *cMaskRuns);
+    const std::vector<BaseRun> *getMask();
+    void setMaskRule(bool cSkipMasked, unsigned int cMaskPenalty);
+    void setRegions(const std::vector<BaseRun> *cRegionRuns);
+    void setSiteLog(std::vector<SiteCall> *cSiteLog);
+    bool replaySites(const std::vector<SiteCall> &calls, unsigned int first, unsigned int end, int maxHits);
+    int getTierCount(unsigned int tier);
+    void releaseSites(int upTo);
     PrimerPair* getPrimerPair();
+    SearchStats &getStats();
     
     static std::string reverseComplement(std::string primer);
     static std::string complement(std::string);
     static char complement(char base);
     
     static char* convertToSequence(char *cBuffer, int sBufferSize, int start, int size);
+    static void decodeBases(const char *cBuffer, int sBufferSize, int bStart, int offset, int length, char *sequence);
     
   private:
-    void createPatternArray(PrimerDirection primer1, PrimerDirection primer2, PrimerEnd dir, bool isComp1, bool isComp2, std::string pattern1, std::string pattern2, unsigned long long patternArray[][NFOURMERS]);
-    unsigned int countMismatches(PrimerDirection primer, PrimerEnd dir, bool isComp, std::string pattern, char* fourmer, int start, int stop); 
+    // the search owns its priming sites, so it is never copied
+    PrimerSearch(const PrimerSearch &);
+    PrimerSearch &operator=(const PrimerSearch &);
+    
+    static const char *fourmerTable();
+    
+    void createPatternArray(PrimerDirection primer1, PrimerDirection primer2, PrimerEnd dir1, PrimerEnd dir2, bool isComp1, bool isComp2, std::string pattern1, std::string pattern2, unsigned long long patternArray[][NFOURMERS]);
+    void weightRows(PrimerDirection primer, PrimerEnd dir, bool isComp, const std::string &pattern, int rows[][NBASES]);
+    void addPatternBits(PrimerDirection primer, PrimerEnd dir, bool isComp, const std::string &pattern, int offset, unsigned long long patternArray[][NFOURMERS]);
   
     PrimerPair *primerPair;
     WeightMatrix *weights;
     unsigned long forMatches[MATCH_BUFFER]; // P64 - Remove strand
     PrimerDirection forMatchDir[MATCH_BUFFER]; // was 5' match the FOR or REV primer?
-    PrimingSite *matchLocations[MAX_MATCHES]; 
+    unsigned int forMatchScore[MATCH_BUFFER]; // mismatch score of the 5' match
+    PrimingSite *matchLocations[MAX_MATCHES]; // sites from siteBase on
     int rightIndex; // P64 - remove strand
     int matchCount; // number of matches so far
+    int siteBase; // number of matches already released
     int noRevC;
     bool noSelfSelf;
+    SearchStats stats;
    
     unsigned long long int forR[MAX_BITS]; //primer pair, state, mm // P64 - Remove strand
     unsigned long long int revR[MAX_BITS];
-    unsigned long long int forHitBuffer; // P64 - Remove strand
-    unsigned long long int revHitBuffer;
     unsigned long long int mismBits[MAX_BITS];
     unsigned int forPrimerLength;
     unsigned int revPrimerLength;
@@ -84,6 +126,7 @@ class PrimerSearch {
     // amplicon characteristics
     unsigned int minAmpSize;
     unsigned int maxAmpSize;
+    unsigned int stackRange; // maxAmpSize plus slack for stack order
      
     // number mismatches allowed
     unsigned int kmm; 
@@ -93,18 +136,102 @@ class PrimerSearch {
      
     // current seq being searched
     char seqName[MAX_SEQNAME_SIZE];     
+    unsigned int seqId; // index+1 of seqName in seqNames, 0 until its first site
+    std::map<std::string, unsigned int> seqIds;
+    std::vector<std::string> seqNames;
+    
+    // sites seen so far (open addressing, seq 0 = empty slot) so the
+    // duplicate check does not have to walk every previous site
+    struct SiteKey {
+      unsigned int seq;
+      unsigned int forPos;
+      unsigned int revPos;
+    };
+    std::vector<SiteKey> siteTable;
+    unsigned int siteTableUsed;
+    
+    // count-only searches keep just the last CACHE_SIZE sites (enough to
+    // seed the hit cache) and build PrimingSites for them on request
+    bool countOnly;
+    SiteKey recentSites[CACHE_SIZE];
+    PrimerDirection recentDirs[CACHE_SIZE][NDIRS];
+    unsigned int recentScores[CACHE_SIZE][NDIRS];
+    PrimingSite *recentRecords[CACHE_SIZE];
+    int recentIndex[CACHE_SIZE]; // site number held in recentRecords
+    
+    // --tiers - new sites by score (the worse of the two primers).  Sites
+    // from overTier up are dropped, since that tier already has more than
+    // tierLimit hits (and so do all above it).
+    int tierLimit; // 0 when not counting tiers
+    int tierCounts[MAX_TIERS];
+    unsigned int overTier;
+    
+    // ambiguous bases of the current seq (NULL when it has none).  Runs of
+    // AMB_SKIP_RUN or more are not scanned, and sites with a primer over
+    // an ambiguous base are dropped unless keepAmbiguous is set.
+    const std::vector<BaseRun> *ambRuns;
+    bool keepAmbiguous;
+    
+    // masked bases of the current seq (NULL when none).  With skipMasked
+    // their whole bytes are not scanned and sites over them are dropped,
+    // otherwise maskPenalty is added to the score of each primer over them.
+    const std::vector<BaseRun> *maskRuns;
+    bool skipMasked;
+    unsigned int maskPenalty;
+    
+    // --regions intervals of the current seq (NULL to keep every site) -
+    // sites whose amplicon overlaps none of them are dropped
+    const std::vector<BaseRun> *regionRuns;
+    
+    // sites of the seq being searched, for its copies (NULL when it has none)
+    std::vector<SiteCall> *siteLog;
+    inline void markCheck() {
+      if (siteLog != NULL && !siteLog->empty()) {
+        siteLog->back().check = true;
+      }
+    }
   
     // pattern arrays
     unsigned long long int forParray[MAX_BITS][NFOURMERS];
     unsigned long long int revParray[MAX_BITS][NFOURMERS];
     
+    // the bits to watch to see if we have a hit - the last 4 positions of
+    // the pattern in the low and high halves
+    static inline unsigned long long int hitMask(unsigned int lowLength, unsigned int highLength) {
+      return (15LLU << (lowLength-1)) | (15LLU << (highLength-1 + 32));
+    }
+    
+    // mismatch score held in the bit planes at one register bit
+    inline unsigned int planeScore(const unsigned long long int planes[], unsigned int bit) {
+      unsigned int score = 0;
+      for (unsigned int j=0; j <= kbits; j++) {
+        score |= ((planes[j] >> bit) & 1) << j;
+      }
+      return score;
+    }
+    
     inline void forMatch(unsigned int position);
     inline bool forOneMatch(unsigned int position, int maxHits);
     inline bool revMatch(unsigned int position, int maxHits);
-    inline void addPrimingSite(unsigned int forPos, unsigned int revPos, PrimerDirection forDir, PrimerDirection revDir);
+    inline void addPrimingSite(unsigned int forPos, unsigned int revPos, PrimerDirection forDir, PrimerDirection revDir,
+                               unsigned int forScore, unsigned int revScore);
+    inline void keepSite(unsigned int forPos, unsigned int revPos, PrimerDirection forDir, PrimerDirection revDir,
+                         unsigned int forScore, unsigned int revScore);
+    void internSeqName();
+    inline bool insertSite(unsigned int forPos, unsigned int revPos);
+    void countTier(unsigned int tier);
+    void growSiteTable();
     inline int getBasecode(char base);
     
+    inline unsigned int primerLength(PrimerDirection dir);
+    inline bool fivePrimeOver(const std::vector<BaseRun> &runs, unsigned int forPos, PrimerDirection forDir);
+    inline bool threePrimeOver(const std::vector<BaseRun> &runs, unsigned int revPos, PrimerDirection revDir);
+    
     // pattern finding for different k
+    bool scanRange(char* buffer, int bufferStart, int bufferEnd,
+                   unsigned int startPosition, int maxHits);
+    bool runKernel(char* buffer, int bufferStart, int bufferEnd,
+                   unsigned int startPosition, int maxHits);
     bool findPattern0(char* buffer, int bufferStart, int bufferEnd,
                       unsigned int startPosition, int maxHits);
     bool findOnePattern0(char* buffer, int bufferStart, int bufferEnd,
@@ -78,6 +78,14 @@ int PrimingSite::getStrand() {
   return strand;
 }
 
+int PrimingSite::getForScore() {
+  return forScore;
+}
+
+int PrimingSite::getRevScore() {
+  return revScore;
+}
+
 char *PrimingSite::getSeqName() {
   return seqName;
 }
@@ -38,6 +38,8 @@ class PrimingSite{
     PrimerDirection getForDir();
     PrimerDirection getRevDir();
     int getStrand();
+    int getForScore();
+    int getRevScore();
     char *getSeqName();
     
   private:
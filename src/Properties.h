@@ -37,6 +37,12 @@ const unsigned int BUFFERSIZE = 2000000; // sequence buffer size
 const int CACHE_SIZE = 20; // size of cache used to hold previous hits
 const int MAX_SEQNAME_SIZE = 256; // size of seq names in pgrep db
 const int MAX_AMP_SIZE = 50000; // max allowed size of amplicon
+const int OUTPUT_BUFFER = 1 << 20; // full output is formatted into a buffer and written about this much at a time
+const unsigned int HIT_BLOCK = 256; // hits per region index block in binary full output (--format=bin)
+const unsigned int AMB_SKIP_RUN = 100; // ambiguous runs (N gaps) at least this long are not scanned
+const int GROUP_BATCH = 64; // primer pairs searched together in one pass over the db (--groups)
+const unsigned int GROUP_SLICE = 1 << 16; // bytes each pair of a --groups batch scans in turn, so they stay in cache
+const unsigned int BEST_SLICE = 1 << 12; // bytes a --best search scans between releasing its hits, so it never fills MAX_MATCHES
 
 const int NBASES = 4;
 
@@ -50,9 +56,12 @@ const int NDNASTRANDS = 2; // two pairs used to search - PS and MS
 
 const unsigned int NFOURMERS = 256; // number of fourmers = 4^4
 const int MAX_BITS = 6; // (MB+1) allow mismatch scores up to 2^5 - 1 = 31
+const int MAX_TIERS = 1 << (MAX_BITS-1); // one --tiers count per possible mismatch score
 
 const int MATCH_BUFFER = 4096;
 const int MAX_MATCHES = 20000; // max number of matches we can return for any one primer pair  
+const unsigned int SITE_TABLE_START = 64; // starting size of the hash of sites found (a power of 2)
+const int QMER_EXCESS = 16; // 3' anchor hits (above background) allowed per primer hit before a pair is deferred
  
 
 #endif // PROPERTIES_H__ 
@@ -0,0 +1,226 @@
+#include "QmerTable.h"
+#include <iostream>
+#include <fstream>
+#include <string.h>
+#include <stdlib.h>
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+/////////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2007 Affymetrix, Inc.                                         //
+//                                                                             //
+// This program is free software; you can redistribute it and/or modify        //
+// it under the terms of the GNU General Public License (version 2) as         //
+// published by the Free Software Foundation.                                  //
+//                                                                             //
+// This program is distributed in the hope that it will be useful,             //
+// but WITHOUT ANY WARRANTY; without even the implied warranty of              // 
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU            //
+// General Public License for more details.                                    //
+//                                                                             //
+// You should have received a copy of the GNU General Public License           //
+// along with this program;if not, write to the                                //
+//                                                                             //
+// Free Software Foundation, Inc.,                                             //
+// 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA                       // 
+/////////////////////////////////////////////////////////////////////////////////
+
+static const char QMER_MAGIC[8] = {'P','G','Q','M','R','0','1','\0'};
+static const int QMER_HEADER_SIZE = sizeof(QMER_MAGIC) + 2*sizeof(int) + sizeof(unsigned long long);
+
+///////////////////////////////////////////////////////////////////////////////
+// QmerTable (constructor/destructor)                                        //
+//    desc: an empty table.  Use build() or load() to fill it.               //
+///////////////////////////////////////////////////////////////////////////////  
+
+QmerTable::QmerTable() {
+  qmerLength = 0;
+  totalBases = 0;
+  counts = NULL;
+  mapBase = NULL;
+  mapSize = 0;
+}
+
+QmerTable::~QmerTable() {
+#ifndef _WIN32
+  if (mapBase != NULL) {
+    munmap(mapBase, mapSize);
+  }
+#endif
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// accessors                                                                 //
+///////////////////////////////////////////////////////////////////////////////  
+
+int QmerTable::getQmerLength() {
+  return qmerLength;
+}
+
+unsigned long long QmerTable::tableSize() {
+  return 1LLU << (2*qmerLength);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// getBackground                                                             //
+//  inputs: none                                                             //
+//  output: expected count of a random q-mer in this db <double>             //
+///////////////////////////////////////////////////////////////////////////////  
+
+double QmerTable::getBackground() {
+  return (2.0 * totalBases) / tableSize();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// build                                                                     //
+//  inputs: sequence dbs <vector SequenceDb*>, q-mer length <int>            //
+//  output: none                                                             //
+//    desc: counts every q-mer and its reverse complement                    //
+///////////////////////////////////////////////////////////////////////////////  
+
+void QmerTable::build(std::vector<SequenceDb*> &dbs, int cQmerLength) {
+  if (cQmerLength < MIN_QMER || cQmerLength > MAX_QMER) {
+    std::cerr << "ERROR:  q-mer length must be between " << MIN_QMER << " and " << MAX_QMER << ".\n";
+    exit(1);
+  }
+  qmerLength = cQmerLength;
+  totalBases = 0;
+  builtCounts.assign(tableSize(), 0);
+  counts = &builtCounts[0];
+  
+  unsigned long long mask = tableSize() - 1;
+  int rcShift = 2*(qmerLength-1);
+  for (unsigned int d=0; d < dbs.size(); ++d) {
+    for (int s=0; s < dbs[d]->getSeqCount(); ++s) {
+      unsigned int nbytes = dbs[d]->getSeqSize(s);
+      std::vector<char> buffer(nbytes + 1);
+      dbs[d]->readSeq(s, 0, nbytes, &buffer[0]);
+      
+      unsigned long long code = 0;
+      unsigned long long rc = 0;
+      unsigned long long nbases = (unsigned long long) nbytes * 4;
+      for (unsigned long long b=0; b < nbases; ++b) {
+        unsigned long long base = (((unsigned char) buffer[b/4]) >> (6 - 2*(b%4))) & 3;
+        code = ((code << 2) | base) & mask;
+        rc = (rc >> 2) | ((3 - base) << rcShift);
+        if (b + 1 >= (unsigned long long) qmerLength) {
+          if (counts[code] < QMER_CAP) ++counts[code];
+          if (counts[rc] < QMER_CAP) ++counts[rc];
+        }
+      }
+      totalBases += nbases;
+    }
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// write                                                                     //
+//  inputs: table filename <std::string>                                     //
+//  output: none                                                             //
+//    desc: table file format:                                               //
+//            magic[8], q, unused (ints), db bases <uns long long>           //
+//            4^q counts (uns char), indexed by the 2-bit q-mer code         //
+///////////////////////////////////////////////////////////////////////////////  
+
+void QmerTable::write(std::string filename) {
+  std::ofstream tableFile(filename.c_str(), std::ios::out | std::ios::binary);
+  if (!tableFile.is_open()) {
+    std::cerr << "Error opening q-mer table file for writing: " << filename << "\n";
+    exit(1);
+  }
+  
+  int unused = 0;
+  tableFile.write(QMER_MAGIC, sizeof(QMER_MAGIC));
+  tableFile.write((char*)&qmerLength, sizeof(int));
+  tableFile.write((char*)&unused, sizeof(int));
+  tableFile.write((char*)&totalBases, sizeof(unsigned long long));
+  tableFile.write((char*)counts, tableSize());
+  tableFile.close();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// load                                                                      //
+//  inputs: table filename <std::string>                                     //
+//  output: none                                                             //
+//    desc: maps the table file into memory so only the pages that are       //
+//          looked up are ever read.  Without mmap the counts are read in.   //
+///////////////////////////////////////////////////////////////////////////////  
+
+void QmerTable::load(std::string filename) {
+  std::ifstream tableFile(filename.c_str(), std::ios::in | std::ios::binary);
+  if (!tableFile.is_open()) {
+    std::cerr << "Error opening q-mer table file: " << filename << "\n";
+    exit(1);
+  }
+  
+  char magic[sizeof(QMER_MAGIC)];
+  int unused;
+  tableFile.read(magic, sizeof(QMER_MAGIC));
+  if (!tableFile || memcmp(magic, QMER_MAGIC, sizeof(QMER_MAGIC)) != 0) {
+    std::cerr << "Error: " << filename << " is not a pgrep q-mer table.\n";
+    exit(1);
+  }
+  tableFile.read((char*)&qmerLength, sizeof(int));
+  tableFile.read((char*)&unused, sizeof(int));
+  tableFile.read((char*)&totalBases, sizeof(unsigned long long));
+  if (!tableFile || qmerLength < MIN_QMER || qmerLength > MAX_QMER) {
+    std::cerr << "Error: Bad q-mer table header: " << filename << "\n";
+    exit(1);
+  }
+  tableFile.seekg(0, std::ios::end);
+  if ((unsigned long long) tableFile.tellg() < QMER_HEADER_SIZE + tableSize()) {
+    std::cerr << "Error: Truncated q-mer table file: " << filename << "\n";
+    exit(1);
+  }
+  
+#ifndef _WIN32
+  int fd = open(filename.c_str(), O_RDONLY);
+  if (fd >= 0) {
+    mapSize = QMER_HEADER_SIZE + tableSize();
+    void *base = mmap(NULL, mapSize, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base != MAP_FAILED) {
+      mapBase = base;
+      counts = (unsigned char*) mapBase + QMER_HEADER_SIZE;
+      return;
+    }
+  }
+#endif
+
+  builtCounts.resize(tableSize());
+  tableFile.clear();
+  tableFile.seekg(QMER_HEADER_SIZE, std::ios::beg);
+  tableFile.read((char*)&builtCounts[0], tableSize());
+  counts = &builtCounts[0];
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// anchorCount                                                               //
+//  inputs: primer sequence <std::string>                                    //
+//  output: db count of the primer's 3'-end q-mer <int>                      //
+//    desc: -1 when the primer is too short or has ambiguous 3' bases        //
+///////////////////////////////////////////////////////////////////////////////  
+
+int QmerTable::anchorCount(std::string primer) {
+  int start = primer.length() - qmerLength;
+  if (counts == NULL || start < 0) {
+    return -1;
+  }
+  
+  unsigned long long code = 0;
+  for (unsigned int i=start; i < primer.length(); ++i) {
+    code <<= 2;
+    switch (primer[i]) {
+      case 'A': break;
+      case 'C': code |= 1; break;
+      case 'G': code |= 2; break;
+      case 'T': code |= 3; break;
+      default: return -1;
+    }
+  }
+  return counts[code];
+}
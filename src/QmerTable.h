@@ -0,0 +1,62 @@
+#ifndef QMERTABLE_H__
+#define QMERTABLE_H__
+
+#include <string>
+#include <vector>
+#include "Properties.h"
+#include "SequenceDb.h"
+
+/////////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2007 Affymetrix, Inc.                                         //
+//                                                                             //
+// This program is free software; you can redistribute it and/or modify        //
+// it under the terms of the GNU General Public License (version 2) as         //
+// published by the Free Software Foundation.                                  //
+//                                                                             //
+// This program is distributed in the hope that it will be useful,             //
+// but WITHOUT ANY WARRANTY; without even the implied warranty of              // 
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU            //
+// General Public License for more details.                                    //
+//                                                                             //
+// You should have received a copy of the GNU General Public License           //
+// along with this program;if not, write to the                                //
+//                                                                             //
+// Free Software Foundation, Inc.,                                             //
+// 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA                       // 
+/////////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+// QmerTable                                                                 //
+// - Occurrence count of every q-mer in a sequence db (both strands),        //
+//   saturating at QMER_CAP.  Used to spot primers whose 3' end is too       //
+//   common before spending a scan on them.  Tables are built once per db    //
+//   by pgrep-map and memory mapped by pgrep.                                //
+///////////////////////////////////////////////////////////////////////////////  
+
+class QmerTable {
+  public:
+    QmerTable();
+    ~QmerTable();
+    void build(std::vector<SequenceDb*> &dbs, int cQmerLength);
+    void write(std::string filename);
+    void load(std::string filename);
+    int anchorCount(std::string primer);
+    double getBackground();
+    int getQmerLength();
+    
+    static const int QMER_CAP = 255;
+    static const int MIN_QMER = 8;
+    static const int MAX_QMER = 14; // 4^14 bytes = 256 Mb
+    
+  private:
+    unsigned long long tableSize();
+  
+    int qmerLength;
+    unsigned long long totalBases; // bases in the db, used for the background rate
+    unsigned char *counts;         // points into builtCounts or the mapped file
+    std::vector<unsigned char> builtCounts;
+    void *mapBase;
+    unsigned long long mapSize;
+};
+
+#endif // QMERTABLE_H__
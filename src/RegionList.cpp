@@ -0,0 +1,194 @@
+#include "RegionList.h"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <limits.h>
+#include <stdlib.h>
+
+/////////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2007 Affymetrix, Inc.                                         //
+//                                                                             //
+// This program is free software; you can redistribute it and/or modify        //
+// it under the terms of the GNU General Public License (version 2) as         //
+// published by the Free Software Foundation.                                  //
+//                                                                             //
+// This program is distributed in the hope that it will be useful,             //
+// but WITHOUT ANY WARRANTY; without even the implied warranty of              // 
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU            //
+// General Public License for more details.                                    //
+//                                                                             //
+// You should have received a copy of the GNU General Public License           //
+// along with this program;if not, write to the                                //
+//                                                                             //
+// Free Software Foundation, Inc.,                                             //
+// 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA                       // 
+/////////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+// RegionList (constructor)                                                  //
+//    desc: an empty list, which selects nothing until a file is loaded      //
+///////////////////////////////////////////////////////////////////////////////  
+
+RegionList::RegionList() {
+  haveBed = false;
+  haveSeqs = false;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// firstWord                                                                 //
+//  inputs: db sequence name <char*>                                         //
+//  output: the name up to the first space or tab <std::string>              //
+///////////////////////////////////////////////////////////////////////////////  
+
+std::string RegionList::firstWord(const char *seqName) {
+  std::string name(seqName);
+  return name.substr(0, name.find_first_of(" \t"));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// loadBed                                                                   //
+//  inputs: BED filename <std::string>                                       //
+//  output: none                                                             //
+//    desc: reads chrom, start and end (0-based, end exclusive) from each    //
+//          line.  Other columns, comments, track and browser lines are      //
+//          ignored.                                                         //
+///////////////////////////////////////////////////////////////////////////////  
+
+static bool byStart(const BaseRun &run1, const BaseRun &run2) {
+  return run1.start < run2.start;
+}
+
+void RegionList::loadBed(std::string filename) {
+  std::ifstream bedFile(filename.c_str());
+  if (!bedFile.is_open()) {
+    std::cerr << "ERROR:  Could not open regions file [" << filename << "].\n";
+    exit(1);
+  }
+  
+  std::string line;
+  while (std::getline(bedFile, line)) {
+    if (line.length() > 0 && line[line.length()-1] == '\r') {
+      line.erase(line.length()-1);
+    }
+    if (line.find_first_not_of(" \t") == std::string::npos || line[0] == '#' ||
+        line.compare(0, 5, "track") == 0 || line.compare(0, 7, "browser") == 0) {
+      continue;
+    }
+    std::istringstream fields(line);
+    std::string chrom;
+    long long start = -1;
+    long long end = -1;
+    fields >> chrom >> start >> end;
+    if (!fields || start < 0 || end <= start || end > UINT_MAX) {
+      std::cerr << "ERROR:  Bad line in regions file [" << filename << "]: " << line << "\n";
+      exit(1);
+    }
+    BaseRun run = {(unsigned int) start, (unsigned int) (end - start)};
+    regions[chrom].push_back(run);
+  }
+  
+  // sort and merge, so each seq's regions can be walked in order
+  for (std::map<std::string, std::vector<BaseRun> >::iterator r = regions.begin(); r != regions.end(); ++r) {
+    std::vector<BaseRun> &runs = r->second;
+    std::sort(runs.begin(), runs.end(), byStart);
+    std::vector<BaseRun> merged;
+    for (unsigned int i=0; i < runs.size(); ++i) {
+      if (!merged.empty() && runs[i].start <= merged.back().start + merged.back().length) {
+        merged.back().length = std::max(merged.back().length, runs[i].start + runs[i].length - merged.back().start);
+      }
+      else {
+        merged.push_back(runs[i]);
+      }
+    }
+    runs.swap(merged);
+  }
+  haveBed = true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// loadSeqList                                                               //
+//  inputs: sequence list filename <std::string>                             //
+//  output: none                                                             //
+//    desc: one sequence name per line (only the first word is used)         //
+///////////////////////////////////////////////////////////////////////////////  
+
+void RegionList::loadSeqList(std::string filename) {
+  std::ifstream listFile(filename.c_str());
+  if (!listFile.is_open()) {
+    std::cerr << "ERROR:  Could not open sequence list file [" << filename << "].\n";
+    exit(1);
+  }
+  
+  std::string line;
+  while (std::getline(listFile, line)) {
+    std::istringstream fields(line);
+    std::string name;
+    if (fields >> name) {
+      seqs.insert(name);
+    }
+  }
+  haveSeqs = true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// getByteRanges                                                             //
+//  inputs: db sequence name <char*>, packed size of the seq <uns int>,      //
+//          padding in bases <uns int>, ranges to fill <vector BaseRun>      //
+//  output: none                                                             //
+//    desc: the packed bytes of the seq to scan, as (first byte, number of   //
+//          bytes) runs.  Each region is padded on both sides so that any    //
+//          amplicon overlapping it is scanned whole; padded regions that    //
+//          meet are merged.  Empty if the seq is not selected.              //
+///////////////////////////////////////////////////////////////////////////////  
+
+void RegionList::getByteRanges(const char *seqName, unsigned int seqBytes, unsigned int pad, std::vector<BaseRun> &ranges) {
+  ranges.clear();
+  std::string name = firstWord(seqName);
+  if (haveSeqs && seqs.find(name) == seqs.end()) {
+    return;
+  }
+  if (!haveBed) {
+    BaseRun whole = {0, seqBytes};
+    if (seqBytes > 0) {
+      ranges.push_back(whole);
+    }
+    return;
+  }
+  
+  std::map<std::string, std::vector<BaseRun> >::iterator found = regions.find(name);
+  if (found == regions.end()) {
+    return;
+  }
+  unsigned long long seqBases = (unsigned long long) seqBytes*4;
+  for (unsigned int i=0; i < found->second.size(); ++i) {
+    const BaseRun &region = found->second[i];
+    unsigned long long first = (region.start > pad) ? region.start - pad : 0;
+    unsigned long long last = std::min((unsigned long long) region.start + region.length + pad, seqBases);
+    if (first >= last) {
+      continue;
+    }
+    BaseRun range = {(unsigned int) (first/4), (unsigned int) ((last + 3)/4 - first/4)};
+    if (!ranges.empty() && range.start <= ranges.back().start + ranges.back().length) {
+      ranges.back().length = std::max(ranges.back().length, range.start + range.length - ranges.back().start);
+    }
+    else {
+      ranges.push_back(range);
+    }
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// getRegions                                                                //
+//  inputs: db sequence name <char*>                                         //
+//  output: the seq's BED intervals, NULL when whole seqs are searched       //
+//          <vector BaseRun*>                                                //
+///////////////////////////////////////////////////////////////////////////////  
+
+const std::vector<BaseRun> *RegionList::getRegions(const char *seqName) {
+  if (!haveBed) {
+    return NULL;
+  }
+  std::map<std::string, std::vector<BaseRun> >::iterator found = regions.find(firstWord(seqName));
+  return (found != regions.end()) ? &found->second : NULL;
+}
@@ -0,0 +1,55 @@
+#ifndef REGIONLIST_H__
+#define REGIONLIST_H__
+
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include "Properties.h"
+#include "AmbiguityTable.h"
+
+/////////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2007 Affymetrix, Inc.                                         //
+//                                                                             //
+// This program is free software; you can redistribute it and/or modify        //
+// it under the terms of the GNU General Public License (version 2) as         //
+// published by the Free Software Foundation.                                  //
+//                                                                             //
+// This program is distributed in the hope that it will be useful,             //
+// but WITHOUT ANY WARRANTY; without even the implied warranty of              // 
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU            //
+// General Public License for more details.                                    //
+//                                                                             //
+// You should have received a copy of the GNU General Public License           //
+// along with this program;if not, write to the                                //
+//                                                                             //
+// Free Software Foundation, Inc.,                                             //
+// 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA                       // 
+/////////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+// RegionList                                                                //
+// - The parts of the db to search (--regions, --seqs).  Regions are BED     //
+//   intervals by sequence; a sequence list keeps whole sequences.  Given    //
+//   both, only the regions on the listed sequences are searched.  Names     //
+//   match the first word of a db sequence name.                             //
+///////////////////////////////////////////////////////////////////////////////  
+
+class RegionList {
+  public:
+    RegionList();
+    void loadBed(std::string filename);
+    void loadSeqList(std::string filename);
+    void getByteRanges(const char *seqName, unsigned int seqBytes, unsigned int pad, std::vector<BaseRun> &ranges);
+    const std::vector<BaseRun> *getRegions(const char *seqName);
+    
+    static std::string firstWord(const char *seqName);
+    
+  private:
+    bool haveBed;
+    std::map<std::string, std::vector<BaseRun> > regions; // sorted and merged, by seq
+    bool haveSeqs;
+    std::set<std::string> seqs;
+};
+
+#endif // REGIONLIST_H__
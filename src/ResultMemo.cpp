@@ -0,0 +1,139 @@
+#include "ResultMemo.h"
+#include <iostream>
+#include <sstream>
+#include <algorithm>
+#include <stdlib.h>
+#include <sys/stat.h>
+
+/////////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2007 Affymetrix, Inc.                                         //
+//                                                                             //
+// This program is free software; you can redistribute it and/or modify        //
+// it under the terms of the GNU General Public License (version 2) as         //
+// published by the Free Software Foundation.                                  //
+//                                                                             //
+// This program is distributed in the hope that it will be useful,             //
+// but WITHOUT ANY WARRANTY; without even the implied warranty of              // 
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU            //
+// General Public License for more details.                                    //
+//                                                                             //
+// You should have received a copy of the GNU General Public License           //
+// along with this program;if not, write to the                                //
+//                                                                             //
+// Free Software Foundation, Inc.,                                             //
+// 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA                       // 
+/////////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+// ResultMemo (constructor/destructor)                                       //
+//  inputs: memo log filename <std::string>                                  //
+//    desc: indexes any existing log and opens it for appending.  Lines      //
+//          that are cut short (e.g. by a killed run) are ignored.           //
+///////////////////////////////////////////////////////////////////////////////  
+
+ResultMemo::ResultMemo(std::string cFilename) {
+  filename = cFilename;
+  
+  std::ifstream oldLog(filename.c_str());
+  std::string line;
+  while (std::getline(oldLog, line)) {
+    std::string::size_type split = line.rfind(' ');
+    if (split == std::string::npos || split + 2 != line.length() ||
+        (line[split+1] != '0' && line[split+1] != '1')) {
+      continue;
+    }
+    verdicts[line.substr(0, split)] = (line[split+1] == '1');
+  }
+  oldLog.close();
+  
+  memoLog.open(filename.c_str(), std::ios::out | std::ios::app);
+  if (!memoLog.is_open()) {
+    std::cerr << "Error opening result memo file: " << filename << "\n";
+    exit(1);
+  }
+}
+
+ResultMemo::~ResultMemo() {
+  memoLog.close();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// lookup                                                                    //
+//  inputs: key <std::string>                                                //
+//  output: PASSED, FAILED or UNKNOWN <int>                                  //
+///////////////////////////////////////////////////////////////////////////////  
+
+int ResultMemo::lookup(std::string key) {
+  std::map<std::string, bool>::iterator it = verdicts.find(key);
+  if (it == verdicts.end()) {
+    return UNKNOWN;
+  }
+  return (it->second) ? PASSED : FAILED;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// record                                                                    //
+//  inputs: key <std::string>, verdict <bool>                                //
+//  output: none                                                             //
+//    desc: appends the verdict to the log right away so that it survives    //
+//          the early exits pgrep takes once enough pairs have passed        //
+///////////////////////////////////////////////////////////////////////////////  
+
+void ResultMemo::record(std::string key, bool passed) {
+  verdicts[key] = passed;
+  memoLog << key << " " << (passed ? 1 : 0) << "\n";
+  memoLog.flush();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// hashString                                                                //
+//  inputs: text <std::string>                                               //
+//  output: 64-bit FNV-1a hash <uns long long>                               //
+///////////////////////////////////////////////////////////////////////////////  
+
+unsigned long long ResultMemo::hashString(std::string text) {
+  unsigned long long hash = 14695981039346656037LLU;
+  for (unsigned int i=0; i < text.length(); ++i) {
+    hash ^= (unsigned char) text[i];
+    hash *= 1099511628211LLU;
+  }
+  return hash;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// hashFile                                                                  //
+//  inputs: filename <std::string>                                           //
+//  output: hash of the file contents <uns long long>                        //
+///////////////////////////////////////////////////////////////////////////////  
+
+unsigned long long ResultMemo::hashFile(std::string filename) {
+  std::ifstream file(filename.c_str(), std::ios::in | std::ios::binary);
+  std::ostringstream contents;
+  contents << file.rdbuf();
+  return hashString(contents.str());
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// hashManifest                                                              //
+//  inputs: db filenames <vector std::string>                                //
+//  output: hash of the file names, sizes and modification times             //
+//    desc: the files are sorted first so that the order they were given     //
+//          in (e.g. -c) does not matter                                     //
+///////////////////////////////////////////////////////////////////////////////  
+
+unsigned long long ResultMemo::hashManifest(std::vector<std::string> files) {
+  std::sort(files.begin(), files.end());
+  
+  std::ostringstream manifest;
+  for (unsigned int i=0; i < files.size(); ++i) {
+    struct stat info;
+    manifest << files[i];
+    if (stat(files[i].c_str(), &info) == 0) {
+      manifest << " " << (unsigned long long) info.st_size << " " << (long long) info.st_mtime << "\n";
+    }
+    else {
+      manifest << " missing\n";
+    }
+  }
+  return hashString(manifest.str());
+}
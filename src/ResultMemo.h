@@ -0,0 +1,59 @@
+#ifndef RESULTMEMO_H__
+#define RESULTMEMO_H__
+
+#include <string>
+#include <vector>
+#include <map>
+#include <fstream>
+#include "Properties.h"
+
+/////////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2007 Affymetrix, Inc.                                         //
+//                                                                             //
+// This program is free software; you can redistribute it and/or modify        //
+// it under the terms of the GNU General Public License (version 2) as         //
+// published by the Free Software Foundation.                                  //
+//                                                                             //
+// This program is distributed in the hope that it will be useful,             //
+// but WITHOUT ANY WARRANTY; without even the implied warranty of              // 
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU            //
+// General Public License for more details.                                    //
+//                                                                             //
+// You should have received a copy of the GNU General Public License           //
+// along with this program;if not, write to the                                //
+//                                                                             //
+// Free Software Foundation, Inc.,                                             //
+// 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA                       // 
+/////////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+// ResultMemo                                                                //
+// - On-disk memo of filter mode verdicts.  Verdicts are appended to a       //
+//   plain text log, one "<key> <verdict>" line each, and the whole log is   //
+//   indexed in memory at startup.  Keys include a hash of the db            //
+//   manifest (file names, sizes and times), so entries for a db that has    //
+//   since changed are simply never matched again.                           //
+///////////////////////////////////////////////////////////////////////////////  
+
+class ResultMemo {
+  public:
+    ResultMemo(std::string cFilename);
+    ~ResultMemo();
+    int lookup(std::string key);
+    void record(std::string key, bool passed);
+    
+    static unsigned long long hashString(std::string text);
+    static unsigned long long hashFile(std::string filename);
+    static unsigned long long hashManifest(std::vector<std::string> files);
+    
+    static const int UNKNOWN = -1;
+    static const int FAILED = 0;
+    static const int PASSED = 1;
+    
+  private:
+    std::string filename;
+    std::ofstream memoLog;
+    std::map<std::string, bool> verdicts;
+};
+
+#endif // RESULTMEMO_H__
@@ -0,0 +1,268 @@
+#include "RunStats.h"
+#include "Properties.h"
+#include <iostream>
+#include <iomanip>
+#include <time.h>
+#ifndef _WIN32
+#include <sys/time.h>
+#include <sys/resource.h>
+#endif
+
+/////////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2007 Affymetrix, Inc.                                         //
+//                                                                             //
+// This program is free software; you can redistribute it and/or modify        //
+// it under the terms of the GNU General Public License (version 2) as         //
+// published by the Free Software Foundation.                                  //
+//                                                                             //
+// This program is distributed in the hope that it will be useful,             //
+// but WITHOUT ANY WARRANTY; without even the implied warranty of              // 
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU            //
+// General Public License for more details.                                    //
+//                                                                             //
+// You should have received a copy of the GNU General Public License           //
+// along with this program;if not, write to the                                //
+//                                                                             //
+// Free Software Foundation, Inc.,                                             //
+// 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA                       // 
+/////////////////////////////////////////////////////////////////////////////////
+
+bool RunStats::enabled = false;
+
+static const char *PHASE_NAMES[NPHASES] = {"load", "patterns", "scan", "output"};
+
+///////////////////////////////////////////////////////////////////////////////
+// SearchStats (constructor)                                                 //
+///////////////////////////////////////////////////////////////////////////////  
+
+SearchStats::SearchStats() {
+  for (int k=0; k < NKERNELS; ++k) {
+    bytesScanned[k] = 0;
+    kernelSeconds[k] = 0;
+  }
+  forCandidates = 0;
+  revMatches = 0;
+  sitesAdded = 0;
+  sitesDuplicate = 0;
+  sitesAmbiguous = 0;
+  sitesMasked = 0;
+  bytesSkipped = 0;
+  peakMatchDepth = 0;
+  siteSeconds = 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// RunStats (constructor)                                                    //
+//    desc: the run starts in the load phase                                 //
+///////////////////////////////////////////////////////////////////////////////  
+
+RunStats::RunStats() {
+  pairs = 0;
+  bytesRead = 0;
+  cacheHits = 0;
+  cacheMisses = 0;
+  cacheRejects = 0;
+  for (int p=0; p < NPHASES; ++p) {
+    phaseWall[p] = 0;
+    phaseCpu[p] = 0;
+  }
+  phase = PHASE_LOAD;
+  phaseWallStart = wallSeconds();
+  phaseCpuStart = cpuSeconds();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// wallSeconds / cpuSeconds                                                  //
+//  output: current wall clock and process cpu time in seconds <double>      //
+///////////////////////////////////////////////////////////////////////////////  
+
+double RunStats::wallSeconds() {
+#ifndef _WIN32
+  struct timeval now;
+  gettimeofday(&now, NULL);
+  return now.tv_sec + now.tv_usec / 1e6;
+#else
+  return double(clock()) / CLOCKS_PER_SEC;
+#endif
+}
+
+double RunStats::cpuSeconds() {
+  return double(clock()) / CLOCKS_PER_SEC;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// enterPhase                                                                //
+//  inputs: new phase <RunPhase>                                             //
+//  output: the phase that was current <RunPhase>                            //
+//    desc: charges the time since the last switch to the current phase.     //
+//          Pass the returned phase back in to resume it.                    //
+///////////////////////////////////////////////////////////////////////////////  
+
+RunPhase RunStats::enterPhase(RunPhase newPhase) {
+  RunPhase oldPhase = phase;
+  if (enabled) {
+    double wall = wallSeconds();
+    double cpu = cpuSeconds();
+    phaseWall[phase] += wall - phaseWallStart;
+    phaseCpu[phase] += cpu - phaseCpuStart;
+    phaseWallStart = wall;
+    phaseCpuStart = cpu;
+  }
+  phase = newPhase;
+  return oldPhase;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// counters                                                                  //
+///////////////////////////////////////////////////////////////////////////////  
+
+void RunStats::countPair() {
+  ++pairs;
+}
+
+void RunStats::addSearch(SearchStats &stats) {
+  for (int k=0; k < NKERNELS; ++k) {
+    totals.bytesScanned[k] += stats.bytesScanned[k];
+    totals.kernelSeconds[k] += stats.kernelSeconds[k];
+  }
+  totals.forCandidates += stats.forCandidates;
+  totals.revMatches += stats.revMatches;
+  totals.sitesAdded += stats.sitesAdded;
+  totals.sitesDuplicate += stats.sitesDuplicate;
+  totals.sitesAmbiguous += stats.sitesAmbiguous;
+  totals.sitesMasked += stats.sitesMasked;
+  totals.bytesSkipped += stats.bytesSkipped;
+  totals.siteSeconds += stats.siteSeconds;
+  if (stats.peakMatchDepth > totals.peakMatchDepth) {
+    totals.peakMatchDepth = stats.peakMatchDepth;
+  }
+}
+
+void RunStats::countBytesRead(unsigned long long bytes) {
+  bytesRead += bytes;
+}
+
+void RunStats::countCacheSlot(bool hit) {
+  if (hit) {
+    ++cacheHits;
+  }
+  else {
+    ++cacheMisses;
+  }
+}
+
+void RunStats::countCacheReject() {
+  ++cacheRejects;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// kernelName                                                                //
+//  inputs: kernel number <int>                                              //
+//  output: name of the PrimerSearch kernel <const char*>                    //
+///////////////////////////////////////////////////////////////////////////////  
+
+const char *RunStats::kernelName(int kernel) {
+  static const char *names[NKERNELS] = {"findPattern0", "findPattern1", "findPattern2", "findPattern3", "findPattern4",
+                                        "findOnePattern0", "findOnePattern1", "findOnePattern2", "findOnePattern3",
+                                        "findOnePattern4"};
+  return names[kernel];
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// peakRssKb                                                                 //
+//  output: peak resident set size in Kb, or -1 if unknown <long>            //
+///////////////////////////////////////////////////////////////////////////////  
+
+long RunStats::peakRssKb() {
+#ifndef _WIN32
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) == 0) {
+#ifdef __APPLE__
+    return usage.ru_maxrss / 1024; // bytes on OS X
+#else
+    return usage.ru_maxrss;
+#endif
+  }
+#endif
+  return -1;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// report                                                                    //
+//  inputs: json format flag <bool>                                          //
+//  output: none                                                             //
+//    desc: writes the run totals to STDERR as a table or a JSON object      //
+///////////////////////////////////////////////////////////////////////////////  
+
+void RunStats::report(bool json) {
+  enterPhase(phase); // close out the current phase
+  
+  unsigned long long bytesScanned = 0;
+  for (int k=0; k < NKERNELS; ++k) {
+    bytesScanned += totals.bytesScanned[k];
+  }
+  
+  std::ostream &out = std::cerr;
+  out << std::fixed << std::setprecision(3);
+  if (json) {
+    out << "{\"pairs\": " << pairs
+        << ", \"bases_scanned\": " << bytesScanned*4
+        << ", \"bases_skipped\": " << totals.bytesSkipped*4
+        << ", \"bytes_read\": " << bytesRead
+        << ", \"kernels\": [";
+    bool first = true;
+    for (int k=0; k < NKERNELS; ++k) {
+      if (totals.bytesScanned[k] == 0) {
+        continue;
+      }
+      double secs = totals.kernelSeconds[k];
+      out << (first ? "" : ", ") << "{\"name\": \"" << kernelName(k) << "\", \"bases\": " << totals.bytesScanned[k]*4
+          << ", \"seconds\": " << secs << ", \"gbases_per_sec\": " << ((secs > 0) ? totals.bytesScanned[k]*4 / secs / 1e9 : 0) << "}";
+      first = false;
+    }
+    out << "], \"for_candidates\": " << totals.forCandidates
+        << ", \"rev_matches\": " << totals.revMatches
+        << ", \"priming_sites_added\": " << totals.sitesAdded
+        << ", \"priming_sites_duplicate\": " << totals.sitesDuplicate
+        << ", \"priming_sites_ambiguous\": " << totals.sitesAmbiguous
+        << ", \"priming_sites_masked\": " << totals.sitesMasked
+        << ", \"priming_site_seconds\": " << totals.siteSeconds
+        << ", \"peak_match_depth\": " << totals.peakMatchDepth
+        << ", \"cache_hits\": " << cacheHits
+        << ", \"cache_misses\": " << cacheMisses
+        << ", \"cache_rejects\": " << cacheRejects
+        << ", \"phases\": {";
+    for (int p=0; p < NPHASES; ++p) {
+      out << (p ? ", " : "") << "\"" << PHASE_NAMES[p] << "\": {\"wall\": " << phaseWall[p] << ", \"cpu\": " << phaseCpu[p] << "}";
+    }
+    out << "}, \"peak_rss_kb\": " << peakRssKb() << "}\n";
+    return;
+  }
+  
+  out << "PGREP run statistics\n";
+  out << "  primer pairs searched\t" << pairs << "\n";
+  out << "  bases scanned\t" << bytesScanned*4 << "\n";
+  out << "  bases skipped (N gaps, masking)\t" << totals.bytesSkipped*4 << "\n";
+  out << "  bytes read\t" << bytesRead << "\n";
+  for (int k=0; k < NKERNELS; ++k) {
+    if (totals.bytesScanned[k] == 0) {
+      continue;
+    }
+    double secs = totals.kernelSeconds[k];
+    out << "  " << kernelName(k) << "\t" << totals.bytesScanned[k]*4 << " bases\t" << secs << " s\t"
+        << ((secs > 0) ? totals.bytesScanned[k]*4 / secs / 1e9 : 0) << " Gbases/s\n";
+  }
+  out << "  forward candidates\t" << totals.forCandidates << "\n";
+  out << "  revMatch calls\t" << totals.revMatches << "\n";
+  out << "  addPrimingSite calls\t" << totals.sitesAdded << " (" << totals.sitesDuplicate << " duplicates)\t"
+      << totals.siteSeconds << " s\n";
+  out << "  sites over ambiguous bases\t" << totals.sitesAmbiguous << "\n";
+  out << "  sites dropped by the mask\t" << totals.sitesMasked << "\n";
+  out << "  peak forward match depth\t" << totals.peakMatchDepth << " of " << MATCH_BUFFER << "\n";
+  out << "  cache slot hits/misses\t" << cacheHits << "/" << cacheMisses << "\n";
+  out << "  pairs rejected by cache\t" << cacheRejects << "\n";
+  for (int p=0; p < NPHASES; ++p) {
+    out << "  " << PHASE_NAMES[p] << " time\t" << phaseWall[p] << " s wall\t" << phaseCpu[p] << " s cpu\n";
+  }
+  out << "  peak RSS\t" << peakRssKb() << " Kb\n";
+}
@@ -0,0 +1,90 @@
+#ifndef RUNSTATS_H__
+#define RUNSTATS_H__
+
+/////////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2007 Affymetrix, Inc.                                         //
+//                                                                             //
+// This program is free software; you can redistribute it and/or modify        //
+// it under the terms of the GNU General Public License (version 2) as         //
+// published by the Free Software Foundation.                                  //
+//                                                                             //
+// This program is distributed in the hope that it will be useful,             //
+// but WITHOUT ANY WARRANTY; without even the implied warranty of              // 
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU            //
+// General Public License for more details.                                    //
+//                                                                             //
+// You should have received a copy of the GNU General Public License           //
+// along with this program;if not, write to the                                //
+//                                                                             //
+// Free Software Foundation, Inc.,                                             //
+// 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA                       // 
+/////////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+// SearchStats                                                               //
+// - Counters kept by each PrimerSearch.  Kernels are numbered by kbits,     //
+//   with the single primer kernels following the pair kernels.              //
+///////////////////////////////////////////////////////////////////////////////  
+
+const int NKERNELS = 10; // pair and single primer kernels, kbits 0-4
+
+struct SearchStats {
+  unsigned long long bytesScanned[NKERNELS]; // packed bytes, 4 bases each
+  double kernelSeconds[NKERNELS];            // only timed with --stats
+  unsigned long long forCandidates;          // 5' matches pushed by forMatch
+  unsigned long long revMatches;             // revMatch calls
+  unsigned long long sitesAdded;             // addPrimingSite calls
+  unsigned long long sitesDuplicate;         // ... that were already known
+  unsigned long long sitesAmbiguous;         // sites with a primer over ambiguous bases
+  unsigned long long sitesMasked;            // sites dropped for a primer over masked bases
+  unsigned long long bytesSkipped;           // packed bytes of long ambiguous or masked runs not scanned
+  int peakMatchDepth;                        // deepest forMatches stack
+  double siteSeconds;                        // time in addPrimingSite
+  
+  SearchStats();
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// RunStats                                                                  //
+// - Totals for a whole pgrep run (--stats).  Wall and cpu time are          //
+//   charged to whichever phase is current, so phases never overlap.         //
+///////////////////////////////////////////////////////////////////////////////  
+
+enum RunPhase {PHASE_LOAD, PHASE_PATTERNS, PHASE_SCAN, PHASE_OUTPUT};
+const int NPHASES = 4;
+
+class RunStats {
+  public:
+    RunStats();
+    RunPhase enterPhase(RunPhase phase);
+    void countPair();
+    void addSearch(SearchStats &stats);
+    void countBytesRead(unsigned long long bytes);
+    void countCacheSlot(bool hit);
+    void countCacheReject();
+    void report(bool json);
+    
+    static double wallSeconds();
+    static double cpuSeconds();
+    static const char *kernelName(int kernel);
+    
+    static bool enabled; // set by --stats or --profile, turns on kernel timing
+    
+  private:
+    long peakRssKb();
+  
+    SearchStats totals;
+    unsigned long long pairs;
+    unsigned long long bytesRead;
+    unsigned long long cacheHits;    // cache slots that gave a pair new sites
+    unsigned long long cacheMisses;
+    unsigned long long cacheRejects; // pairs rejected by the cache alone
+    
+    RunPhase phase;
+    double phaseWallStart;
+    double phaseCpuStart;
+    double phaseWall[NPHASES];
+    double phaseCpu[NPHASES];
+};
+
+#endif // RUNSTATS_H__
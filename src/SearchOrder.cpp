@@ -0,0 +1,81 @@
+#include "SearchOrder.h"
+#include <algorithm>
+
+/////////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2007 Affymetrix, Inc.                                         //
+//                                                                             //
+// This program is free software; you can redistribute it and/or modify        //
+// it under the terms of the GNU General Public License (version 2) as         //
+// published by the Free Software Foundation.                                  //
+//                                                                             //
+// This program is distributed in the hope that it will be useful,             //
+// but WITHOUT ANY WARRANTY; without even the implied warranty of              // 
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU            //
+// General Public License for more details.                                    //
+//                                                                             //
+// You should have received a copy of the GNU General Public License           //
+// along with this program;if not, write to the                                //
+//                                                                             //
+// Free Software Foundation, Inc.,                                             //
+// 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA                       // 
+/////////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+// SearchOrder (constructor/destructor)                                      //
+//  inputs: db filenames <vector std::string>, number of files <int>,        //
+//          blast db flag <bool>                                             //
+//    desc: indexes each volume and starts with the given file order         //
+///////////////////////////////////////////////////////////////////////////////  
+
+SearchOrder::SearchOrder(std::vector<std::string> &files, int nfiles, bool isBlast) {
+  for (int v=0; v < nfiles; ++v) {
+    dbs.push_back(new SequenceDb(files[v], isBlast));
+    volumeOrder.push_back(v);
+    
+    std::vector<int> seqs;
+    for (int s=0; s < dbs[v]->getSeqCount(); ++s) {
+      seqs.push_back(s);
+    }
+    seqOrder.push_back(seqs);
+  }
+}
+
+SearchOrder::~SearchOrder() {
+  for (unsigned int v=0; v < dbs.size(); ++v) {
+    delete dbs[v];
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// accessors                                                                 //
+//    desc: orders are returned by value so a search may promote while it    //
+//          walks them                                                       //
+///////////////////////////////////////////////////////////////////////////////  
+
+SequenceDb *SearchOrder::getDb(int volume) {
+  return dbs[volume];
+}
+
+std::vector<int> SearchOrder::getVolumeOrder() {
+  return volumeOrder;
+}
+
+std::vector<int> SearchOrder::getSeqOrder(int volume) {
+  return seqOrder[volume];
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// promote                                                                   //
+//  inputs: volume index <int>, seq index within the volume <int>            //
+//  output: none                                                             //
+//    desc: moves the volume and the seq to the front of their orders        //
+///////////////////////////////////////////////////////////////////////////////  
+
+void SearchOrder::promote(int volume, int seq) {
+  std::vector<int>::iterator vi = std::find(volumeOrder.begin(), volumeOrder.end(), volume);
+  std::rotate(volumeOrder.begin(), vi, vi + 1);
+  
+  std::vector<int> &seqs = seqOrder[volume];
+  std::vector<int>::iterator si = std::find(seqs.begin(), seqs.end(), seq);
+  std::rotate(seqs.begin(), si, si + 1);
+}
@@ -0,0 +1,52 @@
+#ifndef SEARCHORDER_H__
+#define SEARCHORDER_H__
+
+#include <string>
+#include <vector>
+#include "Properties.h"
+#include "SequenceDb.h"
+
+/////////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2007 Affymetrix, Inc.                                         //
+//                                                                             //
+// This program is free software; you can redistribute it and/or modify        //
+// it under the terms of the GNU General Public License (version 2) as         //
+// published by the Free Software Foundation.                                  //
+//                                                                             //
+// This program is distributed in the hope that it will be useful,             //
+// but WITHOUT ANY WARRANTY; without even the implied warranty of              // 
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU            //
+// General Public License for more details.                                    //
+//                                                                             //
+// You should have received a copy of the GNU General Public License           //
+// along with this program;if not, write to the                                //
+//                                                                             //
+// Free Software Foundation, Inc.,                                             //
+// 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA                       // 
+/////////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+// SearchOrder                                                               //
+// - The order in which the volumes of a db set, and the sequences within    //
+//   each volume, are searched.  Whatever produced a hit most recently is    //
+//   moved to the front, so the next pair reaches its likely sites (and      //
+//   in filter mode its second hit) sooner.  Like the target cache, this     //
+//   only pays off because successive pairs usually target one locus.        //
+///////////////////////////////////////////////////////////////////////////////  
+
+class SearchOrder {
+  public:
+    SearchOrder(std::vector<std::string> &files, int nfiles, bool isBlast);
+    ~SearchOrder();
+    SequenceDb *getDb(int volume);
+    std::vector<int> getVolumeOrder();
+    std::vector<int> getSeqOrder(int volume);
+    void promote(int volume, int seq);
+    
+  private:
+    std::vector<SequenceDb*> dbs;
+    std::vector<int> volumeOrder;
+    std::vector< std::vector<int> > seqOrder;
+};
+
+#endif // SEARCHORDER_H__
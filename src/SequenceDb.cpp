@@ -0,0 +1,185 @@
+#include "SequenceDb.h"
+#include "BlastInfo.h"
+#include "DupTable.h"
+#include <iostream>
+#include <string.h>
+#include <stdlib.h>
+
+/////////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2007 Affymetrix, Inc.                                         //
+//                                                                             //
+// This program is free software; you can redistribute it and/or modify        //
+// it under the terms of the GNU General Public License (version 2) as         //
+// published by the Free Software Foundation.                                  //
+//                                                                             //
+// This program is distributed in the hope that it will be useful,             //
+// but WITHOUT ANY WARRANTY; without even the implied warranty of              // 
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU            //
+// General Public License for more details.                                    //
+//                                                                             //
+// You should have received a copy of the GNU General Public License           //
+// along with this program;if not, write to the                                //
+//                                                                             //
+// Free Software Foundation, Inc.,                                             //
+// 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA                       // 
+/////////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+// SequenceDb (constructor)                                                  //
+//  inputs: db filename <std::string>, blast db flag <bool>                  //
+//    desc: opens a pgrep db file (or blast db .nsq file) and records where  //
+//          each sequence starts so that any part of it can be read back     //
+///////////////////////////////////////////////////////////////////////////////  
+
+SequenceDb::SequenceDb(std::string cFilename, bool cIsBlast) {
+  filename = cFilename;
+  isBlast = cIsBlast;
+  
+  std::string seqFilename = isBlast ? filename + ".nsq" : filename;
+  seqFile.open(seqFilename.c_str(), std::ios::in | std::ios::binary);
+  if (!seqFile.is_open()) {
+    std::cerr << "Error opening sequence database file: " << seqFilename << "\n";
+    exit(1);
+  }
+  
+  if (isBlast) {
+    loadBlastIndex();
+  }
+  else {
+    loadPgrepIndex();
+  }
+}
+
+SequenceDb::~SequenceDb() {
+  seqFile.close();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// loadPgrepIndex                                                            //
+//  inputs: none                                                             //
+//  output: none                                                             //
+//    desc: walks the pgrep db headers (name, size) skipping over the        //
+//          packed sequence data                                             //
+///////////////////////////////////////////////////////////////////////////////  
+
+void SequenceDb::loadPgrepIndex() {
+  char seqName[MAX_SEQNAME_SIZE];
+  unsigned int seqSize;
+  
+  while (seqFile.read(seqName, MAX_SEQNAME_SIZE)) {
+    seqFile.read((char*)&seqSize, sizeof(unsigned int));
+    if (!seqFile) {
+      std::cerr << "Error: Truncated sequence header in file: " << filename << "\n";
+      exit(1);
+    }
+    seqName[MAX_SEQNAME_SIZE-1] = '\0';
+    seqNames.push_back(seqName);
+    seqOffsets.push_back((unsigned long long) seqFile.tellg());
+    seqSizes.push_back(seqSize);
+    storedSeqs.push_back(seqNames.size() - 1);
+    seqFile.seekg(seqSize, std::ios::cur);
+  }
+  seqFile.clear();
+  
+  // put back the copies of a deduplicated db where they were
+  DupTable dupTable;
+  if (!dupTable.load(filename)) {
+    return;
+  }
+  const std::vector<DupSeq> &dups = dupTable.getDups();
+  std::vector<std::string> stored;
+  stored.swap(seqNames);
+  std::vector<unsigned long long> storedOffsets;
+  storedOffsets.swap(seqOffsets);
+  std::vector<unsigned int> storedSizes;
+  storedSizes.swap(seqSizes);
+  storedSeqs.clear();
+  
+  unsigned int d = 0;
+  for (unsigned int s=0; s < stored.size(); s++) {
+    seqNames.push_back(stored[s]);
+    seqOffsets.push_back(storedOffsets[s]);
+    seqSizes.push_back(storedSizes[s]);
+    storedSeqs.push_back(s);
+    for (; d < dups.size() && dups[d].after == s; d++) {
+      seqNames.push_back(dups[d].name);
+      seqOffsets.push_back(storedOffsets[dups[d].rep]);
+      seqSizes.push_back(storedSizes[dups[d].rep]);
+      storedSeqs.push_back(dups[d].rep);
+    }
+  }
+  if (d < dups.size()) {
+    std::cerr << "Error: Duplicate table does not match sequence database file: " << filename << "\n";
+    exit(1);
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// loadBlastIndex                                                            //
+//  inputs: none                                                             //
+//  output: none                                                             //
+//    desc: reads seq names and offsets from the .nin/.nhr files             //
+///////////////////////////////////////////////////////////////////////////////  
+
+void SequenceDb::loadBlastIndex() {
+  BlastInfo* biseqs[MAX_BLAST_ENTRIES+1];
+  loadBlastInfo(filename, biseqs);
+  
+  for (int i=0; biseqs[i] != NULL; ++i) {
+    seqNames.push_back(biseqs[i]->getSeqName());
+    seqOffsets.push_back(biseqs[i]->getStartOffset());
+    seqSizes.push_back(biseqs[i]->getSeqLength());
+    storedSeqs.push_back(i);
+    delete biseqs[i];
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// readSeq                                                                   //
+//  inputs: seq index <int>, start byte within seq <uns int>, number of      //
+//          bytes <uns int>, buffer to fill <char*>                          //
+//  output: none                                                             //
+//    desc: reads part of a packed sequence (4 bases per byte)               //
+///////////////////////////////////////////////////////////////////////////////  
+
+void SequenceDb::readSeq(int seq, unsigned int start, unsigned int size, char *buffer) {
+  if (start + size > seqSizes[seq]) {
+    std::cerr << "Error: Read past end of sequence " << seqNames[seq] << " in file: " << filename << "\n";
+    exit(1);
+  }
+  seqFile.seekg(seqOffsets[seq] + start, std::ios::beg);
+  seqFile.read(buffer, size);
+  if (!seqFile) {
+    std::cerr << "Error: Not enough sequence found when reading from file: " << filename << "\n";
+    exit(1);
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// accessors                                                                 //
+///////////////////////////////////////////////////////////////////////////////  
+
+int SequenceDb::getSeqCount() {
+  return seqNames.size();
+}
+
+char *SequenceDb::getSeqName(int seq) {
+  return (char*) seqNames[seq].c_str();
+}
+
+unsigned int SequenceDb::getSeqSize(int seq) {
+  return seqSizes[seq];
+}
+
+// the seq whose ambiguity and mask runs apply (itself unless it is a copy)
+int SequenceDb::getStoredSeq(int seq) {
+  return storedSeqs[seq];
+}
+
+std::string SequenceDb::getFilename() {
+  return filename;
+}
+
+bool SequenceDb::isBlastDb() {
+  return isBlast;
+}
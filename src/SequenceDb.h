@@ -0,0 +1,61 @@
+#ifndef SEQUENCEDB_H__
+#define SEQUENCEDB_H__
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include "Properties.h"
+
+/////////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2007 Affymetrix, Inc.                                         //
+//                                                                             //
+// This program is free software; you can redistribute it and/or modify        //
+// it under the terms of the GNU General Public License (version 2) as         //
+// published by the Free Software Foundation.                                  //
+//                                                                             //
+// This program is distributed in the hope that it will be useful,             //
+// but WITHOUT ANY WARRANTY; without even the implied warranty of              // 
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU            //
+// General Public License for more details.                                    //
+//                                                                             //
+// You should have received a copy of the GNU General Public License           //
+// along with this program;if not, write to the                                //
+//                                                                             //
+// Free Software Foundation, Inc.,                                             //
+// 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA                       // 
+/////////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+// SequenceDb                                                                //
+// - Random access to the packed sequences of one pgrep or blast db file.    //
+//   Sequences stay 2-bit packed (4 bases per byte) exactly as on disk.      //
+//   The copies left out of a deduplicated db are listed in fasta file order //
+//   and read from the seq they copy.                                        //
+///////////////////////////////////////////////////////////////////////////////  
+
+class SequenceDb {
+  public:
+    SequenceDb(std::string cFilename, bool cIsBlast);
+    ~SequenceDb();
+    int getSeqCount();
+    char *getSeqName(int seq);
+    unsigned int getSeqSize(int seq);
+    int getStoredSeq(int seq);
+    void readSeq(int seq, unsigned int start, unsigned int size, char *buffer);
+    std::string getFilename();
+    bool isBlastDb();
+    
+  private:
+    void loadPgrepIndex();
+    void loadBlastIndex();
+  
+    std::string filename;
+    bool isBlast;
+    std::ifstream seqFile;
+    std::vector<std::string> seqNames;
+    std::vector<unsigned long long> seqOffsets; // byte offset of packed seq in file
+    std::vector<unsigned int> seqSizes;         // packed seq size in bytes
+    std::vector<int> storedSeqs;                // index of the seq in the file
+};
+
+#endif // SEQUENCEDB_H__
@@ -30,6 +30,8 @@
 ///////////////////////////////////////////////////////////////////////////////  
 
 TargetCache::TargetCache() {
+  ambRuns = NULL;
+  maskRuns = NULL;
   empty = true;
 }
 
@@ -37,16 +39,20 @@ TargetCache::TargetCache() {
 // copyBuffer                                                                //
 //  inputs: seq name <char*>, contig start <int>, contig end <int>, seq      //
 //          buffer <char*>, buffer size <int>, buffer start <int>, size <int>//                                               //
+//          ambiguous and masked runs of the seq <vector BaseRun*>           //
 //  output: none                                                             //
 //    desc: copies seq from a seq buffer                                     //                                                   
 ///////////////////////////////////////////////////////////////////////////////  
 
 void TargetCache::copyBuffer(char* cSeqName, unsigned int cStart, unsigned int cEnd,
-                             char *cBuffer, int sBufferSize, int bStart, int size) {  
+                             char *cBuffer, int sBufferSize, int bStart, int size,
+                             const std::vector<BaseRun> *cAmbRuns, const std::vector<BaseRun> *cMaskRuns) {  
   // remember name and positions
   strcpy(seqName,cSeqName);
   start = cStart;
   end = cEnd;
+  ambRuns = cAmbRuns;
+  maskRuns = cMaskRuns;
   
   // copy seq data into our buffer being careful to avoid buffer boundaries
   for (int i=0; i < size; ++i) {
@@ -81,3 +87,11 @@ unsigned int TargetCache::getStart() {
   return start;
 }
 
+const std::vector<BaseRun> *TargetCache::getAmbiguities() {
+  return ambRuns;
+}
+
+const std::vector<BaseRun> *TargetCache::getMask() {
+  return maskRuns;
+}
+
@@ -2,6 +2,7 @@
 #define TARGETCACHE_H__
 
 #include "Properties.h"
+#include "AmbiguityTable.h"
 
 /////////////////////////////////////////////////////////////////////////////////
 // Copyright (C) 2007 Affymetrix, Inc.                                         //
@@ -31,12 +32,15 @@ class TargetCache{
   public:
     TargetCache();
     void copyBuffer(char* cSeqName, unsigned int cStart, unsigned int cEnd,
-                    char *cBuffer, int sBufferSize, int start, int size);
+                    char *cBuffer, int sBufferSize, int start, int size,
+                    const std::vector<BaseRun> *cAmbRuns, const std::vector<BaseRun> *cMaskRuns);
     bool isEmpty();
     char *getBuffer();
     char *getSeqName();
     int getBufferSize();
     unsigned int getStart();
+    const std::vector<BaseRun> *getAmbiguities();
+    const std::vector<BaseRun> *getMask();
     
   private:
     static const int MAX_SEQ_BUFFER = MAX_AMP_SIZE + 3*BUFFER_FLANK; // needs to be synched with max allowed amp size
@@ -46,6 +50,8 @@ class TargetCache{
     int end;
     int bufferSize;
     char seqName[MAX_SEQ_NAME];
+    const std::vector<BaseRun> *ambRuns; // of the whole seq, NULL for none
+    const std::vector<BaseRun> *maskRuns; // likewise
     bool empty;
 };
 
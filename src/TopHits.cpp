@@ -0,0 +1,101 @@
+#include "TopHits.h"
+#include <algorithm>
+
+/////////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2007 Affymetrix, Inc.                                         //
+//                                                                             //
+// This program is free software; you can redistribute it and/or modify        //
+// it under the terms of the GNU General Public License (version 2) as         //
+// published by the Free Software Foundation.                                  //
+//                                                                             //
+// This program is distributed in the hope that it will be useful,             //
+// but WITHOUT ANY WARRANTY; without even the implied warranty of              // 
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU            //
+// General Public License for more details.                                    //
+//                                                                             //
+// You should have received a copy of the GNU General Public License           //
+// along with this program;if not, write to the                                //
+//                                                                             //
+// Free Software Foundation, Inc.,                                             //
+// 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA                       // 
+/////////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+// TopHits (constructor)                                                     //
+//  inputs: number of hits to keep <int>                                     //
+///////////////////////////////////////////////////////////////////////////////  
+
+TopHits::TopHits(int cMaxHits) {
+  maxHits = cMaxHits;
+  nOffered = 0;
+  heap.reserve(maxHits);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// worse                                                                     //
+//  inputs: two hits <Hit>                                                   //
+//  output: true if a ranks before b, i.e. b is the worse hit <bool>         //
+//    desc: heap order - higher score is worse, then the later hit           //
+///////////////////////////////////////////////////////////////////////////////  
+
+bool TopHits::worse(const Hit &a, const Hit &b) {
+  if (a.score != b.score) {
+    return a.score < b.score;
+  }
+  return a.order < b.order;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// accepts                                                                   //
+//  inputs: mismatch score <int>                                             //
+//  output: true if a hit with this score would be kept <bool>               //
+///////////////////////////////////////////////////////////////////////////////  
+
+bool TopHits::accepts(int score) {
+  return maxHits > 0 && (heap.size() < maxHits || score < heap.front().score);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// offer                                                                     //
+//  inputs: mismatch score <int>, output line <std::string>                  //
+//  output: none                                                             //
+//    desc: keeps the hit if it is among the best maxHits seen so far,       //
+//          dropping the current worst when full                             //
+///////////////////////////////////////////////////////////////////////////////  
+
+void TopHits::offer(int score, const std::string &hit) {
+  ++nOffered;
+  if (!accepts(score)) {
+    return;
+  }
+  if (heap.size() == maxHits) {
+    std::pop_heap(heap.begin(), heap.end(), worse);
+    heap.pop_back();
+  }
+  Hit h;
+  h.score = score;
+  h.order = nOffered;
+  h.text = hit;
+  heap.push_back(h);
+  std::push_heap(heap.begin(), heap.end(), worse);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// write                                                                     //
+//  inputs: output stream <std::ostream>                                     //
+//  output: none                                                             //
+//    desc: writes the kept hits best first and empties the list             //
+///////////////////////////////////////////////////////////////////////////////  
+
+void TopHits::write(std::ostream &out) {
+  std::sort_heap(heap.begin(), heap.end(), worse);
+  for (unsigned int i=0; i < heap.size(); i++) {
+    out << heap[i].text;
+  }
+  heap.clear();
+  nOffered = 0;
+}
+
+int TopHits::getHitCount() {
+  return heap.size();
+}
@@ -0,0 +1,57 @@
+#ifndef TOPHITS_H__
+#define TOPHITS_H__
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include "Properties.h"
+
+/////////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2007 Affymetrix, Inc.                                         //
+//                                                                             //
+// This program is free software; you can redistribute it and/or modify        //
+// it under the terms of the GNU General Public License (version 2) as         //
+// published by the Free Software Foundation.                                  //
+//                                                                             //
+// This program is distributed in the hope that it will be useful,             //
+// but WITHOUT ANY WARRANTY; without even the implied warranty of              // 
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU            //
+// General Public License for more details.                                    //
+//                                                                             //
+// You should have received a copy of the GNU General Public License           //
+// along with this program;if not, write to the                                //
+//                                                                             //
+// Free Software Foundation, Inc.,                                             //
+// 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA                       // 
+/////////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+// TopHits                                                                   //
+// - Keeps the best (lowest mismatch score) hits of one primer pair while    //
+//   the whole db is scanned.  Hits are held in a max-heap of at most        //
+//   maxHits entries, so memory does not grow with the number of raw hits.   //
+//   Equal scores keep the hit found first.                                  //
+///////////////////////////////////////////////////////////////////////////////  
+
+class TopHits {
+  public:
+    TopHits(int cMaxHits);
+    bool accepts(int score);
+    void offer(int score, const std::string &hit);
+    void write(std::ostream &out);
+    int getHitCount();
+    
+  private:
+    struct Hit {
+      int score;
+      unsigned long order; // when the hit was found
+      std::string text;
+    };
+    static bool worse(const Hit &a, const Hit &b);
+    
+    unsigned int maxHits;
+    unsigned long nOffered;
+    std::vector<Hit> heap; // worst kept hit on top
+};
+
+#endif // TOPHITS_H__
@@ -333,16 +333,34 @@ inline int WeightMatrix::getBasecode(char base) {
 //  inputs: primer F/R (0,1) <int>, positition rel 5' <int>, position rel    //
 //          3' <int>, template base <char>, primer base <char>               //
 //  output: weight <int>                                                     //
-//    desc: computes the weight at a given pos for given pairing             //                                                   
+//    desc: computes the weight at a given pos for given pairing.  A         //
+//          degenerate (IUPAC) base weighs as its best pairing member, so a  //
+//          degenerate primer scores as the best primer of its family.       //
+//          -1 for a base that is not an IUPAC code.                         //
 ///////////////////////////////////////////////////////////////////////////////  
 
 int WeightMatrix::getWeight(PrimerDirection primer, int p5, int p3, char b1, char b2) {
   int bi1 = getBasecode(b1);
   int bi2 = getBasecode(b2);
-  if (b1 >= 0 && b2 >= 0) {
+  if (bi1 >= 0 && bi2 >= 0) {
     return weight5[primer][p5][bi1][bi2] + weight3[primer][p3][bi1][bi2];
   }
-  return -1;
+  
+  // iupac2bits has A, C, G, T in the basecode bits
+  unsigned int bits1 = iupac2bits(b1);
+  unsigned int bits2 = iupac2bits(b2);
+  int weight = -1;
+  for (int i=0; i < NBASES; ++i) {
+    for (int j=0; j < NBASES; ++j) {
+      if ((bits1 >> i) & (bits2 >> j) & 1) {
+        int w = weight5[primer][p5][i][j] + weight3[primer][p3][i][j];
+        if (weight < 0 || w < weight) {
+          weight = w;
+        }
+      }
+    }
+  }
+  return weight;
 } 
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -35,6 +35,7 @@ class WeightMatrix {
     void loadWeightsFile(std::string filename);
     int getWeight(PrimerDirection primer, int p5, int p3, char b1, char b2);
     void toString();
+    static unsigned int iupac2bits(char base);
     
   private:
     
@@ -49,7 +50,6 @@ class WeightMatrix {
     void updateMatrix(); 
     void updateWeightPos(int pos, int weightMatrix[][WT_MAX_PRIMER_SZ][NBASES][NBASES], PrimerDirection primer, int wt, char pbase, char tbase);
     bool isPatternMatch(unsigned int pl, unsigned int tl, char pbase, char tbase);
-    unsigned int iupac2bits(char base);
     void updateWeights(std::string line);
 };
 
@@ -1,8 +1,24 @@
 
 ## a very slow and clunky way to generate a pgrep seq db
-## usage: perl generatePgrepDB.pl myseq.fa mydb.pdb
+## usage: perl generatePgrepDB.pl myseq.fa mydb.pdb [-dust] [-dedup]
+##
+## non-ACGT bases are packed as random bases, so their runs (start, length)
+## are also written to mydb.pdb.amb for pgrep to skip N gaps and drop
+## sites over them
+##
+## lowercase (soft-masked) runs go to mydb.pdb.msk for pgrep --mask, along
+## with low-complexity runs (poly-A, microsatellites) found DUST style when
+## -dust is given
+##
+## with -dedup a seq whose bases (case and all) match an earlier seq's is
+## not written again, only named in mydb.pdb.dup along with the seq it
+## copies, and pgrep reports its hits without searching it
+
+use Digest::MD5;
 
 my $SEQ_FILENAME_SZ = 256;
+my $DUST_WINDOW = 64;   ## bases per window, windows start every half window
+my $DUST_LEVEL = 2.0;   ## triplet score over which a window is masked
 
 ## compress fasta file for jgrep
 my %AMBIG = ('M' => ['A','C'],
@@ -35,6 +51,12 @@ sub main {
   my $curName;
   my %seqSizes;
   my %seqNames;
+  my %flags = map {$_ => 1} @ARGV[2..$#ARGV];
+  my $dust = $flags{'-dust'};
+  my $dedup = $flags{'-dedup'};
+  my %copyOf;     ## -dedup: seqs that copy an earlier seq, and which one
+  my %firstWith;  ## first seq with each digest of its bases
+  my $digest;
   while (my $line = <FILE>) {
     chop $line; 
     $line =~ s/\s*$//;
@@ -45,18 +67,22 @@ sub main {
       $seqNames{$1} = $name;
       if (defined $curName) {
         $seqSizes{$curName} = int(($curSize+3)/4);
+        findCopy(\%firstWith, \%copyOf, $curName, $curSize . $digest->hexdigest) if ($dedup);
       }
       $curSize = 0;      
       $curName = $name;
+      $digest = Digest::MD5->new;
     } else {
       $line =~ s/[^a-zA-Z]//g;
       $curSize += length($line);
+      $digest->add($line) if ($dedup);
     }
   }
   close FILE;
   
   ## finish up
   $seqSizes{$curName} = int(($curSize+3)/4);
+  findCopy(\%firstWith, \%copyOf, $curName, $curSize . $digest->hexdigest) if ($dedup);
   
   ## open the file a second time and dump 
   open(FILE,$ARGV[0]);
@@ -67,12 +93,17 @@ sub main {
   my $expectedSize = 0;
   my $lc=0;
   my $skip = 0;
+  my @seqRuns;    ## ambiguous runs of each seq, [start, length] pairs
+  my @seqMasks;   ## and masked runs
+  my $seqPos = 0; ## bases of the current seq so far
+  my $seqText = ""; ## bases of the current seq, kept for -dust
+  my %stored;     ## index of each seq written
+  my @dups;       ## -dedup copies, [seq copied, last seq written, name]
   while (my $line = <FILE>) {
     chop $line;
     $line =~ s/\s*$//;
     $lc++;
     if ($line =~ /^>\s*(.+)/) {
-      $skip = 0;
       if (length($text) > 0) {
         ## dump last bit
         my @textArray = translateText($text);
@@ -85,18 +116,36 @@ sub main {
         die;
       }
       my $sn = $1;
+      addDust($seqMasks[-1], $seqText) if ($dust && @seqMasks && !$skip);
+      $seqPos = 0;
+      $seqText = "";
+      $outBytes = 0;
+      $text = "";
+      
+      ## a copy is only named in the .dup file
+      $skip = (defined $copyOf{$seqNames{$sn}});
+      if ($skip) {
+        push @dups, [$stored{$copyOf{$seqNames{$sn}}}, scalar(@seqRuns) - 1, $seqNames{$sn}];
+        $expectedSize = 0;
+        next;
+      }
+      $stored{$seqNames{$sn}} = scalar(@seqRuns);
+      push @seqRuns, [];
+      push @seqMasks, [];
       
       print OUT "$seqNames{$sn}";
       print OUT pack("I",$seqSizes{$seqNames{$sn}});
       $expectedSize = $seqSizes{$seqNames{$sn}};
       print STDERR "$seqNames{$sn} - $seqSizes{$seqNames{$sn}}\n";
       print STDERR "LC: $lc\n";
-      $outBytes = 0;
-      $text = "";
     } else {
       next if ($skip);
       $line =~ s/[^a-zA-Z]//g;
       $text .= $line;
+      addRuns($seqRuns[-1], $line, $seqPos, qr/[^ACGTacgt]+/);
+      addRuns($seqMasks[-1], $line, $seqPos, qr/[a-z]+/);
+      $seqPos += length($line);
+      $seqText .= uc $line if ($dust);
       
       my $tlen = int(length($text)/4);
       my @textArray = translateText(substr($text,0,$tlen*4));
@@ -112,6 +161,129 @@ sub main {
   my @textArray = translateText($text);
   map {print OUT chr($_)} @textArray; 
   close OUT;
+  addDust($seqMasks[-1], $seqText) if ($dust && @seqMasks && !$skip);
+  
+  writeRuns("$ARGV[1].amb", "PGAMB01\0", \@seqRuns);
+  writeRuns("$ARGV[1].msk", "PGMSK01\0", \@seqMasks);
+  if ($dedup) {
+    writeDups("$ARGV[1].dup", \@dups);
+  } else {
+    unlink("$ARGV[1].dup");
+  }
+}
+
+## -dedup: the first seq with a digest is kept, later ones are copies of it
+sub findCopy {
+  my ($firstWith, $copyOf, $name, $key) = @_;
+  if (defined $firstWith->{$key}) {
+    $copyOf->{$name} = $firstWith->{$key};
+  } else {
+    $firstWith->{$key} = $name;
+  }
+}
+
+## record the runs of a line matching pattern starting at base pos, joining
+## a run that carries on from the last line
+sub addRuns {
+  my ($runs, $line, $pos, $pattern) = @_;
+  while ($line =~ /$pattern/g) {
+    my $start = $pos + $-[0];
+    my $length = $+[0] - $-[0];
+    if (@$runs && $runs->[-1][0] + $runs->[-1][1] == $start) {
+      $runs->[-1][1] += $length;
+    } else {
+      push @$runs, [$start, $length];
+    }
+  }
+}
+
+## merge the low-complexity runs of a seq into its masked runs.  Each
+## window whose triplet score (sum of c*(c-1)/2 over the triplet counts c,
+## by the number of triplets less one) passes $DUST_LEVEL is masked over
+## its best scoring stretch.
+sub addDust {
+  my ($runs, $seq) = @_;
+  my @dust;
+  for (my $w = 0; $w + 3 <= length($seq); $w += $DUST_WINDOW/2) {
+    my $window = substr($seq, $w, $DUST_WINDOW);
+    next if (dustScore($window) <= $DUST_LEVEL);
+    my ($start, $end) = bestStretch($window);
+    if (@dust && $dust[-1][0] + $dust[-1][1] >= $w + $start) {
+      my $runEnd = $w + $end;
+      $dust[-1][1] = $runEnd - $dust[-1][0] if ($runEnd > $dust[-1][0] + $dust[-1][1]);
+    } else {
+      push @dust, [$w + $start, $end - $start];
+    }
+  }
+  
+  my @all = sort {$a->[0] <=> $b->[0]} (@$runs, @dust);
+  @$runs = ();
+  foreach my $run (@all) {
+    if (@$runs && $runs->[-1][0] + $runs->[-1][1] >= $run->[0]) {
+      my $runEnd = $run->[0] + $run->[1];
+      $runs->[-1][1] = $runEnd - $runs->[-1][0] if ($runEnd > $runs->[-1][0] + $runs->[-1][1]);
+    } else {
+      push @$runs, [@$run];
+    }
+  }
+}
+
+sub dustScore {
+  my $text = shift;
+  my %counts;
+  my $score = 0;
+  my $n = length($text) - 2;
+  return 0 if ($n < 2);
+  for (my $i = 0; $i < $n; $i++) {
+    $score += $counts{substr($text, $i, 3)}++;
+  }
+  return $score / ($n - 1);
+}
+
+## the stretch [start, end) of a window with the highest triplet score
+sub bestStretch {
+  my $text = shift;
+  my $n = length($text) - 2;
+  my ($best, $bestStart, $bestEnd) = (-1, 0, length($text));
+  for (my $i = 0; $i < $n; $i++) {
+    my %counts;
+    my $score = 0;
+    for (my $j = $i; $j < $n; $j++) {
+      $score += $counts{substr($text, $j, 3)}++;
+      next if ($j == $i);
+      if ($score / ($j - $i) > $best) {
+        ($best, $bestStart, $bestEnd) = ($score / ($j - $i), $i, $j + 3);
+      }
+    }
+  }
+  return ($bestStart, $bestEnd);
+}
+
+## .amb and .msk files - magic, number of seqs, then per seq the number of
+## runs and each run's start and length
+sub writeRuns {
+  my ($filename, $magic, $seqRuns) = @_;
+  open(AMB,"> $filename") || die "$!";
+  binmode AMB;
+  print AMB $magic;
+  print AMB pack("I", scalar(@$seqRuns));
+  foreach my $runs (@$seqRuns) {
+    print AMB pack("I", scalar(@$runs));
+    map {print AMB pack("II", @$_)} @$runs;
+  }
+  close AMB;
+}
+
+## .dup file - magic, number of copies, then per copy the seq it copies,
+## the last seq written before it and its name (padded as in the db)
+sub writeDups {
+  my ($filename, $dups) = @_;
+  open(DUP,"> $filename") || die "$!";
+  binmode DUP;
+  print DUP "PGDUP01\0";
+  print DUP pack("I", scalar(@$dups));
+  map {print DUP pack("II", $_->[0], $_->[1]) . $_->[2]} @$dups;
+  close DUP;
 }
 
 sub translateText {
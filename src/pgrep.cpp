@@ -28,12 +28,28 @@
 #include <string>
 #include <string.h>
 #include <vector>
+#include <map>
+#include <sstream>
 #include <stdlib.h>
+#include <limits.h>
 
 #include "Properties.h"
 #include "TargetCache.h"
 #include "PrimerSearch.h"
 #include "BlastInfo.h"
+#include "MappabilityTrack.h"
+#include "QmerTable.h"
+#include "SearchOrder.h"
+#include "ResultMemo.h"
+#include "RunStats.h"
+#include "PerfCounters.h"
+#include "HitDisplay.h"
+#include "TopHits.h"
+#include "HitFile.h"
+#include "AmbiguityTable.h"
+#include "DupTable.h"
+#include "RegionList.h"
+#include "GroupTable.h"
            
 // set up target cache
 TargetCache SEQ_CACHE[CACHE_SIZE];
@@ -42,6 +58,41 @@ int cache_ptr = 0;
  // flag for full output mode
 int fullOutput = 0;
 
+// sentinel prescreen tallies, reported at exit
+int sentinelPairs = 0;
+int sentinelKilled = 0;
+
+// --stats counters and phase timings
+RunStats runStats;
+bool statsReport = false;
+bool statsJson = false;
+
+// --profile sidecar, one line per searched primer pair
+std::ofstream profileFile;
+
+// --best list of the lowest scoring hits of the current pair (NULL when
+// full output keeps the first -M hits)
+TopHits *topHits = NULL;
+
+// --format=bin output (NULL for the usual tab-delimited full output)
+HitFile *hitFile = NULL;
+
+// --ambig rule for sites with a primer over N runs or other ambiguous db
+// bases: drop them, keep them, or ignore the ambiguity tables (off).  The
+// tables are loaded the first time each db is searched.
+std::string ambigRule = "drop";
+std::map<std::string, AmbiguityTable*> ambiguityTables;
+
+// --mask rule for the masked (soft-masked or low-complexity) runs of pgrep
+// dbs: skip them, add a mismatch penalty for primers over them (a number),
+// or ignore the masks (off).  Loaded like the ambiguity tables.
+std::string maskRule = "off";
+std::map<std::string, AmbiguityTable*> maskTables;
+
+// copies left out of deduplicated pgrep dbs (NULL for dbs without a .dup
+// file).  Their hits are given by replaying those of the seq they copy.
+std::map<std::string, DupTable*> dupTables;
+
 ///////////////////////////////////////////////////////////////////////////////
 // uppercase                                                                 //
 //  inputs: primer sequence <std::string>                                    //
@@ -59,22 +110,20 @@ void uppercase(std::string &primer) {
 }
 
 ///////////////////////////////////////////////////////////////////////////////
-// longSwap                                                                  //
-//  inputs: 32-bit integer to be reversed (from big endian to little end.)   //
-//  output: swapped 32-bits                                                  //
-//    desc: blast info files are written big-endian.  Need to convert.       //
-///////////////////////////////////////////////////////////////////////////////
-
-int longSwap (int i)
-{
-  unsigned char b1, b2, b3, b4;
-
-  b1 = i & 255;
-  b2 = ( i >> 8 ) & 255;
-  b3 = ( i>>16 ) & 255;
-  b4 = ( i>>24 ) & 255;
+// isIupac                                                                   //
+//  inputs: primer sequence <std::string>                                    //
+//  output: true if every base is an IUPAC code <bool>                       //
+//    desc: degenerate bases are searched as the set of bases they stand for //
+///////////////////////////////////////////////////////////////////////////////  
 
-  return ((int)b1 << 24) + ((int)b2 << 16) + ((int)b3 << 8) + b4;
+bool isIupac(const std::string &primer) {
+  int primerLength = primer.length();
+  for (int i=0; i < primerLength; i++) {
+    if (primer[i] == '!' || primer[i] == '=' || WeightMatrix::iupac2bits(primer[i]) == 0) {
+      return false;
+    }
+  }
+  return true;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -94,120 +143,6 @@ void shortenPrimerSequence(char* primSeq, int offset) {
   }
 }
 
-///////////////////////////////////////////////////////////////////////////////
-// loadBlastInfo                                                             //
-//  inputs: blast db name <std::string>, ptr to blast info array <BlastInfo*>//
-//  output: none                                                             //
-//    desc: reads in .nin file to figure out seq names and offsets           //
-//          .nin format is hard-coded here so if the format ever changes     //
-//          this will need to be changed                                     //
-//          at the same time, reads in .nhr file for the header names        //
-///////////////////////////////////////////////////////////////////////////////  
-
-void loadBlastInfo(std::string filename, BlastInfo* biseqs[]) {
-  std::string ninFilename;
-  std::string nhrFilename;
-  ninFilename = filename + ".nin";
-  nhrFilename = filename + ".nhr";
-  
-  std::ifstream blastNinFile;
-  blastNinFile.open (ninFilename.c_str(), std::ios::in | std::ios::binary);
-  if (!blastNinFile.is_open()) { 
-    std::cerr << "Error opening blast .nin file: " << ninFilename << "\n";
-    exit(1);
-  }
-  
-  std::ifstream blastNhrFile;
-  blastNhrFile.open (nhrFilename.c_str(), std::ios::in | std::ios::binary);
-  if (!blastNhrFile.is_open()) { 
-    std::cerr << "Error opening blast .nhr file: " << nhrFilename << "\n";
-    exit(1);
-  }
-  
-  // read in formatdb version
-  int formatdb;
-  blastNinFile.read((char*)&formatdb, BLAST_INT);
-   
-  // read in blast db type
-  int blastType; 
-  blastNinFile.read((char*)&blastType, BLAST_INT);
-  if (blastType != 0) {
-  	// not a nucleotide db!
-  	std::cerr << "Error: blast file " << ninFilename << " is not a nucleotide blast db.\n";
-    exit(1);
-  }
-  
-  // read through title
-  int titleSize;
-  blastNinFile.read((char*)&titleSize, BLAST_INT);
-  titleSize = longSwap(titleSize);
-  char ignore;
-  
-  for (int i = 0; i < titleSize; ++i) {
-  	blastNinFile.read((char*)&ignore, 1);
-  }
-  
-  // read through date
-  int dateSize;
-  blastNinFile.read((char*)&dateSize, BLAST_INT);
-  dateSize = longSwap(dateSize);
-  for (int i = 0; i < dateSize; ++i) {
-  	blastNinFile.read((char*)&ignore, 1);
-  }
-  
-  // now get to the good stuff
-  int nseqs;
-  blastNinFile.read((char*)&nseqs, BLAST_INT);
-  nseqs = longSwap(nseqs);
-  if (nseqs > MAX_BLAST_ENTRIES) {
-  	std::cerr << "Error:  Blast db has too many seq entries.  Right now PGREP is limited to " << MAX_BLAST_ENTRIES << ".\n";
-  	exit(1);
-  }
-  
-  // total seq length appears to be little-endian, 64 bit
-  long long int tseq;
-  blastNinFile.read((char*)&tseq, BLAST_INT*2);
-  
-  int maxseq;
-  blastNinFile.read((char*)&maxseq, BLAST_INT);
-  maxseq = longSwap(maxseq);
-    
-  // loop through the seq names
-  int lastOffset;
-  int nextOffset;
-  blastNinFile.read((char*)&lastOffset, BLAST_INT);
-  lastOffset = longSwap(lastOffset);
-  char ignoreText[8];
-  char seqName[256];
- 
-  for (int i = 0; i < nseqs; ++i) {
-    blastNinFile.read((char*)&nextOffset, BLAST_INT);
-  	nextOffset = longSwap(nextOffset);
-  	
-  	// read text from the last to next offset
-  	// - the first 8 chars get tossed - not sure what this is
-  	// - also toss last 32 chars... 
-  	blastNhrFile.read((char*)&ignoreText, 8);
-  	blastNhrFile.read((char*)&seqName, (nextOffset - (lastOffset + 8)));
-  	seqName[nextOffset - (lastOffset + 40)] = '\0';
-  	biseqs[i] = new BlastInfo(seqName);
-  	lastOffset = nextOffset;
-  }
-  
-  blastNinFile.read((char*)&lastOffset, BLAST_INT);
-  lastOffset = longSwap(lastOffset);
-  
-  for (int i = 0; i < nseqs; ++i) {
-    blastNinFile.read((char*)&nextOffset, BLAST_INT);
-  	nextOffset = longSwap(nextOffset);
-
-    biseqs[i]->setStartOffset(lastOffset);
-    biseqs[i]->setSeqLength(nextOffset-lastOffset); 
-  	lastOffset = nextOffset;
-  }
-  biseqs[nseqs] = NULL;  
-}
-  
 ///////////////////////////////////////////////////////////////////////////////
 // createPrimerPair                                                          //
 //  inputs:  left primer, right primer, target size, noRevC                  //
@@ -235,6 +170,10 @@ PrimerPair* createPrimerPair(std::string primerId, std::string leftPrimer, std::
 
 	uppercase(leftPrimer);
 	uppercase(rightPrimer);
+	if (!isIupac(leftPrimer) || !isIupac(rightPrimer)) {
+	  std::cerr << "ERROR:  " << primerId << " primers may only use IUPAC base codes.\n";
+	  exit(1);
+	}
 	return new PrimerPair(primerId, leftPrimer, rightPrimer, productSize);
 }
 
@@ -399,6 +338,12 @@ PrimerPair* readPrimersFromStdin(std::string &preamble, std::string &bldrText, b
 void addHitsToCache (PrimerSearch *ps, int &curMatchCount, char *seqName, char *buffer, 
                      unsigned int startPos, int bufferStart, int bufferEnd, int notAtEnd) {
   int matchCount = ps->getMatchCount();
+  
+  // a count-only search keeps just the latest hits, which are the ones
+  // that would be left in the cache anyway
+  if (curMatchCount < ps->getFirstSite()) {
+    curMatchCount = ps->getFirstSite();
+  }
   for (int i = curMatchCount; i < matchCount; i++) {
     PrimingSite *match = ps->getPrimingSite(i);
     unsigned int start;
@@ -427,179 +372,205 @@ void addHitsToCache (PrimerSearch *ps, int &curMatchCount, char *seqName, char *
     
     SEQ_CACHE[cache_ptr].copyBuffer(seqName, start, end,
                                     buffer, BUFFERSIZE*2,
-                                    bStart, (bEnd - bStart + 1));  
+                                    bStart, (bEnd - bStart + 1), ps->getAmbiguities(), ps->getMask());  
     cache_ptr = (cache_ptr + 1) % CACHE_SIZE;
   }  
   curMatchCount = matchCount; // all hits accounted for
 }  
 
-// does simple bp by bp comparison and returns " || "
-// style alignment + weighted alignment score
-
 ///////////////////////////////////////////////////////////////////////////////
-// makeAlignment                                                             //
-//  inputs: primer direction <PrimerDirection>, whether no rev compl req<int>//
-//          primer search <PrimerSearch>, alignment string <std::string>,    //
-//          primer sequence <std::string>, template seq <std::string>        //
-//  output: mismatch score <int>                                             //
-//    desc: accepts a primer and template sequence and produces and alignment//
-//          string by placing an '|' at positions where the two strings agree//
-//          At the same time, a mismatch score is computed.                  //
+// displayHits                                                               //
+//  inputs: as displayHits in HitDisplay.cpp, less the stream                //
+//  output: none                                                             //
+//    desc: writes full-output results to STDOUT, charged to the output phase//
 /////////////////////////////////////////////////////////////////////////////// 
+  
+void displayHits (PrimerSearch *ps, int &disMatchCount, char *seqName, char *buffer, 
+                  unsigned int startPos, int bufferStart, int bufferEnd, int notAtEnd) {
+  RunPhase lastPhase = runStats.enterPhase(PHASE_OUTPUT);
+  if (hitFile != NULL) {
+    writeHits(hitFile, ps, disMatchCount, topHits);
+  }
+  else {
+    displayHits(std::cout, ps, disMatchCount, seqName, buffer, startPos, bufferStart, bufferEnd, notAtEnd, topHits);
+  }
+  runStats.enterPhase(lastPhase);
+} 
 
-int makeAlignment(PrimerDirection primer, int dir, PrimerSearch* ps, std::string &align, std::string seq1, std::string seq2) {
-  int seqLen = seq1.length();
-  align = seq1;
-  int kmm = 0;
-  for (int i=0; i < seqLen; i++) {
-    if (seq1[i] == seq2[i]) {
-      align[i] = '|';
-    }
-    else {
-      align[i] = ' ';
-      
-    }
-    kmm += ps->getWeight(primer, (1-dir)*i +dir*(seqLen - i - 1), (1-dir)*(seqLen - i - 1) + dir*i, seq1[i], seq2[i]);
+///////////////////////////////////////////////////////////////////////////////
+// getAmbiguityTable                                                         //
+//  inputs: db filename <std::string>, blast db flag <bool>                  //
+//  output: the db's ambiguity table, NULL if it has none <AmbiguityTable*>  //
+//    desc: with --ambig=off no tables are used and every base is scanned    //
+///////////////////////////////////////////////////////////////////////////////  
 
+AmbiguityTable *getAmbiguityTable(std::string filename, bool isBlast) {
+  if (ambigRule == "off") {
+    return NULL;
+  }
+  std::map<std::string, AmbiguityTable*>::iterator found = ambiguityTables.find(filename);
+  if (found != ambiguityTables.end()) {
+    return found->second;
   }
-  return kmm;  
+  
+  AmbiguityTable *table = new AmbiguityTable();
+  if (!table->load(filename, isBlast)) {
+    delete table;
+    table = NULL;
+  }
+  ambiguityTables[filename] = table;
+  return table;
 }
 
+///////////////////////////////////////////////////////////////////////////////
+// getMaskTable                                                              //
+//  inputs: db filename <std::string>, blast db flag <bool>                  //
+//  output: the db's masked runs, NULL if it has none <AmbiguityTable*>      //
+//    desc: only pgrep dbs have masks, and only with --mask set              //
+///////////////////////////////////////////////////////////////////////////////  
 
-void substr(char *newSt, char *st, int start, int ln) {
-  for (int i=0; i < ln; i++) {
-    newSt[i] = st[i + start];
+AmbiguityTable *getMaskTable(std::string filename, bool isBlast) {
+  if (maskRule == "off" || isBlast) {
+    return NULL;
   }
-  newSt[ln] = '\0';
+  std::map<std::string, AmbiguityTable*>::iterator found = maskTables.find(filename);
+  if (found != maskTables.end()) {
+    return found->second;
+  }
+  
+  AmbiguityTable *table = new AmbiguityTable();
+  if (!table->loadMask(filename)) {
+    delete table;
+    table = NULL;
+  }
+  maskTables[filename] = table;
+  return table;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
-// displayHits                                                               //
-//  inputs: primer search <PrimerSearch*>, number of matches found<int>,     //
-//          name of seq being searched <char*>, seq buffer <char*>, start    //
-//          pos in seq <int>, buffer start pos <int>, buffer stop pos <int>, //
-//          flag whether we're at end of seq <int>                           //
+// getDupTable                                                               //
+//  inputs: pgrep db filename <std::string>                                  //
+//  output: the db's duplicate table, NULL if it has none <DupTable*>        //
+///////////////////////////////////////////////////////////////////////////////  
+
+DupTable *getDupTable(std::string filename) {
+  std::map<std::string, DupTable*>::iterator found = dupTables.find(filename);
+  if (found != dupTables.end()) {
+    return found->second;
+  }
+  
+  DupTable *table = new DupTable();
+  if (!table->load(filename)) {
+    delete table;
+    table = NULL;
+  }
+  dupTables[filename] = table;
+  return table;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// releaseHits                                                               //
+//  inputs: primer search <PrimerSearch*>, hits displayed <int>, hits        //
+//          cached <int>, too many hits in the buffer <bool>                 //
 //  output: none                                                             //
-//    desc: produces tab-delimited full-output results                       //
+//    desc: in --best mode frees the hits that have been offered to the best //
+//          hit list, so a pair only ever holds one slice's worth of hits    //
+//          (BEST_SLICE).  Only a slice with more hits than that fills up,   //
+//          and the rest of it is then skipped.                              //
 /////////////////////////////////////////////////////////////////////////////// 
+
+void releaseHits(PrimerSearch *ps, int disMatchCount, int curMatchCount, bool tooManyHits) {
+  if (topHits == NULL) {
+    return;
+  }
+  if (tooManyHits) {
+    std::cerr << "WARNING:  Primer pair [" << ps->getPrimerPair()->getId() << "] has over " << MAX_MATCHES
+              << " hits within " << BEST_SLICE*4 << " bases.  Best hits skip the rest of those bases.\n";
+  }
+  ps->releaseSites((disMatchCount < curMatchCount) ? disMatchCount : curMatchCount);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// searchCopies                                                              //
+//  inputs: open pgrep db file <ifstream>, its duplicate table <DupTable*>,  //
+//          stored seq just searched <int>, primer search <PrimerSearch*>,   //
+//          max number hits <int>, show hits <bool>, buffer <char*>, sites   //
+//          of each seq with copies <map>, where each seq's bases start and  //
+//          its size <vector>, ambiguity and mask tables <AmbiguityTable*>   //
+//  output: true if too many priming sites                                   //
+//    desc: gives the hits of the copies that followed the seq in the fasta  //
+//          file by replaying the sites of the seq each one copies.  Only    //
+//          the bytes around the hits are read back, to display them.  With  //
+//          --best the sites are replayed at most max hits at a time.        //
+/////////////////////////////////////////////////////////////////////////////// 
+
+bool searchCopies(std::ifstream &targetFile, DupTable *dupTable, int seq, PrimerSearch *ps, int maxHits, bool cacheHits,
+                  char *buffer, std::map<int, std::vector<SiteCall> > &siteLogs,
+                  std::vector<std::streampos> &seqStarts, std::vector<unsigned int> &seqSizes,
+                  AmbiguityTable *ambTable, AmbiguityTable *maskTable) {
+  const std::vector<DupSeq> &dups = dupTable->getDups();
+  char seqName[MAX_SEQNAME_SIZE];
   
-void displayHits (PrimerSearch *ps, int &disMatchCount, char *seqName, char *buffer, 
-                  unsigned int startPos, int bufferStart, int bufferEnd, int notAtEnd) {
-  int matchCount = ps->getMatchCount();
-  
-  for (int i = disMatchCount; i < matchCount; i++) {
-    PrimingSite *match = ps->getPrimingSite(i);
-    unsigned int start = match->getForPos();
-    
-    int bStart = int(start - startPos - 1);
-    // todo - put in a real floor function
-    if (bStart < 0) {
-      bStart -= 3;
-    }
-    bStart = int(bStart/4) + bufferStart; 
-    
-    unsigned int end = match->getRevPos();
-    int bEnd = int((int(end - startPos - 1))/4) + bufferStart;
+  for (unsigned int d = dupTable->firstAfter(seq); d < dups.size() && dups[d].after == (unsigned int) seq; d++) {
+    int rep = dups[d].rep;
+    strncpy(seqName, dups[d].name.c_str(), MAX_SEQNAME_SIZE - 1);
+    seqName[MAX_SEQNAME_SIZE-1] = '\0';
+    ps->reset(seqName);
+    ps->setAmbiguities((ambTable != NULL) ? ambTable->getRuns(rep) : NULL);
+    ps->setMask((maskTable != NULL) ? maskTable->getRuns(rep) : NULL);
+    int disMatchCount = ps->getMatchCount();
+    const std::vector<SiteCall> &calls = siteLogs[rep];
+    unsigned int batch = (topHits != NULL) ? maxHits : calls.size();
+    bool tooManyHits = false;
     
-    if (bEnd >= bufferEnd) {
-      if (notAtEnd) {
-        // too close to edge... skip remaining hits and move on to next
-        // scan
-        disMatchCount = i;
-        return;
+    for (unsigned int call=0, end=0; call < calls.size() && !tooManyHits; call = end) {
+      // a site can only repeat one with the same 3' end, so those stay in
+      // one batch (the release between batches forgets the sites seen)
+      end = std::min((unsigned int) calls.size(), call + batch);
+      while (end < calls.size() && end > call + 1 && calls[end].revPos == calls[end-1].revPos) {
+        --end;
       }
-      else {
-        std::cerr << "FATAL ERROR:  Match fell outside of buffer area." << "\n";
-        exit(1);
-      }
-    }
-    char* sequence = PrimerSearch::convertToSequence(buffer, BUFFERSIZE*2, bStart, (bEnd - bStart + 1));  
-                                    
-    PrimerPair *pp = ps->getPrimerPair();
-
-    std::cout << pp->getId() << "\t" << match->getSeqName() << "\t" << match->getForPos() << "\t";
-    std::cout << match->getRevPos() << "\t" << match->getStrand() << "\t" << (match->getRevPos() - match->getForPos() + 1);
-    std::cout << "\t";
-
-    // amp seq
-    int ampStart = ((start-startPos-1) % 4);
-    //int ampStop = ((bEnd-bStart)*4 + ((end - startPos) % 4));
-    int ampLength = end-start+1;
-     
-    char amp[MAX_AMP_SIZE];
-    substr(amp,sequence,ampStart,ampLength);
-    
-    // primer info
-    std::string forSeq;
-    std::string revSeq;
-    std::string forPrimerSeq;
-    if (match->getForDir() == FOR || match->getStrand()) {
-    	forPrimerSeq = pp->getForPrimer();
-    }
-    else {
-    	forPrimerSeq = pp->getRevPrimer();
-    }
-
-    std::string revPrimerSeq;
-    if (match->getRevDir() == REV || match->getStrand()) {
-        	revPrimerSeq = pp->getRevPrimer();
-    }
-    else {
-        	revPrimerSeq = pp->getForPrimer();
-    }
-
-    std::string align;
-    int forLength = forPrimerSeq.length();
-    int revLength = revPrimerSeq.length();
-    int kmm;
-    if (match->getStrand()) {
-      // reverse strand, so use end of amplicon
-      forSeq.assign(amp,ampLength-forLength,forLength);
-      forSeq = PrimerSearch::reverseComplement(forSeq);      
-      revSeq.assign(amp,0,revLength);
- 
-      if (ps->getNoRevC()) {
-        revSeq = PrimerSearch::reverseComplement(revSeq);
+      tooManyHits = ps->replaySites(calls, call, end, maxHits);
+      
+      if (cacheHits && fullOutput && ps->getMatchCount() > disMatchCount) {
+        std::streampos resume = targetFile.tellg();
+        while (disMatchCount < ps->getMatchCount()) {
+          // read from a max amplicon before the next hit's 3' end, as the
+          // hits after it may start that far back
+          PrimingSite *site = ps->getPrimingSite(disMatchCount);
+          unsigned int lead = ps->getMaxAmpSize() + BUFFER_FLANK;
+          unsigned int first = (site->getRevPos() > lead) ? site->getRevPos() - lead : 0;
+          unsigned int startByte = std::min(first, site->getForPos() - 1)/4;
+          unsigned int size = std::min((unsigned int) BUFFERSIZE*2, seqSizes[rep] - startByte);
+          targetFile.clear();
+          targetFile.seekg(seqStarts[rep] + (std::streamoff) startByte);
+          targetFile.read(buffer, size);
+          runStats.countBytesRead(size);
+          displayHits(ps,disMatchCount,seqName,buffer,startByte*4,0,size,seqSizes[rep] - startByte - size);
+        }
+        targetFile.seekg(resume);
       }
+      
+      releaseHits(ps, disMatchCount, ps->getMatchCount(), tooManyHits);
     }
-    else {
-      forSeq.assign(amp,0,forLength);
-      revSeq.assign(amp,ampLength-revLength,revLength);
-      if (!ps->getNoRevC()) {
-        revSeq = PrimerSearch::reverseComplement(revSeq);
-      }
+    if (tooManyHits) {
+      return true;
     }
-    std::cout << forPrimerSeq << "\t";      
-    kmm = makeAlignment(FOR, 0, ps, align, forPrimerSeq, forSeq);
-    std::cout << align << "\t";
-    std::cout << forSeq << "\t" << kmm << "\t";
-    
-    std::cout << revPrimerSeq << "\t";
-    int dir = (ps->getNoRevC()) ? 1 : 0;
-    
-    kmm = makeAlignment(REV, dir, ps, align, revPrimerSeq, revSeq);
-    std::cout << align << "\t";
-    std::cout << revSeq << "\t" << kmm << "\t";
-    
-    // dump amplicon as well
-    std::cout << amp << "\n";
-   
-  }  
-   
-  // everything displayed
-  disMatchCount = matchCount;
- 
-} 
+  }
+  return false;
+}
 
 ///////////////////////////////////////////////////////////////////////////////
 // searchFile                                                                //
 //  inputs: pgrep db filename <std::string>, max allowed mm <int>,           //
-//          max number hits <int>, primer search <PrimerSearch*>             //
+//          max number hits <int>, primer search <PrimerSearch*>,            //
+//          add hits to target cache <bool>                                  //
 //  output: true if too many priming sites                                   //
-//    desc: runs the core search alg on a single pgrep db file               //
+//    desc: runs the core search alg on a single pgrep db file.  The copies  //
+//          left out of a deduplicated db are not searched (searchCopies).   //
 /////////////////////////////////////////////////////////////////////////////// 
   
-bool searchFile(std::string filename, int kmm, int maxHits, PrimerSearch *ps) {
+bool searchFile(std::string filename, int kmm, int maxHits, PrimerSearch *ps, bool cacheHits) {
 
   // open file 
   //  create a buffer that is twice as big as we need so
@@ -614,6 +585,13 @@ bool searchFile(std::string filename, int kmm, int maxHits, PrimerSearch *ps) {
   char seqName[MAX_SEQNAME_SIZE];
   bool tooManyHits;
   //targetFile.open (filename, std::ios::in | std::ios::binary);
+  AmbiguityTable *ambTable = getAmbiguityTable(filename, false);
+  AmbiguityTable *maskTable = getMaskTable(filename, false);
+  DupTable *dupTable = getDupTable(filename);
+  std::map<int, std::vector<SiteCall> > siteLogs;
+  std::vector<std::streampos> seqStarts;
+  std::vector<unsigned int> seqSizes;
+  int seq = 0;
 
   while (targetFile.read(seqName,MAX_SEQNAME_SIZE)) {
     // first read in name and size of seq
@@ -626,6 +604,13 @@ bool searchFile(std::string filename, int kmm, int maxHits, PrimerSearch *ps) {
     
     // reset search for start of new sequence
     ps->reset(seqName);
+    ps->setAmbiguities((ambTable != NULL) ? ambTable->getRuns(seq) : NULL);
+    ps->setMask((maskTable != NULL) ? maskTable->getRuns(seq) : NULL);
+    if (dupTable != NULL) {
+      ps->setSiteLog(dupTable->hasDups(seq) ? &siteLogs[seq] : NULL);
+      seqStarts.push_back(targetFile.tellg());
+      seqSizes.push_back(seqSize);
+    }
        
     // record current number of matches so we can cache new hits
     curMatchCount = ps->getMatchCount();
@@ -641,34 +626,49 @@ bool searchFile(std::string filename, int kmm, int maxHits, PrimerSearch *ps) {
         curBuffer = BUFFERSIZE;
       }
       targetFile.read(buffer + (bufferHalf*BUFFERSIZE),curBuffer);
+      runStats.countBytesRead(curBuffer);
       if (!targetFile) {
         // error!!! did not have enough seq!
         std::cerr << "Error: Not enough sequence found when reading from file: " << filename << "\n";
         exit(0);
       } 
-      tooManyHits = ps->findPattern(buffer, (bufferHalf*BUFFERSIZE), (bufferHalf*BUFFERSIZE)+ curBuffer, position, maxHits);
-       
-      // any caching to do?
-      if (ps->getMatchCount() > curMatchCount) {
-        // produce output? 
-        if (fullOutput) { 
-          displayHits(ps,disMatchCount,seqName,buffer,position,bufferHalf*BUFFERSIZE,
-                       (bufferHalf*BUFFERSIZE)+ curBuffer,(seqSize-curBuffer)); 
-        }
-        // add to cache        
-        addHitsToCache(ps,curMatchCount,seqName,buffer,position,bufferHalf*BUFFERSIZE,
-                       (bufferHalf*BUFFERSIZE)+ curBuffer,(seqSize-curBuffer)); 
-      }
       
-      if (tooManyHits && (!fullOutput || (disMatchCount == ps->getMatchCount()))) {
-        return true;
+      // --best scans the buffer in slices, releasing the hits of each
+      int sliceSize = (topHits != NULL) ? (int) BEST_SLICE : curBuffer;
+      for (int slice=0; slice < curBuffer; slice += sliceSize) {
+        tooManyHits = ps->findPattern(buffer, (bufferHalf*BUFFERSIZE) + slice, (bufferHalf*BUFFERSIZE) + std::min(curBuffer, slice + sliceSize),
+                                      position + slice*4, maxHits);
+        
+        // any caching to do?
+        if (cacheHits && ps->getMatchCount() > curMatchCount) {
+          // produce output? 
+          if (fullOutput) { 
+            displayHits(ps,disMatchCount,seqName,buffer,position,bufferHalf*BUFFERSIZE,
+                         (bufferHalf*BUFFERSIZE)+ curBuffer,(seqSize-curBuffer)); 
+          }
+          // add to cache        
+          addHitsToCache(ps,curMatchCount,seqName,buffer,position,bufferHalf*BUFFERSIZE,
+                         (bufferHalf*BUFFERSIZE)+ curBuffer,(seqSize-curBuffer)); 
+        }
+        
+        releaseHits(ps, disMatchCount, curMatchCount, tooManyHits);
+        if (tooManyHits && topHits == NULL && (!fullOutput || (disMatchCount == ps->getMatchCount()))) {
+          ps->setSiteLog(NULL);
+          return true;
+        }
       }
       position += curBuffer*4;
       seqSize -= curBuffer;
       bufferHalf = (bufferHalf + 1) % 2;
     }
-           
     
+    // then the copies of earlier seqs that followed it
+    ps->setSiteLog(NULL);
+    if (dupTable != NULL && searchCopies(targetFile, dupTable, seq, ps, maxHits, cacheHits, buffer, siteLogs,
+                                         seqStarts, seqSizes, ambTable, maskTable)) {
+      return true;
+    }
+    ++seq;
   }
   targetFile.close();
  
@@ -705,6 +705,7 @@ bool searchBlastFile(std::string tfilename, int kmm, int maxHits, PrimerSearch *
   char ignore;
   //std::cerr << "Read file\n";
   targetFile.read((char*)&ignore, 1);
+  AmbiguityTable *ambTable = getAmbiguityTable(tfilename, true);
   
   int bi = 0;
   while (blastInfo[bi] != NULL) {
@@ -715,8 +716,12 @@ bool searchBlastFile(std::string tfilename, int kmm, int maxHits, PrimerSearch *
 
     unsigned int seqSize = blastInfo[bi]->getSeqLength();
     
+    // each seq's ambiguity table sits between it and the next one
+    targetFile.seekg(blastInfo[bi]->getStartOffset(), std::ios::beg);
+    
     // reset search for start of new sequence
     ps->reset(blastInfo[bi]->getSeqName());
+    ps->setAmbiguities((ambTable != NULL) ? ambTable->getRuns(bi) : NULL);
        
     // record current number of matches so we can cache new hits
     curMatchCount = ps->getMatchCount();
@@ -730,28 +735,35 @@ bool searchBlastFile(std::string tfilename, int kmm, int maxHits, PrimerSearch *
         curBuffer = BUFFERSIZE;
       }
       targetFile.read(buffer + (bufferHalf*BUFFERSIZE),curBuffer);
+      runStats.countBytesRead(curBuffer);
       if (!targetFile) {
         // error!!! did not have enough seq!
         std::cerr << "Error: Not enough sequence found when reading from file: " << filename << "\n";
         exit(0);
       } 
       
-      tooManyHits = ps->findPattern(buffer, (bufferHalf*BUFFERSIZE), (bufferHalf*BUFFERSIZE)+ curBuffer, position, maxHits);
-       
-      // any caching to do?
-      if (ps->getMatchCount() > curMatchCount) {
-        // produce output? 
-        if (fullOutput) { 
-          displayHits(ps,disMatchCount,blastInfo[bi]->getSeqName(),buffer,position,bufferHalf*BUFFERSIZE,
-                       (bufferHalf*BUFFERSIZE)+ curBuffer,(seqSize-curBuffer)); 
-        }
-        // add to cache        
-        addHitsToCache(ps,curMatchCount,blastInfo[bi]->getSeqName(),buffer,position,bufferHalf*BUFFERSIZE,
-                       (bufferHalf*BUFFERSIZE)+ curBuffer,(seqSize-curBuffer)); 
-      }
-      
-      if (tooManyHits && (!fullOutput || (disMatchCount == ps->getMatchCount()))) {
-        return true;
+      // --best scans the buffer in slices, releasing the hits of each
+      int sliceSize = (topHits != NULL) ? (int) BEST_SLICE : curBuffer;
+      for (int slice=0; slice < curBuffer; slice += sliceSize) {
+        tooManyHits = ps->findPattern(buffer, (bufferHalf*BUFFERSIZE) + slice, (bufferHalf*BUFFERSIZE) + std::min(curBuffer, slice + sliceSize),
+                                      position + slice*4, maxHits);
+        
+        // any caching to do?
+        if (ps->getMatchCount() > curMatchCount) {
+          // produce output? 
+          if (fullOutput) { 
+            displayHits(ps,disMatchCount,blastInfo[bi]->getSeqName(),buffer,position,bufferHalf*BUFFERSIZE,
+                         (bufferHalf*BUFFERSIZE)+ curBuffer,(seqSize-curBuffer)); 
+          }
+          // add to cache        
+          addHitsToCache(ps,curMatchCount,blastInfo[bi]->getSeqName(),buffer,position,bufferHalf*BUFFERSIZE,
+                         (bufferHalf*BUFFERSIZE)+ curBuffer,(seqSize-curBuffer)); 
+        }
+        
+        releaseHits(ps, disMatchCount, curMatchCount, tooManyHits);
+        if (tooManyHits && topHits == NULL && (!fullOutput || (disMatchCount == ps->getMatchCount()))) {
+          return true;
+        }
       }
       position += curBuffer*4;
       seqSize -= curBuffer;
@@ -776,7 +788,7 @@ bool searchBlastFile(std::string tfilename, int kmm, int maxHits, PrimerSearch *
 
 bool searchAllDbFiles(PrimerSearch *ps, int kmm, int maxHits, std::vector<std::string> dbFiles, int dbIndex) {
   for (int i=0; i < dbIndex; i++) {
-    if(searchFile(dbFiles[i], kmm, maxHits, ps)) {
+    if(searchFile(dbFiles[i], kmm, maxHits, ps, true)) {
       return true;
     }
   }
@@ -803,6 +815,219 @@ bool searchAllBlastFiles(PrimerSearch *ps, int kmm, int maxHits, std::vector<std
   return false;
 }   
 
+///////////////////////////////////////////////////////////////////////////////
+// searchInOrder                                                             //
+//  inputs: primer search pointer, number allowed mm, max number of hits,    //
+//          search order <SearchOrder*>                                      //
+//  output: true if primers found and exceed max hits, false otherwise       //
+//    desc: searches every seq of a db set in adaptive order (-O).  Each seq //
+//          that hits is promoted so the next primer pair tries it first.    //
+/////////////////////////////////////////////////////////////////////////////// 
+
+bool searchInOrder(PrimerSearch *ps, int kmm, int maxHits, SearchOrder *order) {
+
+  char buffer[BUFFERSIZE*2];
+  std::vector<int> volumes = order->getVolumeOrder();
+  
+  for (unsigned int v=0; v < volumes.size(); v++) {
+    SequenceDb *db = order->getDb(volumes[v]);
+    std::vector<int> seqs = order->getSeqOrder(volumes[v]);
+    AmbiguityTable *ambTable = getAmbiguityTable(db->getFilename(), db->isBlastDb());
+    AmbiguityTable *maskTable = getMaskTable(db->getFilename(), db->isBlastDb());
+    
+    for (unsigned int s=0; s < seqs.size(); s++) {
+      int bufferHalf = 0;
+      unsigned int position = 0;
+      unsigned int seqStart = 0;
+      unsigned int seqSize = db->getSeqSize(seqs[s]);
+      bool tooManyHits = false;
+      
+      // reset search for start of new sequence
+      ps->reset(db->getSeqName(seqs[s]));
+      ps->setAmbiguities((ambTable != NULL) ? ambTable->getRuns(db->getStoredSeq(seqs[s])) : NULL);
+      ps->setMask((maskTable != NULL) ? maskTable->getRuns(db->getStoredSeq(seqs[s])) : NULL);
+      int curMatchCount = ps->getMatchCount();
+      int seqMatchCount = ps->getMatchCount();
+      
+      while (seqSize && !tooManyHits) {
+        int curBuffer = (seqSize < BUFFERSIZE) ? seqSize : BUFFERSIZE;
+        db->readSeq(seqs[s], seqStart, curBuffer, buffer + (bufferHalf*BUFFERSIZE));
+        runStats.countBytesRead(curBuffer);
+        tooManyHits = ps->findPattern(buffer, (bufferHalf*BUFFERSIZE), (bufferHalf*BUFFERSIZE)+ curBuffer, position, maxHits);
+        
+        if (ps->getMatchCount() > curMatchCount) {
+          addHitsToCache(ps,curMatchCount,db->getSeqName(seqs[s]),buffer,position,bufferHalf*BUFFERSIZE,
+                         (bufferHalf*BUFFERSIZE)+ curBuffer,(seqSize-curBuffer)); 
+        }
+        position += curBuffer*4;
+        seqStart += curBuffer;
+        seqSize -= curBuffer;
+        bufferHalf = (bufferHalf + 1) % 2;
+      }
+      
+      if (ps->getMatchCount() > seqMatchCount) {
+        order->promote(volumes[v], seqs[s]);
+      }
+      if (tooManyHits) {
+        return true;
+      }
+    }
+  }
+  
+  return false;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// searchRegions                                                             //
+//  inputs: primer search pointer, number allowed mm, max number of hits,    //
+//          db files <vector SequenceDb*>, regions to search <RegionList*>   //
+//  output: true if primers found and exceed max hits, false otherwise       //
+//    desc: searches only the listed regions (--regions, --seqs) of every   //
+//          db, padded by the pair's max amplicon size, seeking straight to  //
+//          each one.  Each range is searched as a seq of its own, and only  //
+//          amplicons overlapping a region are kept.  Hits are not cached,   //
+//          since their flanks may lie outside the ranges read.              //
+/////////////////////////////////////////////////////////////////////////////// 
+
+bool searchRegions(PrimerSearch *ps, int kmm, int maxHits, std::vector<SequenceDb*> &dbs, RegionList *regions) {
+
+  char buffer[BUFFERSIZE*2];
+  std::vector<BaseRun> ranges;
+  
+  for (unsigned int v=0; v < dbs.size(); v++) {
+    SequenceDb *db = dbs[v];
+    AmbiguityTable *ambTable = getAmbiguityTable(db->getFilename(), db->isBlastDb());
+    AmbiguityTable *maskTable = getMaskTable(db->getFilename(), db->isBlastDb());
+    
+    for (int s=0; s < db->getSeqCount(); s++) {
+      regions->getByteRanges(db->getSeqName(s), db->getSeqSize(s), ps->getMaxAmpSize(), ranges);
+      
+      for (unsigned int r=0; r < ranges.size(); r++) {
+        int bufferHalf = 0;
+        unsigned int seqStart = ranges[r].start;
+        unsigned int position = seqStart*4;
+        unsigned int seqSize = ranges[r].length;
+        
+        // reset search for start of new range
+        ps->reset(db->getSeqName(s));
+        ps->setAmbiguities((ambTable != NULL) ? ambTable->getRuns(db->getStoredSeq(s)) : NULL);
+        ps->setMask((maskTable != NULL) ? maskTable->getRuns(db->getStoredSeq(s)) : NULL);
+        ps->setRegions(regions->getRegions(db->getSeqName(s)));
+        int disMatchCount = ps->getMatchCount();
+        
+        while (seqSize) {
+          int curBuffer = (seqSize < BUFFERSIZE) ? seqSize : BUFFERSIZE;
+          db->readSeq(s, seqStart, curBuffer, buffer + (bufferHalf*BUFFERSIZE));
+          runStats.countBytesRead(curBuffer);
+          
+          // --best scans the buffer in slices, releasing the hits of each
+          int sliceSize = (topHits != NULL) ? (int) BEST_SLICE : curBuffer;
+          for (int slice=0; slice < curBuffer; slice += sliceSize) {
+            bool tooManyHits = ps->findPattern(buffer, (bufferHalf*BUFFERSIZE) + slice,
+                                               (bufferHalf*BUFFERSIZE) + std::min(curBuffer, slice + sliceSize), position + slice*4, maxHits);
+            
+            if (fullOutput && ps->getMatchCount() > disMatchCount) {
+              displayHits(ps,disMatchCount,db->getSeqName(s),buffer,position,bufferHalf*BUFFERSIZE,
+                          (bufferHalf*BUFFERSIZE)+ curBuffer,(seqSize-curBuffer));
+            }
+            
+            releaseHits(ps, disMatchCount, ps->getMatchCount(), tooManyHits);
+            if (tooManyHits && topHits == NULL && (!fullOutput || (disMatchCount == ps->getMatchCount()))) {
+              return true;
+            }
+          }
+          position += curBuffer*4;
+          seqStart += curBuffer;
+          seqSize -= curBuffer;
+          bufferHalf = (bufferHalf + 1) % 2;
+        }
+      }
+    }
+  }
+  
+  return false;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// searchGroups                                                              //
+//  inputs: primer searches of a batch of pairs <vector PrimerSearch*>,      //
+//          db files <vector SequenceDb*>, sequence groups <GroupTable*>,    //
+//          counts to add to, by pair and group <vector vector int>          //
+//  output: none                                                             //
+//    desc: the --groups search.  Each seq in a group is read once for the   //
+//          whole batch, and the pairs scan it in turn a slice at a time so  //
+//          the slice is still in cache for the next pair.  A pair stops at  //
+//          its first site in a seq, which then counts once for each of the  //
+//          seq's groups.  Copies in a deduplicated db take the result of    //
+//          the seq they copy.                                               //
+/////////////////////////////////////////////////////////////////////////////// 
+
+void searchGroups(std::vector<PrimerSearch*> &batch, std::vector<SequenceDb*> &dbs, GroupTable *groups,
+                  std::vector<std::vector<int> > &counts) {
+
+  char buffer[BUFFERSIZE*2];
+  std::vector<int> seqMatchCount(batch.size());
+  
+  for (unsigned int v=0; v < dbs.size(); v++) {
+    SequenceDb *db = dbs[v];
+    AmbiguityTable *ambTable = getAmbiguityTable(db->getFilename(), db->isBlastDb());
+    AmbiguityTable *maskTable = getMaskTable(db->getFilename(), db->isBlastDb());
+    std::map<int, std::vector<bool> > seqHits; // by stored seq, which pairs hit it
+    
+    for (int s=0; s < db->getSeqCount(); s++) {
+      const std::vector<int> *seqGroups = groups->getGroups(db->getSeqName(s));
+      if (seqGroups == NULL) {
+        continue;
+      }
+      int stored = db->getStoredSeq(s);
+      std::map<int, std::vector<bool> >::iterator found = seqHits.find(stored);
+      if (found == seqHits.end()) {
+        std::vector<bool> &hit = seqHits[stored];
+        hit.resize(batch.size(), false);
+        for (unsigned int p=0; p < batch.size(); p++) {
+          batch[p]->reset(db->getSeqName(s));
+          batch[p]->setAmbiguities((ambTable != NULL) ? ambTable->getRuns(stored) : NULL);
+          batch[p]->setMask((maskTable != NULL) ? maskTable->getRuns(stored) : NULL);
+          seqMatchCount[p] = batch[p]->getMatchCount();
+        }
+        
+        unsigned int pending = batch.size();
+        int bufferHalf = 0;
+        unsigned int position = 0;
+        unsigned int seqStart = 0;
+        unsigned int seqSize = db->getSeqSize(s);
+        while (seqSize && pending > 0) {
+          unsigned int curBuffer = (seqSize < BUFFERSIZE) ? seqSize : BUFFERSIZE;
+          db->readSeq(s, seqStart, curBuffer, buffer + (bufferHalf*BUFFERSIZE));
+          runStats.countBytesRead(curBuffer);
+          for (unsigned int slice=0; slice < curBuffer && pending > 0; slice += GROUP_SLICE) {
+            int sliceStart = (bufferHalf*BUFFERSIZE) + slice;
+            int sliceEnd = (bufferHalf*BUFFERSIZE) + std::min(curBuffer, slice + GROUP_SLICE);
+            for (unsigned int p=0; p < batch.size(); p++) {
+              // "too many hits" here is the first one in this seq
+              if (!hit[p] && batch[p]->findPattern(buffer, sliceStart, sliceEnd, position + slice*4, seqMatchCount[p])) {
+                hit[p] = true;
+                --pending;
+              }
+            }
+          }
+          position += curBuffer*4;
+          seqStart += curBuffer;
+          seqSize -= curBuffer;
+          bufferHalf = (bufferHalf + 1) % 2;
+        }
+        found = seqHits.find(stored);
+      }
+      
+      for (unsigned int g=0; g < seqGroups->size(); g++) {
+        for (unsigned int p=0; p < batch.size(); p++) {
+          counts[p][(*seqGroups)[g]] += found->second[p];
+        }
+      }
+    }
+  }
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 // searchCache                                                               //
 //  inputs: primer search pointer, number allowed mm, max number of hits     //
@@ -824,9 +1049,12 @@ bool searchCache(PrimerSearch *ps, int kmm, int maxHits) {
     
     // reset search and screen cache
     ps->reset(tc.getSeqName());
+    ps->setAmbiguities(tc.getAmbiguities());
+    ps->setMask(tc.getMask());
     
     bool searchResult = ps->findPattern(tc.getBuffer(), 0, tc.getBufferSize(),
                                         tc.getStart(), maxHits);
+    runStats.countCacheSlot(ps->getMatchCount() > curMatchCount);
     if (fullOutput && ps->getMatchCount() > curMatchCount) {
       displayHits(ps,curMatchCount,tc.getSeqName(),tc.getBuffer(), tc.getStart(), 0, tc.getBufferSize(), 0);
     }
@@ -839,6 +1067,173 @@ bool searchCache(PrimerSearch *ps, int kmm, int maxHits) {
   return false;
 }   
 
+///////////////////////////////////////////////////////////////////////////////
+// searchSentinel                                                            //
+//  inputs: primer search pointer, number allowed mm, max number of hits,    //
+//          sentinel db files                                                //
+//  output: true if primers found and exceed max hits, false otherwise       //
+//    desc: screens a pair against the repeat library.  Sentinel hits are    //
+//          never cached since they are not sites in the searched dbs.       //
+///////////////////////////////////////////////////////////////////////////////
+
+bool searchSentinel(PrimerSearch *ps, int kmm, int maxHits, std::vector<std::string> &sentinelFiles) {
+
+  ++sentinelPairs;
+  for (unsigned int i=0; i < sentinelFiles.size(); i++) {
+    if (searchFile(sentinelFiles[i], kmm, maxHits, ps, false)) {
+      ++sentinelKilled;
+      return true;
+    }
+  }
+  
+  return false;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// reportTiers                                                               //
+//  inputs: primer pair <PrimerPair*>, primer search <PrimerSearch*>,        //
+//          max mismatch score <int>, max number of hits <int>               //
+//  output: none                                                             //
+//    desc: writes the --tiers line of a pair: the hits a search at each k   //
+//          up to the search k would find (">M" once over -M), the score of  //
+//          the best hit and the margin to the next best one (">n" when no   //
+//          other hit is within k)                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+void reportTiers(PrimerPair *pp, PrimerSearch *ps, int kmm, int maxHits) {
+  int best = -1;
+  int second = -1;
+  std::cout << pp->getId();
+  for (int k=0; k <= kmm; ++k) {
+    int count = ps->getTierCount(k);
+    if (count > maxHits) {
+      std::cout << "\t>" << maxHits;
+    }
+    else {
+      std::cout << "\t" << count;
+    }
+    if (count >= 1 && best < 0) {
+      best = k;
+    }
+    if (count >= 2 && second < 0) {
+      second = k;
+    }
+  }
+  
+  if (best < 0) {
+    std::cout << "\tNA\tNA\n";
+  }
+  else if (second < 0) {
+    std::cout << "\t" << best << "\t>" << kmm - best << "\n";
+  }
+  else {
+    std::cout << "\t" << best << "\t" << second - best << "\n";
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// reportSentinel                                                            //
+//  inputs: none                                                             //
+//  output: none                                                             //
+//    desc: tells the user how many pairs the sentinel db rejected           //
+///////////////////////////////////////////////////////////////////////////////
+
+void reportSentinel() {
+  std::cerr << "Sentinel db rejected " << sentinelKilled << " of " << sentinelPairs << " primer pairs screened.\n";
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// reportStats                                                               //
+//  inputs: none                                                             //
+//  output: none                                                             //
+//    desc: writes the --stats report, run at exit so early exits count too  //
+///////////////////////////////////////////////////////////////////////////////
+
+void reportStats() {
+  runStats.report(statsJson);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// reportPerf                                                                //
+//  inputs: none                                                             //
+//  output: none                                                             //
+//    desc: writes the --perf hardware counter report at exit                //
+///////////////////////////////////////////////////////////////////////////////
+
+void reportPerf() {
+  PerfCounters::active->report();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// writeProfile                                                              //
+//  inputs: primer pair <PrimerPair*>, finished search <PrimerSearch*>,      //
+//          how the search ended <const char*>, pattern build and scan wall  //
+//          times in seconds <double>                                        //
+//  output: none                                                             //
+//    desc: appends the cost of one primer pair to the --profile file.  The  //
+//          file is flushed per pair, so if a pair overflows MATCH_BUFFER    //
+//          the last line shows the pair before it.                          //
+///////////////////////////////////////////////////////////////////////////////
+
+void writeProfile(PrimerPair *pp, PrimerSearch *ps, const char *ending, double patternSeconds, double scanSeconds) {
+  SearchStats &stats = ps->getStats();
+  unsigned long long bytesScanned = 0;
+  for (int k=0; k < NKERNELS; ++k) {
+    bytesScanned += stats.bytesScanned[k];
+  }
+  
+  profileFile << pp->getId() << "\t" << pp->getForPrimer() << "\t" << pp->getRevPrimer() << "\t" << ending << "\t"
+              << patternSeconds << "\t" << scanSeconds << "\t" << bytesScanned*4 << "\t"
+              << stats.forCandidates << "\t" << stats.revMatches << "\t" << stats.peakMatchDepth << "\t"
+              << stats.sitesAdded << "\t" << stats.sitesDuplicate << "\t" << stats.siteSeconds << "\t"
+              << ps->getMatchCount() << std::endl;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// makeMemoKey                                                               //
+//  inputs: primer pair, number allowed mm, amplicon size factors and       //
+//          limits, min and max number of hits, noRevC and noSelfSelf flags, //
+//          weight matrix hash, db manifest hash, --ambig and --mask rules   //
+//  output: result memo key <std::string>                                    //
+//    desc: everything that can change a filter mode verdict.  The key is    //
+//          built from the inputs alone so no PrimerSearch has to be set up  //
+//          for a pair that is already known.                                //
+///////////////////////////////////////////////////////////////////////////////
+
+std::string makeMemoKey(PrimerPair *pp, int kmm, double minFactor, double maxFactor, int minAmpSize, int maxAmpSize,
+                        int minHits, int maxHits, bool noRevC, bool noSelfSelf,
+                        unsigned long long weightsHash, unsigned long long manifestHash, const std::string &ambig,
+                        const std::string &mask) {
+  std::ostringstream key;
+  key << pp->getForPrimer() << " " << pp->getRevPrimer() << " " << kmm << " " << pp->getAmpSize() << " "
+      << minFactor << " " << maxFactor << " " << minAmpSize << " " << maxAmpSize << " "
+      << minHits << " " << maxHits << " " << noRevC << " " << noSelfSelf << " "
+      << std::hex << weightsHash << " " << manifestHash << " " << ambig << " " << mask;
+  return key.str();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// isRepetitive                                                              //
+//  inputs: mappability tracks, primer, mismatches, max hits                 //
+//  output: bool                                                             //
+//    desc: true if a track for this primer length (and at most kmm          //
+//          mismatches) counts more than maxHits sites for the primer.  A    //
+//          primer that binds that often is assumed to give too many         //
+//          amplicons once paired.                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+bool isRepetitive(std::vector<MappabilityTrack*> &tracks, std::string primer, int kmm, int maxHits) {
+  MappabilityTrack* best = NULL;
+  for (unsigned int t=0; t < tracks.size(); ++t) {
+    if (tracks[t]->getOligoLength() == (int)primer.length() && tracks[t]->getMaxMismatches() <= kmm &&
+        (best == NULL || tracks[t]->getMaxMismatches() > best->getMaxMismatches())) {
+      best = tracks[t];
+    }
+  }
+  
+  return (best != NULL && best->lookup(primer) > maxHits);
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 // usage                                                                     //
 //  inputs: none                                                             //
@@ -867,6 +1262,24 @@ void usage() {
   std::cerr << " L\tmax returned\tReturn all passing primers in list (in short output mode) up to <max>.\n";
   std::cerr << " w\tfilename\tWeight matrix file name.\n";  
   std::cerr << " S\tnone\tDo not check for F-F and R-R amplicons.\n";
+  std::cerr << " R\tfilename\tResult memo file.  Verdicts are saved and reused for repeated pairs (filter mode only).\n";
+  std::cerr << " O\tnone\tSearch db files and seqs that hit recently first (filter mode only).\n";
+  std::cerr << " T\tfilenames\tMappability tracks (from pgrep-map) used to reject repetitive primers.\n";
+  std::cerr << " s\tfilenames\tSentinel pgrep db (e.g. repeat consensus seqs) screened before the main dbs.\n";
+  std::cerr << " K\tmismatch cnt\tMaximum number mismatches for sentinel hits (default -k value).\n";
+  std::cerr << " N\thit cnt\tMaximum number of sentinel hits before a pair is rejected (default -M value).\n";
+  std::cerr << " Q\tfilename\t3' q-mer table (from pgrep-map).  Pairs with common 3' ends are searched last.\n";
+  std::cerr << " -stats[=json]\tnone\tReport run counters, phase times and kernel throughput on STDERR.\n";
+  std::cerr << " -profile\tfilename\tWrite the search cost of each primer pair to a tab-delimited file.\n";
+  std::cerr << " -perf\tnone\tReport hardware counters (IPC, branch and cache misses) per search kernel (Linux).\n";
+  std::cerr << " -best\tnone\tWith -o, output the -M lowest scoring hits of each pair from the whole db, best first.\n";
+  std::cerr << " -tiers\tnone\tSearch once at -k and report each pair's hits at every k up to it, best score and margin.\n";
+  std::cerr << " -format=bin\tnone\tWith -o, write binary hit records and a region index instead (read with pgrep-view).\n";
+  std::cerr << " -ambig=RULE\tdrop|keep|off\tSites with a primer over N or other ambiguous db bases (default drop).\n";
+  std::cerr << " -regions\tfilename\tReport only amplicons overlapping these BED intervals (scans them padded by the max amplicon size).\n";
+  std::cerr << " -seqs\tfilename\tSearch only the sequences named in this file, one per line.\n";
+  std::cerr << " -groups\tfilename\tReport how many seqs of each group (seq name, group per line) every pair amplifies.\n";
+  std::cerr << " -mask=RULE\tskip|off|penalty\tSkip the masked runs of pgrep dbs, or add a penalty for primers over them (default off).\n";
   exit(1);
   
 }  
@@ -898,6 +1311,11 @@ int main(int argc, char *argv[]) {
   
   bool noRevC = false;
   bool noSelfSelf = false;
+  bool adaptiveOrder = false;
+  RegionList *regionList = NULL;
+  GroupTable *groupTable = NULL;
+  std::vector<std::string> regionFiles;
+  std::string memoFile;
   int dbIndex = 0;
   int blastIndex = 0;
   double minFactor = 2.0;
@@ -906,6 +1324,15 @@ int main(int argc, char *argv[]) {
   int maxAmpSize = -1;
   fullOutput = 0;
   std::string chrom;
+  std::vector<std::string> trackFiles;
+  std::string qmerFile;
+  std::vector<std::string> sentinelFiles;
+  int sentinelKmm = -1;
+  int sentinelMaxHits = -1;
+  bool bestHits = false;
+  bool binaryOutput = false;
+  bool tierReport = false;
+  int tierLimit = 0;
   
   // parse the command line options
   std::vector<std::string> args(argv, argv + argc);
@@ -1070,6 +1497,19 @@ int main(int argc, char *argv[]) {
       case 'S' :
         noSelfSelf = true;
         break;
+      case 'O' :
+        adaptiveOrder = true;
+        break;
+      case 'R' : 
+        if (ai < argc && args[ai][0] != '-') {
+          memoFile = args[ai];
+          ++ai;
+        }
+        else {
+          std::cerr << "ERROR:  Expecting result memo file name after -R option.\n";
+          usage();
+        }
+        break;
       case 'c' : 
         if (ai < argc && args[ai][0] != '-') {
           chrom = args[ai];
@@ -1080,9 +1520,157 @@ int main(int argc, char *argv[]) {
           usage();
         }
         break;
+      case 'T' : 
+        while (ai < argc && args[ai][0] != '-') {
+          trackFiles.push_back(args[ai]);
+          ++ai;
+        }
+        if (trackFiles.size() == 0) {
+          std::cerr << "ERROR:  Expecting mappability track file names after -T option.\n";
+          usage();
+        }
+        break;
+      case 's' : 
+        while (ai < argc && args[ai][0] != '-') {
+          sentinelFiles.push_back(args[ai]);
+          ++ai;
+        }
+        if (sentinelFiles.size() == 0) {
+          std::cerr << "ERROR:  Expecting sentinel database file names after -s option.\n";
+          usage();
+        }
+        break;
+      case 'K' : 
+        if (ai < argc && args[ai][0] != '-') {
+          sentinelKmm = atoi(args[ai].c_str());
+          ++ai;
+        }
+        else {
+          std::cerr << "ERROR:  Expecting number allowed sentinel mismatches after -K option.\n";
+          usage();
+        }
+        break;
+      case 'N' : 
+        if (ai < argc && args[ai][0] != '-') {
+          sentinelMaxHits = atoi(args[ai].c_str());
+          if (sentinelMaxHits > MAX_MATCHES) {
+            std::cerr << "ERROR:  Max number of matches that PGREP can return is set at [" << MAX_MATCHES << "].\n";
+            exit(1);
+          }
+          ++ai;
+        }
+        else {
+          std::cerr << "ERROR:  Expecting number allowed sentinel matches after -N option.\n";
+          usage();
+        }
+        break;
+      case 'Q' : 
+        if (ai < argc && args[ai][0] != '-') {
+          qmerFile = args[ai];
+          ++ai;
+        }
+        else {
+          std::cerr << "ERROR:  Expecting q-mer table file name after -Q option.\n";
+          usage();
+        }
+        break;
       case 'h' :
         usage();
         break;  
+      case '-' :
+        // long options
+        if (args[ai-1] == "--stats" || args[ai-1] == "--stats=json") {
+          RunStats::enabled = true;
+          statsReport = true;
+          statsJson = (args[ai-1] == "--stats=json");
+        }
+        else if (args[ai-1] == "--perf") {
+          // without counter access the search still runs, just unmeasured
+          std::string reason;
+          PerfCounters *perf = new PerfCounters();
+          if (perf->open(reason)) {
+            PerfCounters::active = perf;
+            RunStats::enabled = true;
+            atexit(reportPerf);
+          }
+          else {
+            std::cerr << "WARNING:  Hardware counters unavailable (" << reason << ").  Ignoring --perf.\n";
+            delete perf;
+          }
+        }
+        else if (args[ai-1] == "--best") {
+          bestHits = true;
+        }
+        else if (args[ai-1] == "--tiers") {
+          tierReport = true;
+        }
+        else if (args[ai-1] == "--format=bin" || args[ai-1] == "--format=tsv") {
+          binaryOutput = (args[ai-1] == "--format=bin");
+        }
+        else if (args[ai-1] == "--ambig=drop" || args[ai-1] == "--ambig=keep" || args[ai-1] == "--ambig=off") {
+          ambigRule = args[ai-1].substr(8);
+        }
+        else if (args[ai-1].substr(0, 7) == "--mask=") {
+          maskRule = args[ai-1].substr(7);
+          if (maskRule != "skip" && maskRule != "off" &&
+              (maskRule.find_first_not_of("0123456789") != std::string::npos || atoi(maskRule.c_str()) <= 0)) {
+            std::cerr << "ERROR:  Expecting skip, off or a mismatch penalty after --mask.\n";
+            exit(1);
+          }
+        }
+        else if (args[ai-1] == "--regions" || args[ai-1] == "--seqs") {
+          if (ai < argc && args[ai][0] != '-') {
+            if (regionList == NULL) {
+              regionList = new RegionList();
+            }
+            if (args[ai-1] == "--regions") {
+              regionList->loadBed(args[ai]);
+            }
+            else {
+              regionList->loadSeqList(args[ai]);
+            }
+            regionFiles.push_back(args[ai]);
+            ++ai;
+          }
+          else {
+            std::cerr << "ERROR:  Expecting file name after " << args[ai-1] << " option.\n";
+            usage();
+          }
+        }
+        else if (args[ai-1] == "--groups") {
+          if (ai < argc && args[ai][0] != '-') {
+            groupTable = new GroupTable();
+            groupTable->load(args[ai]);
+            ++ai;
+          }
+          else {
+            std::cerr << "ERROR:  Expecting sequence group file name after --groups option.\n";
+            usage();
+          }
+        }
+        else if (args[ai-1] == "--profile") {
+          if (ai < argc && args[ai][0] != '-') {
+            profileFile.open(args[ai].c_str());
+            if (!profileFile) {
+              std::cerr << "ERROR:  Could not open profile file [" << args[ai] << "].\n";
+              exit(1);
+            }
+            profileFile << "PrimerPairId\tForwardPrimer\tReversePrimer\tEnd\tPatternSeconds\tScanSeconds\t"
+                        << "BasesScanned\tForwardCandidates\tReverseChecks\tPeakMatchDepth\t"
+                        << "PrimingSites\tDuplicateSites\tPrimingSiteSeconds\tMatches" << std::endl;
+            RunStats::enabled = true;
+            ++ai;
+          }
+          else {
+            std::cerr << "ERROR:  Expecting profile file name after --profile option.\n";
+            usage();
+          }
+        }
+        else {
+          std::cerr << "ERROR:  Unknown option [" << args[ai-1] << "].\n";
+          usage();
+        }
+        break;
       default :
         std::cerr << "ERROR:  Unknown option [-" << option << "].\n";
         usage();
@@ -1103,6 +1691,33 @@ int main(int argc, char *argv[]) {
   	exit(1);
   }
   
+  // --tiers reports every pair, so nothing that rejects or defers pairs
+  // before the search is used.  The tier counts end the search instead of -M.
+  if (tierReport) {
+    if (fullOutput) {
+      std::cerr << "ERROR:  --tiers is a filter mode option (not -o).\n";
+      exit(1);
+    }
+    trackFiles.clear();
+    qmerFile = "";
+    sentinelFiles.clear();
+    memoFile = "";
+    tierLimit = maxHits;
+    maxHits = INT_MAX;
+  }
+  
+  // --groups reports every pair too, from its own search
+  if (groupTable != NULL) {
+    if (fullOutput || tierReport || regionList != NULL) {
+      std::cerr << "ERROR:  --groups is a filter mode option (not -o, --tiers, --regions or --seqs).\n";
+      exit(1);
+    }
+    trackFiles.clear();
+    qmerFile = "";
+    sentinelFiles.clear();
+    memoFile = "";
+  }
+  
   // rearrange files to place the chrom file first
   if (chrom.length() > 0) {
     if (dbIndex > 0) {
@@ -1130,6 +1745,30 @@ int main(int argc, char *argv[]) {
   	loadAllBlastInfo(blastFiles, blastDbSeqs, blastIndex);
   }
   
+  // adaptive ordering would reorder full output, so it is for filtering only
+  SearchOrder* dbOrder = NULL;
+  SearchOrder* blastOrder = NULL;
+  if (adaptiveOrder && !fullOutput) {
+    if (dbIndex > 0) {
+      dbOrder = new SearchOrder(dbFiles, dbIndex, false);
+    }
+    if (blastIndex > 0) {
+      blastOrder = new SearchOrder(blastFiles, blastIndex, true);
+    }
+  }
+  
+  // region and group searches read each db by seq, so need random access
+  // to all of them
+  std::vector<SequenceDb*> seqDbs;
+  if (regionList != NULL || groupTable != NULL) {
+    for (int i=0; i < dbIndex; ++i) {
+      seqDbs.push_back(new SequenceDb(dbFiles[i], false));
+    }
+    for (int i=0; i < blastIndex; ++i) {
+      seqDbs.push_back(new SequenceDb(blastFiles[i], true));
+    }
+  }
+  
   WeightMatrix* wm = new WeightMatrix();
   
   if (weightsFile.length() != 0) {
@@ -1137,6 +1776,89 @@ int main(int argc, char *argv[]) {
     wm->loadWeightsFile(weightsFile);
   }
   
+  // mappability tracks only decide pass/fail, so they are ignored when 
+  // hits must be reported or when weights make mismatches unequal
+  std::vector<MappabilityTrack*> tracks;
+  if (trackFiles.size() > 0 && !fullOutput && weightsFile.length() == 0) {
+    for (unsigned int t=0; t < trackFiles.size(); ++t) {
+      MappabilityTrack* track = new MappabilityTrack();
+      track->load(trackFiles[t]);
+      tracks.push_back(track);
+    }
+  }
+  
+  // the q-mer table only changes the order pairs are tried in filter mode
+  QmerTable* qmers = NULL;
+  int anchorLimit = 0;
+  if (qmerFile.length() > 0 && !fullOutput) {
+    qmers = new QmerTable();
+    qmers->load(qmerFile);
+    anchorLimit = (int)qmers->getBackground() + QMER_EXCESS*maxHits;
+    if (anchorLimit > QmerTable::QMER_CAP) {
+      anchorLimit = QmerTable::QMER_CAP;
+    }
+  }
+  
+  // --best offers every hit to a list of the -M best, so the search itself
+  // is only limited by the hits one buffer can hold
+  if (bestHits) {
+    if (!fullOutput) {
+      std::cerr << "ERROR:  --best needs full output (-o).\n";
+      exit(1);
+    }
+    topHits = new TopHits(maxHits);
+    maxHits = MAX_MATCHES - 16; // leaves room for the sites of the last hit
+  }
+  if (binaryOutput) {
+    if (!fullOutput) {
+      std::cerr << "ERROR:  --format=bin needs full output (-o).\n";
+      exit(1);
+    }
+    hitFile = new HitFile();
+    hitFile->create(&std::cout, noRevC, ambigRule != "off");
+  }
+  
+  // the sentinel only decides pass/fail, so it is skipped in full output mode
+  if (fullOutput) {
+    sentinelFiles.clear();
+  }
+  if (sentinelFiles.size() > 0) {
+    if (sentinelKmm < 0) {
+      sentinelKmm = kmm;
+    }
+    if (sentinelMaxHits < 0) {
+      sentinelMaxHits = maxHits;
+    }
+    atexit(reportSentinel);
+  }
+  if (statsReport) {
+    atexit(reportStats);
+  }
+  
+  // the memo keeps verdicts only, so it is of no use in full output mode
+  ResultMemo* memo = NULL;
+  unsigned long long weightsHash = 0;
+  unsigned long long manifestHash = 0;
+  if (memoFile.length() > 0 && !fullOutput) {
+    memo = new ResultMemo(memoFile);
+    if (weightsFile.length() > 0) {
+      weightsHash = ResultMemo::hashFile(weightsFile);
+    }
+    std::vector<std::string> manifest(dbFiles.begin(), dbFiles.begin() + dbIndex);
+    for (int i=0; i < dbIndex; ++i) {
+      manifest.push_back(dbFiles[i] + ".amb");
+      manifest.push_back(dbFiles[i] + ".msk");
+      manifest.push_back(dbFiles[i] + ".dup");
+    }
+    for (int i=0; i < blastIndex; ++i) {
+      manifest.push_back(blastFiles[i] + ".nin");
+      manifest.push_back(blastFiles[i] + ".nhr");
+      manifest.push_back(blastFiles[i] + ".nsq");
+    }
+    manifest.insert(manifest.end(), regionFiles.begin(), regionFiles.end());
+    manifestHash = ResultMemo::hashManifest(manifest);
+  }
+  
   PrimerPair* ppSet[MAX_PRIMER_PAIRS];
   int npps = 0;
   bool primersFromStdin = false;
@@ -1173,46 +1895,217 @@ int main(int argc, char *argv[]) {
   }
        
   // display a header if using full output mode
-  if (fullOutput) {
-  	std::cout << "PrimerPairId\tTemplateSequenceName\tMatchStart\tMatchStop\tMatchStrand\tMatchLength\t";
-  	std::cout << "ForwardPrimer\tForwardPrimerAlignment\tForwardTemplateSeq\tForwardMismatchScore\t";      
-  	std::cout << "ReversePrimer\tReversePrimerAlignment\tReverseTemplateSeq\tReverseMismatchScore\t";      
-  	std::cout << "FullMatchSequence\n";
+  if (fullOutput && hitFile == NULL) {
+  	displayHeader(std::cout);
+  }
+  if (tierReport) {
+    std::cout << "PrimerPairId";
+    for (int k=0; k <= kmm; ++k) {
+      std::cout << "\tHits_k" << k;
+    }
+    std::cout << "\tBestScore\tMargin\n";
   }      
+  
+  // --groups - the number of seqs of each group each pair amplifies, from
+  // one pass over the dbs for every GROUP_BATCH pairs
+  if (groupTable != NULL) {
+    std::cout << "PrimerPairId";
+    for (int g=0; g < groupTable->getGroupCount(); ++g) {
+      std::cout << "\t" << groupTable->getGroupName(g);
+    }
+    std::cout << "\n";
+    
+    std::vector<PrimerPair*> pairs;
+    for (int i=0; i < npps; i++) {
+      PrimerPair* pp = (primersFromStdin) ? readPrimersFromStdin(preamble, bldrText, noRevC) : ppSet[i];
+      if (pp == NULL) {
+        break;
+      }
+      pairs.push_back(pp);
+    }
+    
+    for (unsigned int b=0; b < pairs.size(); b += GROUP_BATCH) {
+      runStats.enterPhase(PHASE_PATTERNS);
+      std::vector<PrimerSearch*> batch;
+      for (unsigned int p=b; p < pairs.size() && p < b + GROUP_BATCH; p++) {
+        PrimerSearch *ps = new PrimerSearch(pairs[p], wm, noRevC, noSelfSelf, minFactor, maxFactor, minAmpSize, maxAmpSize, kmm);
+        ps->setCountOnly(true);
+        ps->setKeepAmbiguous(ambigRule == "keep");
+        ps->setMaskRule(maskRule == "skip", atoi(maskRule.c_str()));
+        batch.push_back(ps);
+        runStats.countPair();
+      }
+      
+      runStats.enterPhase(PHASE_SCAN);
+      std::vector<std::vector<int> > counts(batch.size(), std::vector<int>(groupTable->getGroupCount(), 0));
+      searchGroups(batch, seqDbs, groupTable, counts);
+      
+      runStats.enterPhase(PHASE_OUTPUT);
+      for (unsigned int p=0; p < batch.size(); p++) {
+        std::cout << batch[p]->getPrimerPair()->getId();
+        for (int g=0; g < groupTable->getGroupCount(); ++g) {
+          std::cout << "\t" << counts[p][g];
+        }
+        std::cout << "\n";
+        runStats.addSearch(batch[p]->getStats());
+        delete batch[p];
+      }
+    }
+    return 0;
+  }
     
-  // TIMING - REMOVE
-  clock_t commence,complete;
-  commence=clock();
-
   // loop through primer pairs until we find a working pair or reach
   // the end of the list
   int nReturned = 0;
-  for (int i=0; i < npps; i++) {
+  std::vector<PrimerPair*> deferredPairs;
+  std::vector<std::string> deferredBldr;
+  std::vector<int> deferredIndex;
+  for (int i=0; i < npps + (int)deferredPairs.size(); i++) {
     PrimerPair* pp;
+    int ppIndex = i;
+    runStats.enterPhase(PHASE_LOAD);
     
-    if (primersFromStdin) {
-      bldrText = "";
-      preamble = "";
-      pp = readPrimersFromStdin(preamble, bldrText, noRevC);
-      if (pp == NULL) {
-      	break;
+    if (i >= npps) {
+      // pairs deferred for a common 3' end get their turn last
+      pp = deferredPairs[i - npps];
+      bldrText = deferredBldr[i - npps];
+      ppIndex = deferredIndex[i - npps];
+    }
+    else {
+      if (primersFromStdin) {
+        bldrText = "";
+        preamble = "";
+        pp = readPrimersFromStdin(preamble, bldrText, noRevC);
+        if (pp == NULL) {
+          // end of input, move on to any deferred pairs
+          npps = i;
+          --i;
+          continue;
+        }
+        if (!fullOutput && !tierReport) {
+          std::cout << preamble; // should only print something on first primer pair
+        }
+      }
+      else {
+        pp = ppSet[i];
+      }	
+      
+      // reject pairs with a primer that is already known to be repetitive
+      if (tracks.size() > 0 && (isRepetitive(tracks, pp->getForPrimer(), kmm, maxHits) ||
+                                isRepetitive(tracks, pp->getRevPrimer(), kmm, maxHits))) {
+        continue;
       }
-      if (!fullOutput) {
-        std::cout << preamble; // should only print something on first primer pair
+      
+      // a primer whose 3' end is everywhere will most likely fail, so try 
+      // the others first (with -C the right primer is on the template
+      // strand, so its 3' end is at the start)
+      std::string revPrimer = (noRevC) ? PrimerSearch::reverseComplement(pp->getRevPrimer()) : pp->getRevPrimer();
+      if (qmers != NULL && (qmers->anchorCount(pp->getForPrimer()) >= anchorLimit ||
+                            qmers->anchorCount(revPrimer) >= anchorLimit)) {
+        deferredPairs.push_back(pp);
+        deferredBldr.push_back(bldrText);
+        deferredIndex.push_back(i);
+        continue;
       }
     }
-    else {
-      pp = ppSet[i];
-    }	
-    PrimerSearch ps = PrimerSearch(pp, wm, noRevC, noSelfSelf, minFactor, maxFactor, minAmpSize, maxAmpSize, kmm);
-       
-    // first search cache
-    if (searchCache(&ps, kmm, maxHits)) {
-      continue;
+    
+    // reject pairs that already amplify too often from the repeat library
+    if (sentinelFiles.size() > 0) {
+      runStats.enterPhase(PHASE_PATTERNS);
+      double patternStart = RunStats::wallSeconds();
+      PrimerSearch sps(pp, wm, noRevC, noSelfSelf, minFactor, maxFactor, minAmpSize, maxAmpSize, sentinelKmm);
+      sps.setCountOnly(true);
+      sps.setKeepAmbiguous(ambigRule == "keep"); // repeat libraries are often all masked, so no mask rule
+      runStats.enterPhase(PHASE_SCAN);
+      double scanStart = RunStats::wallSeconds();
+      bool rejected = searchSentinel(&sps, sentinelKmm, sentinelMaxHits, sentinelFiles);
+      runStats.addSearch(sps.getStats());
+      if (rejected) {
+        if (profileFile.is_open()) {
+          writeProfile(pp, &sps, "sentinel", scanStart - patternStart, RunStats::wallSeconds() - scanStart);
+        }
+        continue;
+      }
+    }
+    
+    // reuse the verdict if this pair was screened before with the same
+    // settings against the same dbs
+    std::string memoKey;
+    int verdict = ResultMemo::UNKNOWN;
+    if (memo != NULL) {
+      memoKey = makeMemoKey(pp, kmm, minFactor, maxFactor, minAmpSize, maxAmpSize, minHits, maxHits,
+                            noRevC, noSelfSelf, weightsHash, manifestHash, ambigRule, maskRule);
+      verdict = memo->lookup(memoKey);
     }
     
-    if (dbIndex > 0 && !searchAllDbFiles(&ps, kmm, maxHits, dbFiles, dbIndex) && !fullOutput &&
-        ps.getMatchCount() >= minHits) {
+    bool passed = (verdict == ResultMemo::PASSED);
+    if (verdict == ResultMemo::UNKNOWN) {
+      runStats.enterPhase(PHASE_PATTERNS);
+      double patternStart = RunStats::wallSeconds();
+      PrimerSearch ps(pp, wm, noRevC, noSelfSelf, minFactor, maxFactor, minAmpSize, maxAmpSize, kmm);
+      ps.setCountOnly(!fullOutput);
+      ps.setKeepAmbiguous(ambigRule == "keep");
+      ps.setMaskRule(maskRule == "skip", atoi(maskRule.c_str()));
+      if (tierReport) {
+        ps.setTierLimit(tierLimit);
+      }
+      if (hitFile != NULL) {
+        hitFile->beginPair(pp);
+      }
+      runStats.enterPhase(PHASE_SCAN);
+      runStats.countPair();
+      double scanStart = RunStats::wallSeconds();
+      const char *ending = "cache";
+      
+      // first search cache (not with --best, which releases hits as it goes
+      // and so could not spot the same hits again in the full search, nor
+      // with --tiers, which never rejects a pair)
+      if (topHits != NULL || tierReport || !searchCache(&ps, kmm, maxHits)) {
+        ending = NULL;
+        if (regionList != NULL) {
+          passed = (!searchRegions(&ps, kmm, maxHits, seqDbs, regionList) && !fullOutput &&
+                    ps.getMatchCount() >= minHits);
+        }
+        else if (dbIndex > 0 && !((dbOrder != NULL) ? searchInOrder(&ps, kmm, maxHits, dbOrder) :
+                                                 searchAllDbFiles(&ps, kmm, maxHits, dbFiles, dbIndex)) && !fullOutput &&
+            ps.getMatchCount() >= minHits) {
+          passed = true;
+        } 
+        else if (blastIndex > 0 && !((blastOrder != NULL) ? searchInOrder(&ps, kmm, maxHits, blastOrder) :
+                                                            searchAllBlastFiles(&ps, kmm, maxHits, blastFiles, blastIndex, blastDbSeqs)) && !fullOutput &&
+                 ps.getMatchCount() >= minHits) {
+          passed = true;
+        }
+      }
+      else {
+        runStats.countCacheReject();
+      }
+      runStats.addSearch(ps.getStats());
+      if (profileFile.is_open()) {
+        if (ending == NULL) {
+          ending = (ps.getMatchCount() > maxHits) ? "maxhits" : "full";
+        }
+        writeProfile(pp, &ps, ending, scanStart - patternStart, RunStats::wallSeconds() - scanStart);
+      }
+      runStats.enterPhase(PHASE_OUTPUT);
+      if (topHits != NULL && hitFile != NULL) {
+        std::ostringstream best;
+        topHits->write(best);
+        hitFile->addRecords(best.str());
+      }
+      else if (topHits != NULL) {
+        topHits->write(std::cout);
+      }
+      if (tierReport) {
+        reportTiers(pp, &ps, kmm, tierLimit);
+        continue;
+      }
+      if (memo != NULL) {
+        memo->record(memoKey, passed);
+      }
+    }
+    
+    if (passed) {
       // passed primer pair!
       ++nReturned;
       if (primersFromStdin) {
@@ -1223,30 +2116,11 @@ int main(int argc, char *argv[]) {
       	 }
       }
       else {
-        std::cout << "Primer pair: " << i << " is OK.  Name: [" << ppSet[i]->getId() << "].\n";
+        std::cout << "Primer pair: " << ppIndex << " is OK.  Name: [" << pp->getId() << "].\n";
       }
       if (maxReturned <= nReturned) {
         exit(0);
       }
-    } else {
-      if (blastIndex > 0 && !searchAllBlastFiles(&ps, kmm, maxHits, blastFiles, blastIndex, blastDbSeqs) && !fullOutput &&
-        ps.getMatchCount() >= minHits) {
-        // passed primer pair!
-        ++nReturned;
-        if (primersFromStdin) {
-      	  std::cout << bldrText;
-      	  if (maxReturned <= nReturned) {
-      	  	std::cout << "=\n"; // make valid bldr
-      	  	exit(0);
-      	  }
-        }
-        else {
-          std::cout << "Primer pair: " << i << " is OK.  Name: [" << ppSet[i]->getId() << "].\n";
-        }
-        if (maxReturned <= nReturned) {
-          exit(0);
-        }
-      }
     }
   }
   //std::cerr << lTime << "\n";
@@ -1257,7 +2131,10 @@ int main(int argc, char *argv[]) {
   }
   	
   
-  if (!fullOutput && nReturned == 0) {
+  if (hitFile != NULL) {
+    hitFile->finish();
+  }
+  if (!fullOutput && !tierReport && nReturned == 0) {
     std::cout << "No good primers found.\n";
   }
 }
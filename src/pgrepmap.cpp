@@ -0,0 +1,181 @@
+
+/////////////////////////////////////////////////////////////////////////////////
+// PGREP-MAP                                                                   //
+//  -Builds genome mappability tracks used by pgrep to reject repetitive       //
+//   primers without a search                                                  //
+//                                                                             //
+// Copyright (C) 2007 Affymetrix, Inc.                                         //
+//                                                                             //
+// This program is free software; you can redistribute it and/or modify        //
+// it under the terms of the GNU General Public License (version 2) as         //
+// published by the Free Software Foundation.                                  //
+//                                                                             //
+// This program is distributed in the hope that it will be useful,             //
+// but WITHOUT ANY WARRANTY; without even the implied warranty of              // 
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU            //
+// General Public License for more details.                                    //
+//                                                                             //
+// You should have received a copy of the GNU General Public License           //
+// along with this program;if not, write to the                                //
+//                                                                             //
+// Free Software Foundation, Inc.,                                             //
+// 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA                       // 
+/////////////////////////////////////////////////////////////////////////////////
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <stdlib.h>
+
+#include "Properties.h"
+#include "SequenceDb.h"
+#include "MappabilityTrack.h"
+#include "QmerTable.h"
+
+///////////////////////////////////////////////////////////////////////////////
+// usage                                                                     //
+//  inputs: none                                                             //
+//  output: none                                                             //
+//    desc: displays usage info                                              //
+/////////////////////////////////////////////////////////////////////////////// 
+
+void usage() {
+  std::cerr << "usage: pgrep-map [options]\n\n"; 
+  std::cerr << "Option\tArgument\tDescription\n";
+  std::cerr << " d\tfilenames\tthe pgrep database files to index OR\n";
+  std::cerr << " b\tblastdb names\tthe blastn database files to index\n";
+  std::cerr << " L\tmin [max]\tOligo length or range of lengths for mappability tracks.\n";
+  std::cerr << " k\tmismatch cnt\tMaximum number mismatches (default 0).\n";
+  std::cerr << " q\tq-mer length\tAlso write a 3' anchor q-mer table, <prefix>.q<q>.pqt\n";
+  std::cerr << " o\tprefix\tOutput prefix (REQUIRED).  Writes <prefix>.L<len>k<k>.pmt\n";
+  exit(1);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// main                                                                      //
+//  inputs: argc, argv                                                       //
+//  output: int                                                              //
+//    desc: builds one track for each requested oligo length                 //
+/////////////////////////////////////////////////////////////////////////////// 
+
+int main(int argc, char *argv[]) {
+
+  if (argc < 2) usage();
+
+  std::vector<SequenceDb*> dbs;
+  std::string prefix;
+  int minLength = -1;
+  int maxLength = -1;
+  int kmm = 0;
+  int qmerLength = -1;
+  
+  std::vector<std::string> args(argv, argv + argc);
+  int ai = 1;
+  
+  while (ai < argc && args[ai][0] == '-') {
+    char option = args[ai++][1]; 
+ 
+    switch (option) {
+      case 'd' : 
+      case 'b' : 
+        while (ai < argc && args[ai][0] != '-') {
+          dbs.push_back(new SequenceDb(args[ai], option == 'b'));
+          ++ai;
+        }
+        break;
+      case 'L' : 
+        if (ai < argc && args[ai][0] != '-') {
+          minLength = atoi(args[ai].c_str());
+          maxLength = minLength;
+          ++ai;
+        }
+        else {
+          std::cerr << "ERROR:  Expecting oligo length after -L option.\n";
+          usage();
+        }
+        if (ai < argc && args[ai][0] != '-') {
+          maxLength = atoi(args[ai].c_str());
+          ++ai;
+        }
+        break;
+      case 'k' : 
+        if (ai < argc && args[ai][0] != '-') {
+          kmm = atoi(args[ai].c_str());
+          ++ai;
+        }
+        else {
+          std::cerr << "ERROR:  Expecting number allowed mismatches after -k option.\n";
+          usage();
+        }
+        break;
+      case 'q' : 
+        if (ai < argc && args[ai][0] != '-') {
+          qmerLength = atoi(args[ai].c_str());
+          ++ai;
+        }
+        else {
+          std::cerr << "ERROR:  Expecting q-mer length after -q option.\n";
+          usage();
+        }
+        break;
+      case 'o' : 
+        if (ai < argc && args[ai][0] != '-') {
+          prefix = args[ai];
+          ++ai;
+        }
+        else {
+          std::cerr << "ERROR:  Expecting output prefix after -o option.\n";
+          usage();
+        }
+        break;
+      case 'h' :
+        usage();
+        break;  
+      default :
+        std::cerr << "ERROR:  Unknown option [-" << option << "].\n";
+        usage();
+    }
+  }
+  
+  if (dbs.size() == 0) {
+    std::cerr << "ERROR:  Must specify a sequence database to index.\n";
+    usage();
+  }
+  if ((minLength < 0 && qmerLength < 0) || prefix.length() == 0) {
+    std::cerr << "ERROR:  Oligo length (or q-mer length) and output prefix are required.\n";
+    usage();
+  }
+  if (kmm < 0 || kmm > MappabilityTrack::MAX_MISMATCHES) {
+    std::cerr << "ERROR:  Number of mismatches must be between 0 and " << MappabilityTrack::MAX_MISMATCHES << ".\n";
+    exit(1);
+  }
+  
+  if (qmerLength >= 0) {
+    std::ostringstream filename;
+    filename << prefix << ".q" << qmerLength << ".pqt";
+    
+    QmerTable table;
+    table.build(dbs, qmerLength);
+    table.write(filename.str());
+    std::cerr << "Wrote " << filename.str() << "\n";
+    if (table.getBackground() > QmerTable::QMER_CAP / 4) {
+      std::cerr << "WARNING: Most " << qmerLength << "-mers are common in this db.  Use a longer q-mer.\n";
+    }
+  }
+  
+  for (int len = minLength; len <= maxLength && minLength >= 0; ++len) {
+    std::ostringstream filename;
+    filename << prefix << ".L" << len << "k" << kmm << ".pmt";
+    
+    MappabilityTrack track(len, kmm);
+    track.build(dbs);
+    track.write(filename.str());
+    std::cerr << "Wrote " << filename.str() << "\n";
+  }
+  
+  for (unsigned int i=0; i < dbs.size(); ++i) {
+    delete dbs[i];
+  }
+  return 0;
+}
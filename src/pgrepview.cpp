@@ -0,0 +1,288 @@
+/////////////////////////////////////////////////////////////////////////////////
+// PGREP-VIEW                                                                  //
+//  -Turns the binary hit files of pgrep --format=bin back into tab-delimited  //
+//   full output, optionally just the hits in some regions or of some pairs    //
+//                                                                             //
+// Copyright (C) 2007 Affymetrix, Inc.                                         //
+//                                                                             //
+// This program is free software; you can redistribute it and/or modify        //
+// it under the terms of the GNU General Public License (version 2) as         //
+// published by the Free Software Foundation.                                  //
+//                                                                             //
+// This program is distributed in the hope that it will be useful,             //
+// but WITHOUT ANY WARRANTY; without even the implied warranty of              // 
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU            //
+// General Public License for more details.                                    //
+//                                                                             //
+// You should have received a copy of the GNU General Public License           //
+// along with this program;if not, write to the                                //
+//                                                                             //
+// Free Software Foundation, Inc.,                                             //
+// 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA                       // 
+/////////////////////////////////////////////////////////////////////////////////
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <map>
+#include <stdlib.h>
+
+#include "Properties.h"
+#include "SequenceDb.h"
+#include "AmbiguityTable.h"
+#include "PrimerSearch.h"
+#include "HitFile.h"
+#include "HitDisplay.h"
+
+// a -r region, in the sequence table of the hit file
+struct Region {
+  unsigned int seq;
+  unsigned int from;
+  unsigned int to;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// usage                                                                     //
+//  inputs: none                                                             //
+//  output: none                                                             //
+//    desc: displays usage info                                              //
+/////////////////////////////////////////////////////////////////////////////// 
+
+void usage() {
+  std::cerr << "usage: pgrep-view [options] <hit file>\n\n"; 
+  std::cerr << "Option\tArgument\tDescription\n";
+  std::cerr << " d\tfilenames\tpgrep database files to fetch template and amplicon sequences from OR\n";
+  std::cerr << " b\tblastdb names\tblastn database files to fetch them from (default leave those columns empty)\n";
+  std::cerr << " r\tregions\tOnly hits overlapping these regions, as seq or seq:from-to.\n";
+  std::cerr << " p\tpair ids\tOnly hits of these primer pairs.\n";
+  std::cerr << " i\tnone\tList the pairs and sequences in the file instead of the hits.\n";
+  exit(1);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// parseRegion                                                               //
+//  inputs: region text <std::string>, hit file <HitFile&>, region <Region&> //
+//  output: false if the sequence has no hits in the file                    //
+//    desc: parses seq or seq:from-to (1-based, inclusive)                   //
+/////////////////////////////////////////////////////////////////////////////// 
+
+bool parseRegion(std::string text, HitFile &hits, Region &region) {
+  std::string name = text;
+  region.from = 0;
+  region.to = ~0U;
+  
+  size_t colon = text.rfind(':');
+  if (colon != std::string::npos) {
+    size_t dash = text.find('-', colon);
+    if (dash == std::string::npos) {
+      std::cerr << "ERROR:  Expecting seq:from-to for region [" << text << "].\n";
+      exit(1);
+    }
+    name = text.substr(0, colon);
+    region.from = strtoul(text.substr(colon+1, dash-colon-1).c_str(), NULL, 10);
+    region.to = strtoul(text.substr(dash+1).c_str(), NULL, 10);
+  }
+  
+  for (int s=0; s < hits.getSeqCount(); ++s) {
+    if (name == hits.getSeqName(s)) {
+      region.seq = s;
+      return true;
+    }
+  }
+  return false;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// fetchAmplicon                                                             //
+//  inputs: dbs <vector SequenceDb*>, their ambiguity tables                //
+//          <vector AmbiguityTable*>, where each seq is <map>, seq name      //
+//          <char*>, hit <HitRecord&>, amplicon <std::string&>               //
+//  output: none                                                             //
+//    desc: reads and decodes the amplicon of a hit from its db, with N over //
+//          the ambiguous bases as pgrep shows them                          //
+/////////////////////////////////////////////////////////////////////////////// 
+
+void fetchAmplicon(std::vector<SequenceDb*> &dbs, std::vector<AmbiguityTable*> &ambTables,
+                   std::map<std::string, std::pair<int,int> > &seqLocs,
+                   char *seqName, HitRecord &hit, std::string &amp) {
+  std::map<std::string, std::pair<int,int> >::iterator it = seqLocs.find(seqName);
+  if (it == seqLocs.end()) {
+    std::cerr << "Error: Sequence " << seqName << " not found in the database files.\n";
+    exit(1);
+  }
+  SequenceDb *db = dbs[it->second.first];
+  
+  unsigned int base = hit.start - 1;
+  unsigned int length = hit.stop - hit.start + 1;
+  unsigned int nbytes = (base%4 + length + 3)/4;
+  std::vector<char> packed(nbytes);
+  db->readSeq(it->second.second, base/4, nbytes, &packed[0]);
+  
+  amp.resize(length);
+  PrimerSearch::decodeBases(&packed[0], nbytes, 0, base%4, length, &amp[0]);
+  
+  AmbiguityTable *ambTable = ambTables[it->second.first];
+  if (ambTable != NULL) {
+    const std::vector<BaseRun> *runs = ambTable->getRuns(db->getStoredSeq(it->second.second));
+    if (runs != NULL) {
+      showAmbiguities(amp, *runs, base);
+    }
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// main                                                                      //
+//  inputs: argc, argv                                                       //
+//  output: int                                                              //
+//    desc: walks the region index, reading only the blocks that can hold    //
+//          wanted hits                                                      //
+/////////////////////////////////////////////////////////////////////////////// 
+
+int main(int argc, char *argv[]) {
+
+  if (argc < 2) usage();
+
+  std::vector<SequenceDb*> dbs;
+  std::vector<std::string> regionTexts;
+  std::vector<std::string> pairIds;
+  bool listTables = false;
+  
+  std::vector<std::string> args(argv, argv + argc);
+  int ai = 1;
+  
+  while (ai < argc && args[ai][0] == '-') {
+    char option = args[ai++][1]; 
+ 
+    switch (option) {
+      case 'd' : 
+      case 'b' : 
+        while (ai < argc - 1 && args[ai][0] != '-') {
+          dbs.push_back(new SequenceDb(args[ai], option == 'b'));
+          ++ai;
+        }
+        break;
+      case 'r' : 
+        while (ai < argc - 1 && args[ai][0] != '-') {
+          regionTexts.push_back(args[ai]);
+          ++ai;
+        }
+        break;
+      case 'p' : 
+        while (ai < argc - 1 && args[ai][0] != '-') {
+          pairIds.push_back(args[ai]);
+          ++ai;
+        }
+        break;
+      case 'i' :
+        listTables = true;
+        break;
+      case 'h' :
+        usage();
+        break;  
+      default :
+        std::cerr << "ERROR:  Unknown option [-" << option << "].\n";
+        usage();
+    }
+  }
+  
+  if (ai != argc - 1) {
+    std::cerr << "ERROR:  Expecting one hit file.\n";
+    usage();
+  }
+  
+  HitFile hits;
+  hits.load(args[ai]);
+  
+  if (listTables) {
+    std::cout << "Records\t" << hits.getRecordCount() << "\tIndexBlocks\t" << hits.getBlockCount() << "\n";
+    for (int p=0; p < hits.getPairCount(); ++p) {
+      PrimerPair *pp = hits.getPrimerPair(p);
+      std::cout << "Pair\t" << pp->getId() << "\t" << pp->getForPrimer() << "\t" << pp->getRevPrimer() << "\n";
+    }
+    for (int s=0; s < hits.getSeqCount(); ++s) {
+      std::cout << "Seq\t" << hits.getSeqName(s) << "\n";
+    }
+    return 0;
+  }
+  
+  std::vector<Region> regions;
+  for (unsigned int r=0; r < regionTexts.size(); ++r) {
+    Region region;
+    if (parseRegion(regionTexts[r], hits, region)) {
+      regions.push_back(region);
+    }
+  }
+  bool anyRegion = (regionTexts.size() == 0);
+  
+  std::vector<bool> pairWanted(hits.getPairCount(), pairIds.size() == 0);
+  for (int p=0; p < hits.getPairCount(); ++p) {
+    for (unsigned int i=0; i < pairIds.size(); ++i) {
+      if (hits.getPrimerPair(p)->getId() == pairIds[i]) {
+        pairWanted[p] = true;
+      }
+    }
+  }
+  
+  // where to find each sequence when amplicons are wanted, and the
+  // ambiguous bases to show as N if pgrep showed them
+  std::map<std::string, std::pair<int,int> > seqLocs;
+  std::vector<AmbiguityTable*> ambTables(dbs.size(), (AmbiguityTable*) NULL);
+  for (unsigned int d=0; d < dbs.size(); ++d) {
+    for (int s=0; s < dbs[d]->getSeqCount(); ++s) {
+      seqLocs[dbs[d]->getSeqName(s)] = std::make_pair(d, s);
+    }
+    if (hits.getShowsAmbiguities()) {
+      ambTables[d] = new AmbiguityTable();
+      if (!ambTables[d]->load(dbs[d]->getFilename(), dbs[d]->isBlastDb())) {
+        delete ambTables[d];
+        ambTables[d] = NULL;
+      }
+    }
+  }
+  
+  displayHeader(std::cout);
+  std::vector<HitRecord> block;
+  std::string amp;
+  for (int b=0; b < hits.getBlockCount(); ++b) {
+    HitBlock &entry = hits.getBlock(b);
+    if (!pairWanted[entry.pair]) {
+      continue;
+    }
+    bool inRegion = anyRegion;
+    for (unsigned int r=0; r < regions.size() && !inRegion; ++r) {
+      inRegion = (entry.seq == regions[r].seq && entry.minStart <= regions[r].to && entry.maxStop >= regions[r].from);
+    }
+    if (!inRegion) {
+      continue;
+    }
+    
+    hits.readBlock(b, block);
+    PrimerPair *pp = hits.getPrimerPair(entry.pair);
+    char *seqName = hits.getSeqName(entry.seq);
+    for (unsigned int i=0; i < block.size(); ++i) {
+      HitRecord &hit = block[i];
+      inRegion = anyRegion;
+      for (unsigned int r=0; r < regions.size() && !inRegion; ++r) {
+        inRegion = (hit.seq == regions[r].seq && hit.start <= regions[r].to && hit.stop >= regions[r].from);
+      }
+      if (!inRegion) {
+        continue;
+      }
+      
+      amp.clear();
+      if (dbs.size() > 0) {
+        fetchAmplicon(dbs, ambTables, seqLocs, seqName, hit, amp);
+      }
+      PrimingSite site(seqName, hit.start, hit.stop, (PrimerDirection) hit.forDir, (PrimerDirection) hit.revDir,
+                       hit.strand, hit.forScore, hit.revScore);
+      displayHit(std::cout, pp, &site, amp, hits.getNoRevC());
+    }
+  }
+  flushHits(std::cout);
+  
+  for (unsigned int i=0; i < dbs.size(); ++i) {
+    delete dbs[i];
+    delete ambTables[i];
+  }
+  return 0;
+}
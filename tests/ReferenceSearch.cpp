@@ -0,0 +1,206 @@
+#include <string.h>
+#include <algorithm>
+#include "ReferenceSearch.h"
+#include "PrimerSearch.h"
+
+/////////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2007 Affymetrix, Inc.                                         //
+//                                                                             //
+// This program is free software; you can redistribute it and/or modify        //
+// it under the terms of the GNU General Public License (version 2) as         //
+// published by the Free Software Foundation.                                  //
+//                                                                             //
+// This program is distributed in the hope that it will be useful,             //
+// but WITHOUT ANY WARRANTY; without even the implied warranty of              // 
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU            //
+// General Public License for more details.                                    //
+//                                                                             //
+// You should have received a copy of the GNU General Public License           //
+// along with this program;if not, write to the                                //
+//                                                                             //
+// Free Software Foundation, Inc.,                                             //
+// 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA                       // 
+/////////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+// constructor                                                               //
+//  inputs: same as PrimerSearch, with the amplicon limits given directly    //
+//    desc: lays out every way the primers can bind as plus-strand probes.   //
+//          A primer priming at the amplicon's 5' end reads as the plus      //
+//          strand does; one priming at the 3' end reads as its reverse      //
+//          complement and is weighted on the complemented bases, counting   //
+//          positions from the right.  With noRevC the reverse primer is     //
+//          given already reverse complemented, so its probes swap patterns. //
+///////////////////////////////////////////////////////////////////////////////  
+
+ReferenceSearch::ReferenceSearch(PrimerPair *pp, WeightMatrix *wm, bool cNoRevC, bool cNoSelfSelf, int cMinAmp, int cMaxAmp, int ckmm) {
+  weights = wm;
+  noSelfSelf = cNoSelfSelf;
+  kmm = ckmm;
+  seqName[0] = '\0';
+
+  std::string forPrimer = pp->getForPrimer();
+  std::string revPrimer = pp->getRevPrimer();
+  single = (revPrimer.length() == 0);
+
+  Probe probe;
+  probe.pattern = forPrimer;
+  probe.primer = FOR;
+  probe.end = P5;
+  probe.isComp = false;
+  leftProbes.push_back(probe);
+  
+  probe.pattern = PrimerSearch::reverseComplement(forPrimer);
+  probe.end = P3;
+  probe.isComp = true;
+  rightProbes.push_back(probe);
+  
+  if (!single) {
+    std::string revOligo = (cNoRevC) ? PrimerSearch::reverseComplement(revPrimer) : revPrimer;
+    
+    probe.pattern = revOligo;
+    probe.primer = REV;
+    probe.end = P5;
+    probe.isComp = false;
+    leftProbes.push_back(probe);
+  
+    probe.pattern = PrimerSearch::reverseComplement(revOligo);
+    probe.end = P3;
+    probe.isComp = true;
+    rightProbes.push_back(probe);
+  }
+  
+  // same floor as PrimerSearch - never shorter than a primer
+  minAmpSize = cMinAmp;
+  maxAmpSize = cMaxAmp;
+  if (minAmpSize < (int) forPrimer.length()) {
+    minAmpSize = forPrimer.length();
+  }
+  if (minAmpSize < (int) revPrimer.length()) {
+    minAmpSize = revPrimer.length();
+  }
+}
+
+ReferenceSearch::~ReferenceSearch() {
+  for (unsigned int i=0; i < sites.size(); i++) {
+    delete sites[i];
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// search                                                                    //
+//  inputs: sequence name <std::string>, decoded bases <std::string>         //
+//  output: none                                                             //
+//    desc: finds every probe hit scoring at most kmm, then pairs 5' and     //
+//          3' hits into priming sites.  Positions are 1-based and           //
+//          inclusive like PrimerSearch.  A pair only counts when the 3'     //
+//          site starts after the 5' site ends; the kernels only track       //
+//          3' sites once a 5' site has been seen.  With a single primer     //
+//          every hit is a site of its own.                                  //
+///////////////////////////////////////////////////////////////////////////////  
+
+void ReferenceSearch::search(std::string cSeqName, std::string sequence) {
+  strncpy(seqName, cSeqName.c_str(), MAX_SEQNAME_SIZE-1);
+  seqName[MAX_SEQNAME_SIZE-1] = '\0';
+  
+  std::vector<Hit> leftHits;
+  std::vector<Hit> rightHits;
+  findHits(leftProbes, sequence, leftHits);
+  findHits(rightProbes, sequence, rightHits);
+  
+  if (single) {
+    for (unsigned int i=0; i < leftHits.size(); i++) {
+      addPrimingSite(leftHits[i].start, leftHits[i].stop, FOR, REV, leftHits[i].score, 0);
+    }
+    for (unsigned int i=0; i < rightHits.size(); i++) {
+      addPrimingSite(rightHits[i].start, rightHits[i].stop, REV, FOR, 0, rightHits[i].score);
+    }
+    return;
+  }
+  
+  for (unsigned int i=0; i < leftHits.size(); i++) {
+    for (unsigned int j=0; j < rightHits.size(); j++) {
+      int ampSize = (int) rightHits[j].stop - (int) leftHits[i].start + 1;
+      if (rightHits[j].start > leftHits[i].stop &&
+          ampSize >= minAmpSize && ampSize <= maxAmpSize) {
+        addPrimingSite(leftHits[i].start, rightHits[j].stop, leftHits[i].primer, rightHits[j].primer,
+                       leftHits[i].score, rightHits[j].score);
+      }
+    }
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// score                                                                     //
+//  inputs: probe <Probe>, bases <std::string>, 0-based start <int>          //
+//  output: summed weight of the probe laid on the bases at start <int>      //
+///////////////////////////////////////////////////////////////////////////////  
+
+int ReferenceSearch::score(Probe &probe, std::string &sequence, int start) {
+  int patLength = probe.pattern.length();
+  int total = 0;
+  for (int i=0; i < patLength; i++) {
+    char pbase = probe.pattern[i];
+    char tbase = sequence[start + i];
+    if (probe.isComp) {
+      pbase = PrimerSearch::complement(pbase);
+      tbase = PrimerSearch::complement(tbase);
+    }
+    int p5 = (probe.end == P5) ? i : patLength - 1 - i;
+    total += weights->getWeight(probe.primer, p5, patLength - 1 - p5, pbase, tbase);
+  }
+  return total;
+}
+
+void ReferenceSearch::findHits(std::vector<Probe> &probes, std::string &sequence, std::vector<Hit> &hits) {
+  for (unsigned int p=0; p < probes.size(); p++) {
+    int patLength = probes[p].pattern.length();
+    for (int start=0; start + patLength <= (int) sequence.length(); start++) {
+      int hitScore = score(probes[p], sequence, start);
+      if (hitScore <= kmm) {
+        Hit hit;
+        hit.score = hitScore;
+        hit.start = start + 1;
+        hit.stop = start + patLength;
+        hit.primer = probes[p].primer;
+        hits.push_back(hit);
+      }
+    }
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// addPrimingSite                                                            //
+//    desc: records a site with the PrimerSearch strand convention.  A       //
+//          position pair can bind in more than one primer combination,      //
+//          so unlike PrimerSearch every combination is kept.                //
+///////////////////////////////////////////////////////////////////////////////  
+
+void ReferenceSearch::addPrimingSite(unsigned int forPos, unsigned int revPos, PrimerDirection forDir, PrimerDirection revDir,
+                                     int forScore, int revScore) {
+  if (forDir == revDir && noSelfSelf) {
+    return;
+  }
+  DNAStrand strand = PS;
+  if (forDir == REV && revDir == FOR) {
+    strand = MS;
+    std::swap(forScore, revScore);
+  }
+  sites.push_back(new PrimingSite(seqName, forPos, revPos, forDir, revDir, strand, forScore, revScore));
+}
+
+int ReferenceSearch::getMatchCount() {
+  return sites.size();
+}
+
+PrimingSite *ReferenceSearch::getPrimingSite(int mc) {
+  return sites[mc];
+}
+
+int ReferenceSearch::getMinAmpSize() {
+  return minAmpSize;
+}
+
+int ReferenceSearch::getMaxAmpSize() {
+  return maxAmpSize;
+}
@@ -0,0 +1,84 @@
+#ifndef REFERENCESEARCH_H__
+#define REFERENCESEARCH_H__
+
+#include <string>
+#include <vector>
+#include "Properties.h"
+#include "PrimerPair.h"
+#include "PrimingSite.h"
+#include "WeightMatrix.h"
+
+/////////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2007 Affymetrix, Inc.                                         //
+//                                                                             //
+// This program is free software; you can redistribute it and/or modify        //
+// it under the terms of the GNU General Public License (version 2) as         //
+// published by the Free Software Foundation.                                  //
+//                                                                             //
+// This program is distributed in the hope that it will be useful,             //
+// but WITHOUT ANY WARRANTY; without even the implied warranty of              // 
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU            //
+// General Public License for more details.                                    //
+//                                                                             //
+// You should have received a copy of the GNU General Public License           //
+// along with this program;if not, write to the                                //
+//                                                                             //
+// Free Software Foundation, Inc.,                                             //
+// 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA                       // 
+/////////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+// ReferenceSearch                                                           //
+// - Slow, obviously-correct primer search used to check the bit-parallel    //
+//   kernels in PrimerSearch.  Each primer is slid over the decoded          //
+//   sequence one base at a time and its score is the plain sum of           //
+//   WeightMatrix::getWeight over the primer.                                //
+///////////////////////////////////////////////////////////////////////////////  
+
+class ReferenceSearch {
+  public:
+
+    ReferenceSearch(PrimerPair *pp, WeightMatrix *wm, bool cNoRevC, bool cNoSelfSelf, int cMinAmp, int cMaxAmp, int ckmm);
+    void search(std::string cSeqName, std::string sequence);
+    int getMatchCount();
+    PrimingSite *getPrimingSite(int mc);
+    int getMinAmpSize();
+    int getMaxAmpSize();
+    ~ReferenceSearch();
+    
+  private:
+  
+    // one way a primer can bind: the bases it pairs with as they read on
+    // the plus strand, and how to weight them
+    struct Probe {
+      std::string pattern;
+      PrimerDirection primer;
+      PrimerEnd end;      // P5 - primer 5' end is the leftmost base
+      bool isComp;        // weight the complemented bases
+    };
+
+    struct Hit {
+      unsigned int start;
+      unsigned int stop;
+      PrimerDirection primer;
+      int score;
+    };
+    
+    int score(Probe &probe, std::string &sequence, int start);
+    void findHits(std::vector<Probe> &probes, std::string &sequence, std::vector<Hit> &hits);
+    void addPrimingSite(unsigned int forPos, unsigned int revPos, PrimerDirection forDir, PrimerDirection revDir,
+                        int forScore, int revScore);
+    
+    WeightMatrix *weights;
+    std::vector<Probe> leftProbes;   // bind at the 5' end of the amplicon
+    std::vector<Probe> rightProbes;  // bind at the 3' end of the amplicon
+    std::vector<PrimingSite*> sites;
+    bool single;
+    bool noSelfSelf;
+    int minAmpSize;
+    int maxAmpSize;
+    int kmm;
+    char seqName[MAX_SEQNAME_SIZE];
+};
+
+#endif // REFERENCESEARCH_H__ 
@@ -0,0 +1,342 @@
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <stdlib.h>
+#include "Properties.h"
+#include "PrimerPair.h"
+#include "PrimerSearch.h"
+#include "WeightMatrix.h"
+#include "BlastInfo.h"
+#include "HitDisplay.h"
+#include "RunStats.h"
+
+/////////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2007 Affymetrix, Inc.                                         //
+//                                                                             //
+// This program is free software; you can redistribute it and/or modify        //
+// it under the terms of the GNU General Public License (version 2) as         //
+// published by the Free Software Foundation.                                  //
+//                                                                             //
+// This program is distributed in the hope that it will be useful,             //
+// but WITHOUT ANY WARRANTY; without even the implied warranty of              // 
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU            //
+// General Public License for more details.                                    //
+//                                                                             //
+// You should have received a copy of the GNU General Public License           //
+// along with this program;if not, write to the                                //
+//                                                                             //
+// Free Software Foundation, Inc.,                                             //
+// 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA                       // 
+/////////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+// PGREP kernel microbenchmarks (make bench)                                 //
+// - Times the search kernels on random and repeat-rich packed buffers,      //
+//   pattern array construction, priming site bookkeeping, full output       //
+//   formatting and blast index loading.  Each benchmark is repeated and     //
+//   the median, min and max are reported.                                   //
+///////////////////////////////////////////////////////////////////////////////  
+
+const int BENCH_BYTES = BUFFERSIZE;      // packed bytes per kernel run
+const int REPEAT_UNIT = 250;             // bytes per planted repeat copy
+const int MIN_AMP = 300;                 // amplicon limits, kept under the
+const int MAX_AMP = 800;                 // repeat spacing so stacks drain
+
+const std::string FOR_PRIMER = "TGGCACAGTCTGCATTCAGAACC";
+const std::string REV_PRIMER = "GGAGCAAGGTCACGATCTTGCTC";
+
+unsigned int seed = 20070727;
+
+///////////////////////////////////////////////////////////////////////////////
+// nextRandom                                                                //
+//  output: next value of a fixed-seed LCG, so every run sees the same       //
+//          buffers <unsigned int>                                           //
+///////////////////////////////////////////////////////////////////////////////  
+
+unsigned int nextRandom() {
+  seed = seed * 1103515245 + 12345;
+  return (seed >> 8);
+}
+
+int baseCode(char base) {
+  switch (base) {
+    case 'C': return 1;
+    case 'G': return 2;
+    case 'T': return 3;
+  }
+  return 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// packBases                                                                 //
+//  inputs: bases <std::string>, packed buffer <char*>                       //
+//  output: none                                                             //
+//    desc: packs four bases per byte, first base in the high bits, like     //
+//          the pgrep db format.  Length must be a multiple of 4.            //
+///////////////////////////////////////////////////////////////////////////////  
+
+void packBases(std::string bases, char *buffer) {
+  for (unsigned int i=0; i < bases.length(); i += 4) {
+    buffer[i/4] = (char) ((baseCode(bases[i]) << 6) | (baseCode(bases[i+1]) << 4) |
+                          (baseCode(bases[i+2]) << 2) | baseCode(bases[i+3]));
+  }
+}
+
+std::string randomBases(int n) {
+  std::string bases(n, 'A');
+  for (int i=0; i < n; i++) {
+    bases[i] = "ACGT"[nextRandom() & 3];
+  }
+  return bases;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// repeatBuffer                                                              //
+//  inputs: packed buffer <char*>                                            //
+//  output: none                                                             //
+//    desc: fills the buffer with copies of one unit holding the primer      //
+//          pair 600 bp apart, with 2% of bases mutated per copy, so most    //
+//          copies are a priming site at k=2                                 //
+///////////////////////////////////////////////////////////////////////////////  
+
+void repeatBuffer(char *buffer) {
+  std::string unit = randomBases(REPEAT_UNIT*4);
+  unit.replace(100, FOR_PRIMER.length(), FOR_PRIMER);
+  unit.replace(700, REV_PRIMER.length(), PrimerSearch::reverseComplement(REV_PRIMER));
+  
+  for (int u=0; u < BENCH_BYTES/REPEAT_UNIT; u++) {
+    std::string copy = unit;
+    for (unsigned int i=0; i < copy.length(); i++) {
+      if (nextRandom() % 100 < 2) {
+        copy[i] = "ACGT"[nextRandom() & 3];
+      }
+    }
+    packBases(copy, buffer + u*REPEAT_UNIT);
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Timings                                                                   //
+// - Repeated wall clock timings of one benchmark                            //
+///////////////////////////////////////////////////////////////////////////////  
+
+class Timings {
+  public:
+    Timings(std::string cName, double cBytes, double cItems) {
+      name = cName;
+      bytes = cBytes;
+      items = cItems;
+    }
+    void add(double seconds) {
+      times.push_back(seconds);
+    }
+    double median() {
+      std::sort(times.begin(), times.end());
+      return times[times.size()/2];
+    }
+    void report() {
+      double median = this->median();
+      std::cout << name << "\t";
+      if (bytes > 0) {
+        std::cout << median*1e9/bytes << "\t" << times[0]*1e9/bytes << "\t" << times[times.size()-1]*1e9/bytes;
+      }
+      else {
+        std::cout << "-\t-\t-";
+      }
+      std::cout << "\t" << ((median > 0) ? items/median : 0) << "\n";
+    }
+    
+  private:
+    std::string name;
+    double bytes;  // bytes per timed run, for ns/byte
+    double items;  // items per timed run, for items/s
+    std::vector<double> times;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// benchKernel                                                               //
+//  inputs: label <std::string>, packed buffer <char*>, mismatches <int>,    //
+//          single primer flag <bool>, repetitions <int>                     //
+//  output: priming sites found by the last run <int>                        //
+//    desc: one findPattern call over the whole buffer per repetition.       //
+//          Items are packed bytes.                                          //
+///////////////////////////////////////////////////////////////////////////////  
+
+int benchKernel(std::string label, char *buffer, int kmm, bool single, int reps) {
+  WeightMatrix wm;
+  PrimerPair pp("bench", FOR_PRIMER, single ? "" : REV_PRIMER, 600);
+  std::ostringstream name;
+  name << label << " k" << kmm << (single ? " single" : " pair");
+  Timings timings(name.str(), BENCH_BYTES, BENCH_BYTES);
+  
+  int sites = 0;
+  for (int r=0; r < reps; r++) {
+    PrimerSearch *ps = new PrimerSearch(&pp, &wm, false, false, 2.0, 2.0, MIN_AMP, MAX_AMP, kmm);
+    char seqName[] = "bench";
+    ps->reset(seqName);
+    double start = RunStats::wallSeconds();
+    ps->findPattern(buffer, 0, BENCH_BYTES, 0, MAX_MATCHES - 1);
+    timings.add(RunStats::wallSeconds() - start);
+    sites = ps->getMatchCount();
+    delete ps;
+  }
+  timings.report();
+  return sites;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// benchPatterns                                                             //
+//  inputs: mismatches <int>, repetitions <int>                              //
+//  output: none                                                             //
+//    desc: PrimerSearch construction, which is dominated by                 //
+//          createPatternArray.  Items are constructions, also given as      //
+//          microseconds per primer pair.                                    //
+///////////////////////////////////////////////////////////////////////////////  
+
+void benchPatterns(int kmm, int reps) {
+  const int builds = 2000;
+  WeightMatrix wm;
+  PrimerPair pp("bench", FOR_PRIMER, REV_PRIMER, 600);
+  std::ostringstream name;
+  name << "PrimerSearch setup k" << kmm;
+  Timings timings(name.str(), 0, builds);
+  
+  for (int r=0; r < reps; r++) {
+    double start = RunStats::wallSeconds();
+    for (int b=0; b < builds; b++) {
+      PrimerSearch *ps = new PrimerSearch(&pp, &wm, false, false, 2.0, 2.0, MIN_AMP, MAX_AMP, kmm);
+      delete ps;
+    }
+    timings.add(RunStats::wallSeconds() - start);
+  }
+  timings.report();
+  std::cout << "  us/pair\t" << timings.median()*1e6/builds << "\n";
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// benchDisplay                                                              //
+//  inputs: repeat-rich buffer <char*>, repetitions <int>                    //
+//  output: none                                                             //
+//    desc: convertToSequence on amplicon sized slices, then displayHits     //
+//          for every site of a k=2 search.  displayHits items are sites,    //
+//          bytes are output characters.                                     //
+///////////////////////////////////////////////////////////////////////////////  
+
+void benchDisplay(char *buffer, int reps) {
+  const int slices = 20000;
+  const int sliceBytes = 160;
+  Timings convert("convertToSequence", double(slices)*sliceBytes, slices);
+  for (int r=0; r < reps; r++) {
+    double start = RunStats::wallSeconds();
+    for (int s=0; s < slices; s++) {
+      char *sequence = PrimerSearch::convertToSequence(buffer, BUFFERSIZE*2, (s*sliceBytes) % BENCH_BYTES, sliceBytes);
+      delete [] sequence;
+    }
+    convert.add(RunStats::wallSeconds() - start);
+  }
+  convert.report();
+  
+  WeightMatrix wm;
+  PrimerPair pp("bench", FOR_PRIMER, REV_PRIMER, 600);
+  PrimerSearch *ps = new PrimerSearch(&pp, &wm, false, false, 2.0, 2.0, MIN_AMP, MAX_AMP, 2);
+  char seqName[] = "bench";
+  ps->reset(seqName);
+  ps->findPattern(buffer, 0, BENCH_BYTES, 0, MAX_MATCHES - 1);
+  
+  std::ostringstream out;
+  std::vector<double> times;
+  double outBytes = 0;
+  for (int r=0; r < reps; r++) {
+    out.str("");
+    int disMatchCount = 0;
+    double start = RunStats::wallSeconds();
+    displayHits(out, ps, disMatchCount, seqName, buffer, 0, 0, BENCH_BYTES, 0);
+    times.push_back(RunStats::wallSeconds() - start);
+    outBytes = out.str().length();
+  }
+  Timings display("displayHits", outBytes, ps->getMatchCount());
+  for (unsigned int r=0; r < times.size(); r++) {
+    display.add(times[r]);
+  }
+  display.report();
+  delete ps;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// benchBlastInfo                                                            //
+//  inputs: blast db name <std::string>, repetitions <int>                   //
+//  output: none                                                             //
+//    desc: loadBlastInfo on the test blast db.  Items are seq entries.      //
+///////////////////////////////////////////////////////////////////////////////  
+
+void benchBlastInfo(std::string filename, int reps) {
+  const int loads = 2000;
+  BlastInfo *entries[MAX_BLAST_ENTRIES+1];
+  loadBlastInfo(filename, entries);
+  int nseqs = 0;
+  while (entries[nseqs] != NULL) {
+    delete entries[nseqs++];
+  }
+  
+  Timings timings("loadBlastInfo", 0, double(loads)*nseqs);
+  for (int r=0; r < reps; r++) {
+    double start = RunStats::wallSeconds();
+    for (int l=0; l < loads; l++) {
+      loadBlastInfo(filename, entries);
+      for (int i=0; entries[i] != NULL; i++) {
+        delete entries[i];
+      }
+    }
+    timings.add(RunStats::wallSeconds() - start);
+  }
+  timings.report();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// main                                                                      //
+//  usage: bench [repetitions] [blast db]                                    //
+///////////////////////////////////////////////////////////////////////////////  
+
+int main(int argc, char *argv[]) {
+  int reps = (argc > 1) ? atoi(argv[1]) : 7;
+  std::string blastDb = (argc > 2) ? argv[2] : "testdb.txt";
+  if (reps < 1) {
+    std::cerr << "usage: bench [repetitions] [blast db]\n";
+    exit(1);
+  }
+  
+  // convertToSequence/displayHits expect a double size buffer
+  char *randomBuffer = new char[BUFFERSIZE*2];
+  char *repeatRich = new char[BUFFERSIZE*2];
+  packBases(randomBases(BENCH_BYTES*4), randomBuffer);
+  repeatBuffer(repeatRich);
+  
+  std::cout << "benchmark\tns/byte (median)\tmin\tmax\titems/s (median)\n";
+  
+  // kernels, k chosen to hit each bit width
+  int pairK[] = {0, 1, 2, 4};
+  for (int i=0; i < 4; i++) {
+    benchKernel("findPattern random", randomBuffer, pairK[i], false, reps);
+  }
+  for (int k=0; k <= 2; k++) {
+    benchKernel("findOnePattern random", randomBuffer, k, true, reps);
+  }
+  
+  // repeat-rich buffers are dominated by revMatch and addPrimingSite
+  for (int i=0; i < 4; i++) {
+    int sites = benchKernel("findPattern repeats", repeatRich, pairK[i], false, reps);
+    std::cout << "  priming sites\t" << sites << "\n";
+  }
+  
+  for (int i=0; i < 4; i++) {
+    benchPatterns(pairK[i], reps);
+  }
+  benchDisplay(repeatRich, reps);
+  benchBlastInfo(blastDb, reps);
+  
+  delete [] randomBuffer;
+  delete [] repeatRich;
+  return 0;
+}
@@ -0,0 +1,460 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <stdlib.h>
+#include <stdio.h>
+#include "Properties.h"
+#include "PrimerPair.h"
+#include "PrimerSearch.h"
+#include "WeightMatrix.h"
+#include "ReferenceSearch.h"
+
+/////////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2007 Affymetrix, Inc.                                         //
+//                                                                             //
+// This program is free software; you can redistribute it and/or modify        //
+// it under the terms of the GNU General Public License (version 2) as         //
+// published by the Free Software Foundation.                                  //
+//                                                                             //
+// This program is distributed in the hope that it will be useful,             //
+// but WITHOUT ANY WARRANTY; without even the implied warranty of              // 
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU            //
+// General Public License for more details.                                    //
+//                                                                             //
+// You should have received a copy of the GNU General Public License           //
+// along with this program;if not, write to the                                //
+//                                                                             //
+// Free Software Foundation, Inc.,                                             //
+// 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA                       // 
+/////////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+// PGREP differential kernel fuzzer (make fuzz)                              //
+// - Runs PrimerSearch and ReferenceSearch on random sequences, primers,     //
+//   mismatch levels, weight rules and search options and checks that both   //
+//   find the same priming sites.  A failing case is shrunk before it is     //
+//   printed so it can be turned into a regression test.                     //
+///////////////////////////////////////////////////////////////////////////////  
+
+const int MIN_PRIMER = 10;
+const int MAX_PRIMER = 28;               // pattern halves are 32 bits wide
+const int MIN_SEQ_BYTES = 40;
+const int MAX_SEQ_BYTES = 900;
+const int MAX_SHOWN = 10;                // site differences printed per case
+const char *WEIGHTS_FILE = "fuzz_weights.txt";
+
+unsigned int seed = 20070727;
+
+unsigned int nextRandom() {
+  seed = seed * 1103515245 + 12345;
+  return (seed >> 8);
+}
+
+int randomInt(int low, int high) {
+  return low + nextRandom() % (high - low + 1);
+}
+
+std::string randomBases(int n) {
+  std::string bases(n, 'A');
+  for (int i=0; i < n; i++) {
+    bases[i] = "ACGT"[nextRandom() & 3];
+  }
+  return bases;
+}
+
+// a primer or sequence stretch made of a short repeated unit, so hits
+// a few bases apart land in the same or neighbouring bytes
+std::string repeatBases(int n) {
+  std::string unit = randomBases(randomInt(1, 3));
+  std::string bases;
+  while ((int) bases.length() < n) {
+    bases += unit;
+  }
+  return bases.substr(0, n);
+}
+
+int baseCode(char base) {
+  switch (base) {
+    case 'C': return 1;
+    case 'G': return 2;
+    case 'T': return 3;
+  }
+  return 0;
+}
+
+void packBases(std::string bases, char *buffer) {
+  for (unsigned int i=0; i < bases.length(); i += 4) {
+    buffer[i/4] = (char) ((baseCode(bases[i]) << 6) | (baseCode(bases[i+1]) << 4) |
+                          (baseCode(bases[i+2]) << 2) | baseCode(bases[i+3]));
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// FuzzCase                                                                  //
+// - Everything needed to rerun one comparison.  No weight rules means the   //
+//   built-in default weighting.  The packed sequence is handed to the       //
+//   kernel in two findPattern calls split at byte split.                    //
+///////////////////////////////////////////////////////////////////////////////  
+
+struct FuzzCase {
+  std::string forPrimer;
+  std::string revPrimer;                 // empty for a single primer search
+  int kmm;
+  bool noRevC;
+  bool noSelfSelf;
+  int minAmp;
+  int maxAmp;
+  std::vector<std::string> rules;
+  std::string sequence;                  // length is a multiple of 4
+  int split;
+};
+
+// site key -> primer combinations found there, with their scores
+// (forDir*2 + revDir + 4*(forScore*SCORE_LIMIT + revScore))
+typedef std::map<std::pair<unsigned int, unsigned int>, std::set<int> > SiteMap;
+const int SCORE_LIMIT = 256;
+
+std::string describe(int combo) {
+  const char *dirs[] = {"FOR-FOR", "FOR-REV", "REV-FOR", "REV-REV"};
+  std::ostringstream text;
+  text << dirs[combo % 4] << " " << (combo/4)/SCORE_LIMIT << "/" << (combo/4)%SCORE_LIMIT;
+  return text.str();
+}
+
+std::string randomRule() {
+  const char *primers = "FR*";
+  std::ostringstream rule;
+  rule << primers[nextRandom() % 3] << "\t" << (nextRandom() % 2 ? 5 : 3) << "\t";
+  if (nextRandom() % 3 == 0) {
+    rule << "*\t*";
+  }
+  else {
+    int start = randomInt(1, 8);
+    rule << start << "\t" << start + randomInt(0, 5);
+  }
+  rule << "\t" << randomInt(1, 3) << "\t" << "ACGTNRY"[nextRandom() % 7] << "\t" << "ACGTN!"[nextRandom() % 6];
+  return rule.str();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// mutate                                                                    //
+//  inputs: primer <std::string>, number of bases to change <int>            //
+//  output: the primer with that many random substitutions <std::string>     //
+///////////////////////////////////////////////////////////////////////////////  
+
+std::string mutate(std::string primer, int changes) {
+  for (int i=0; i < changes; i++) {
+    primer[nextRandom() % primer.length()] = "ACGT"[nextRandom() & 3];
+  }
+  return primer;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// degenerate                                                                //
+//  inputs: primer <std::string>, number of bases to widen <int>             //
+//  output: the primer with that many bases made IUPAC codes that still      //
+//          cover the original base <std::string>                            //
+///////////////////////////////////////////////////////////////////////////////  
+
+std::string degenerate(std::string primer, int changes) {
+  // IUPAC code by its 4-bit set (A1 C2 G4 T8)
+  const char *codes = "-ACMGRSVTWYHKDBN";
+  for (int i=0; i < changes; i++) {
+    int pos = nextRandom() % primer.length();
+    primer[pos] = codes[WeightMatrix::iupac2bits(primer[pos]) | (nextRandom() & 15)];
+  }
+  return primer;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// randomCase                                                                //
+//  output: a random case <FuzzCase>                                         //
+//    desc: plants primer copies with up to kmm+1 changes on both strands,   //
+//          some as amplicons sized around the limits, so hits and near      //
+//          misses are common.  Mismatch levels are kept low enough for      //
+//          the primer lengths that chance hits stay under MATCH_BUFFER,     //
+//          and amplicons are at least two primers long - overlapping        //
+//          sites are outside what the kernels track.  A quarter of the      //
+//          cases widen a few primer bases to IUPAC codes after planting.    //
+///////////////////////////////////////////////////////////////////////////////  
+
+FuzzCase randomCase() {
+  FuzzCase fc;
+  bool single = (nextRandom() % 5 == 0);
+  bool repeats = (nextRandom() % 8 == 0);
+  fc.forPrimer = randomBases(randomInt(MIN_PRIMER, MAX_PRIMER));
+  fc.revPrimer = (single) ? "" : randomBases(randomInt(MIN_PRIMER, MAX_PRIMER));
+  if (repeats) {
+    fc.forPrimer = repeatBases(fc.forPrimer.length());
+  }
+  
+  int shortest = fc.forPrimer.length();
+  int longest = fc.forPrimer.length();
+  if (!single) {
+    shortest = std::min(shortest, (int) fc.revPrimer.length());
+    longest = std::max(longest, (int) fc.revPrimer.length());
+  }
+  fc.kmm = randomInt(0, std::min((single) ? 3 : 7, shortest/3));
+  fc.noRevC = (!single && nextRandom() % 3 == 0);
+  fc.noSelfSelf = (nextRandom() % 3 == 0);
+  fc.minAmp = 2*longest + randomInt(0, 40);
+  fc.maxAmp = fc.minAmp + randomInt(0, 400);
+  
+  if (nextRandom() % 3 != 0) {
+    fc.rules.push_back("*\t5\t*\t*\t1\tN\t!");
+    int extra = randomInt(0, 3);
+    for (int i=0; i < extra; i++) {
+      fc.rules.push_back(randomRule());
+    }
+  }
+
+  // the four plus-strand forms of the primers
+  std::vector<std::string> forms;
+  forms.push_back(fc.forPrimer);
+  forms.push_back(PrimerSearch::reverseComplement(fc.forPrimer));
+  if (!single) {
+    forms.push_back(fc.revPrimer);
+    forms.push_back(PrimerSearch::reverseComplement(fc.revPrimer));
+  }
+  
+  fc.sequence = randomBases(4*randomInt(MIN_SEQ_BYTES, MAX_SEQ_BYTES));
+  int seqLength = fc.sequence.length();
+  int plants = randomInt(0, 8);
+  for (int i=0; i < plants; i++) {
+    std::string left = mutate(forms[nextRandom() % forms.size()], randomInt(0, fc.kmm + 1));
+    if (repeats) {
+      left += forms[nextRandom() % forms.size()].substr(0, randomInt(0, 8));
+    }
+    std::string right = mutate(forms[nextRandom() % forms.size()], randomInt(0, fc.kmm + 1));
+    int ampSize = randomInt(fc.minAmp - 4, fc.maxAmp + 4);
+    if (ampSize > seqLength || nextRandom() % 4 == 0) {
+      // lone site
+      int start = randomInt(0, seqLength - left.length());
+      fc.sequence.replace(start, left.length(), left);
+      continue;
+    }
+    int start = randomInt(0, seqLength - ampSize);
+    fc.sequence.replace(start, left.length(), left);
+    fc.sequence.replace(start + ampSize - right.length(), right.length(), right);
+  }
+  
+  // some searches are for a degenerate family the plants belong to
+  if (nextRandom() % 4 == 0) {
+    fc.forPrimer = degenerate(fc.forPrimer, randomInt(1, 2));
+    if (!single) {
+      fc.revPrimer = degenerate(fc.revPrimer, randomInt(1, 2));
+    }
+  }
+  
+  fc.split = randomInt(0, seqLength/4);
+  return fc;
+}
+
+void addSite(SiteMap &sites, PrimingSite *ps) {
+  std::pair<unsigned int, unsigned int> key(ps->getForPos(), ps->getRevPos());
+  sites[key].insert(ps->getForDir()*2 + ps->getRevDir() + 4*(ps->getForScore()*SCORE_LIMIT + ps->getRevScore()));
+}
+
+void loadWeights(FuzzCase &fc, WeightMatrix &wm) {
+  if (fc.rules.size() == 0) {
+    return;
+  }
+  std::ofstream out(WEIGHTS_FILE);
+  out << "Primer\tEnd\tStart\tStop\tWeight\tPBase\tTBase\n";
+  for (unsigned int i=0; i < fc.rules.size(); i++) {
+    out << fc.rules[i] << "\n";
+  }
+  out.close();
+  wm.loadWeightsFile(WEIGHTS_FILE);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// runKernel                                                                 //
+//  inputs: case <FuzzCase>, sites found <SiteMap>                           //
+//  output: number of sites found by a count-only search <int>               //
+//    desc: searches with PrimerSearch as pgrep does - packed buffer,        //
+//          split into two calls carrying the position forward - once        //
+//          keeping the sites and once just counting them                    //
+///////////////////////////////////////////////////////////////////////////////  
+
+int runKernel(FuzzCase &fc, SiteMap &sites) {
+  WeightMatrix wm;
+  loadWeights(fc, wm);
+  PrimerPair pp("fuzz", fc.forPrimer, fc.revPrimer, fc.minAmp);
+  
+  int bytes = fc.sequence.length()/4;
+  char *buffer = new char[bytes + 1];
+  packBases(fc.sequence, buffer);
+  char seqName[] = "fuzz";
+  int counted = 0;
+  for (int countOnly = 0; countOnly < 2; countOnly++) {
+    PrimerSearch *ps = new PrimerSearch(&pp, &wm, fc.noRevC, fc.noSelfSelf, 1.0, 1.0, fc.minAmp, fc.maxAmp, fc.kmm);
+    ps->setCountOnly(countOnly);
+    ps->reset(seqName);
+    ps->findPattern(buffer, 0, fc.split, 0, MAX_MATCHES - 1);
+    ps->findPattern(buffer, fc.split, bytes, fc.split*4, MAX_MATCHES - 1);
+    
+    if (countOnly) {
+      counted = ps->getMatchCount();
+    }
+    else {
+      for (int i=0; i < ps->getMatchCount(); i++) {
+        addSite(sites, ps->getPrimingSite(i));
+      }
+    }
+    delete ps;
+  }
+  delete [] buffer;
+  return counted;
+}
+
+void runReference(FuzzCase &fc, SiteMap &sites) {
+  WeightMatrix wm;
+  loadWeights(fc, wm);
+  PrimerPair pp("fuzz", fc.forPrimer, fc.revPrimer, fc.minAmp);
+  ReferenceSearch rs(&pp, &wm, fc.noRevC, fc.noSelfSelf, fc.minAmp, fc.maxAmp, fc.kmm);
+  rs.search("fuzz", fc.sequence);
+  for (int i=0; i < rs.getMatchCount(); i++) {
+    addSite(sites, rs.getPrimingSite(i));
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// compareSites                                                              //
+//  inputs: case <FuzzCase>, print differences <bool>                        //
+//  output: number of differences <int>                                      //
+//    desc: every reference position pair must be found by the kernel and    //
+//          vice versa.  The kernel keeps one primer combination per pair,   //
+//          which must be one the reference found there with the same        //
+//          scores, and counting alone must give the same number of pairs.   //
+///////////////////////////////////////////////////////////////////////////////  
+
+int compareSites(FuzzCase &fc, bool show) {
+  SiteMap kernelSites;
+  SiteMap referenceSites;
+  int counted = runKernel(fc, kernelSites);
+  runReference(fc, referenceSites);
+  
+  int differences = 0;
+  if (counted != (int) kernelSites.size()) {
+    if (show) {
+      std::cout << "  count-only search found " << counted << " sites, not " <<
+                   kernelSites.size() << "\n";
+    }
+    ++differences;
+  }
+  for (SiteMap::iterator it = referenceSites.begin(); it != referenceSites.end(); ++it) {
+    SiteMap::iterator found = kernelSites.find(it->first);
+    std::string problem;
+    if (found == kernelSites.end()) {
+      problem = "missed by kernel";
+    }
+    else if (found->second.size() != 1 || it->second.count(*found->second.begin()) == 0) {
+      problem = std::string("kernel primers ") + describe(*found->second.begin());
+    }
+    else {
+      continue;
+    }
+    if (show && differences < MAX_SHOWN) {
+      std::cout << "  " << it->first.first << "-" << it->first.second << " " <<
+                   describe(*it->second.begin()) << ": " << problem << "\n";
+    }
+    ++differences;
+  }
+  for (SiteMap::iterator it = kernelSites.begin(); it != kernelSites.end(); ++it) {
+    if (referenceSites.count(it->first) == 0) {
+      if (show && differences < MAX_SHOWN) {
+        std::cout << "  " << it->first.first << "-" << it->first.second << " " <<
+                     describe(*it->second.begin()) << ": extra in kernel\n";
+      }
+      ++differences;
+    }
+  }
+  return differences;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// minimize                                                                  //
+//  inputs: failing case <FuzzCase>                                          //
+//  output: a smaller case that still fails <FuzzCase>                       //
+//    desc: removes 4-base aligned chunks of sequence, halving the chunk     //
+//          size down to one byte, then drops weight rules and the buffer    //
+//          split while the kernel and reference still disagree              //
+///////////////////////////////////////////////////////////////////////////////  
+
+FuzzCase minimize(FuzzCase fc) {
+  for (int chunk = fc.sequence.length()/8*4; chunk >= 4; chunk /= 2) {
+    chunk -= chunk % 4;
+    for (int start = 0; start + chunk <= (int) fc.sequence.length(); ) {
+      FuzzCase trial = fc;
+      trial.sequence.erase(start, chunk);
+      trial.split = std::min(trial.split, (int) trial.sequence.length()/4);
+      if (compareSites(trial, false) > 0) {
+        fc = trial;
+      }
+      else {
+        start += chunk;
+      }
+    }
+  }
+  for (int i = fc.rules.size() - 1; i >= 1; i--) {
+    FuzzCase trial = fc;
+    trial.rules.erase(trial.rules.begin() + i);
+    if (compareSites(trial, false) > 0) {
+      fc = trial;
+    }
+  }
+  if (fc.split != 0) {
+    FuzzCase trial = fc;
+    trial.split = 0;
+    if (compareSites(trial, false) > 0) {
+      fc = trial;
+    }
+  }
+  return fc;
+}
+
+void printCase(FuzzCase &fc) {
+  std::cout << "  primers: " << fc.forPrimer << " " << (fc.revPrimer == "" ? "-" : fc.revPrimer) <<
+               "  k " << fc.kmm << "  amplicon " << fc.minAmp << "-" << fc.maxAmp <<
+               (fc.noRevC ? "  noRevC" : "") << (fc.noSelfSelf ? "  noSelfSelf" : "") <<
+               "  split " << fc.split << "\n";
+  for (unsigned int i=0; i < fc.rules.size(); i++) {
+    std::cout << "  weight: " << fc.rules[i] << "\n";
+  }
+  for (unsigned int i=0; i < fc.sequence.length(); i += 60) {
+    std::cout << "  " << fc.sequence.substr(i, 60) << "\n";
+  }
+}
+
+int main(int argc, char *argv[]) {
+  int iterations = 2000;
+  if (argc > 1) {
+    iterations = atoi(argv[1]);
+  }
+  if (argc > 2) {
+    seed = atoi(argv[2]);
+  }
+  
+  int failures = 0;
+  for (int i=0; i < iterations; i++) {
+    unsigned int caseSeed = seed;
+    FuzzCase fc = randomCase();
+    if (compareSites(fc, false) == 0) {
+      continue;
+    }
+    ++failures;
+    fc = minimize(fc);
+    std::cout << "FAIL case " << i << " (seed " << caseSeed << ")\n";
+    printCase(fc);
+    compareSites(fc, true);
+  }
+  remove(WEIGHTS_FILE);
+  
+  std::cout << iterations << " cases, " << failures << " failed\n";
+  return (failures > 0) ? 1 : 0;
+}
@@ -0,0 +1,152 @@
+## end-to-end scaling and recall runs over synthetic genomes
+## usage: perl scaling.pl [options]
+##   --sizes 10M,100M      genome sizes to generate (k/M/G suffixes)
+##   --ks 0,1,2,3          mismatch counts to search with (-k)
+##   --pairs 10,100        number of primer pairs per run
+##   --windows 2:2,1.2:1.2 amplicon windows as min:max size factors (-f/-F)
+##   --jobs 1,2,4          concurrent pgrep processes, primer list split evenly
+##   --gc 0.41 --repeats 0.1 --chrom 50M --seed 1
+##   --blast               also search the blast style layout (-b)
+##   --pgrep ../src/primer-grep --synth ./synthgenome --work scaling_work
+##
+## Prints one tab-delimited line per run.  Recall is the fraction of planted
+## sites within k mismatches (per primer) that pgrep reported; any run below
+## 1.0 is flagged and makes the script exit non-zero.
+
+use strict;
+use Getopt::Long;
+use Time::HiRes qw(time);
+
+my %opt = ('sizes' => '10M', 'ks' => '0,1,2,3', 'pairs' => '10,100', 'windows' => '2:2',
+           'jobs' => '1', 'gc' => 0.41, 'repeats' => 0.1, 'chrom' => '50M', 'seed' => 1,
+           'pgrep' => '../src/primer-grep', 'synth' => './synthgenome', 'work' => 'scaling_work');
+
+main();
+
+sub main {
+  GetOptions(\%opt, 'sizes=s', 'ks=s', 'pairs=s', 'windows=s', 'jobs=s', 'gc=f', 'repeats=f',
+             'chrom=s', 'seed=i', 'blast', 'pgrep=s', 'synth=s', 'work=s') || die "Bad options.\n";
+  my @sizes = split(/,/, $opt{'sizes'});
+  my @ks = split(/,/, $opt{'ks'});
+  my @pairs = split(/,/, $opt{'pairs'});
+  my @windows = split(/,/, $opt{'windows'});
+  my @jobs = split(/,/, $opt{'jobs'});
+  my $maxK = (sort {$b <=> $a} @ks)[0];
+  my $maxPairs = (sort {$b <=> $a} @pairs)[0];
+  
+  mkdir $opt{'work'} unless (-d $opt{'work'});
+  my $lost = 0;
+  print join("\t", 'GenomeSize', 'Layout', 'k', 'Pairs', 'Window', 'Jobs', 'WallSeconds',
+             'PairGbasesPerSec', 'Expected', 'Found', 'Recall', 'OtherSites') . "\n";
+  
+  foreach my $size (@sizes) {
+    my $prefix = "$opt{'work'}/g$size";
+    my $start = time();
+    my $cmd = "$opt{'synth'} -o $prefix -s $size -c $opt{'chrom'} -g $opt{'gc'} -r $opt{'repeats'} " .
+              "-n $maxPairs -m $maxK -x $opt{'seed'}" . ($opt{'blast'} ? " -b" : "") . " 2> /dev/null";
+    system($cmd) == 0 || die "ERROR:  $cmd failed.\n";
+    print STDERR sprintf("Generated %s in %.1f s\n", $size, time() - $start);
+    
+    my $bases = genomeBases($size);
+    my @primerLines = readLines("$prefix.primers.txt");
+    my @truth = readLines("$prefix.truth.txt");
+    my $header = shift @primerLines;
+    shift @truth;
+    
+    my @layouts = ("-d $prefix.pdb");
+    push @layouts, "-b $prefix" if ($opt{'blast'});
+    foreach my $layout (@layouts) {
+      foreach my $k (@ks) {
+        foreach my $n (@pairs) {
+          next if ($n > @primerLines+0);
+          foreach my $window (@windows) {
+            my ($f, $F) = split(/:/, $window);
+            foreach my $j (@jobs) {
+              my ($seconds, %sites) = runPgrep($prefix, $layout, $k, $f, $F, $j, $header, @primerLines[0..$n-1]);
+              
+              ## planted sites that should be found at this k
+              my %ids = map {(split(/\t/, $_))[0] => 1} @primerLines[0..$n-1];
+              my ($expected, $found) = (0, 0);
+              my %planted;
+              foreach my $t (@truth) {
+                my ($id, $seq, $tstart, $tstop, $strand, $fmm, $rmm) = split(/\t/, $t);
+                next unless ($ids{$id});
+                $planted{"$id\t$seq\t$tstart\t$tstop"} = 1;
+                next if ($fmm > $k || $rmm > $k);
+                $expected++;
+                $found++ if ($sites{"$id\t$seq\t$tstart\t$tstop"});
+              }
+              my $other = grep {!$planted{$_}} keys %sites;
+              my $recall = ($expected > 0) ? $found / $expected : 1;
+              $lost++ if ($found < $expected);
+              
+              print join("\t", $size, substr($layout, 0, 2), $k, $n, $window, $j, sprintf("%.3f", $seconds),
+                         sprintf("%.3f", $n * $bases / $seconds / 1e9), $expected, $found,
+                         sprintf("%.3f", $recall) . (($found < $expected) ? " LOST" : ""), $other) . "\n";
+            }
+          }
+        }
+      }
+    }
+  }
+  
+  exit(($lost > 0) ? 1 : 0);
+}
+
+## run pgrep in full output mode over the primers, split across $jobs
+## concurrent processes, and return the wall time and the sites found
+sub runPgrep {
+  my ($prefix, $layout, $k, $f, $F, $jobs, $header, @primers) = @_;
+  
+  my @pids;
+  my $start = time();
+  for (my $j = 0; $j < $jobs; $j++) {
+    my @mine = map {$primers[$_]} grep {$_ % $jobs == $j} (0..$#primers);
+    next if (@mine+0 == 0);
+    open(PRIMERS, "> $prefix.job$j.txt") || die "$!";
+    print PRIMERS join("\n", $header, @mine) . "\n";
+    close PRIMERS;
+    
+    my $pid = fork();
+    die "$!" unless (defined $pid);
+    if ($pid == 0) {
+      exec("$opt{'pgrep'} -k $k -f $f -F $F -M 10000 $layout -p $prefix.job$j.txt -o > $prefix.job$j.out") || die "$!";
+    }
+    push @pids, $pid;
+  }
+  foreach my $pid (@pids) {
+    waitpid($pid, 0);
+    die "ERROR:  pgrep failed.\n" if ($? != 0);
+  }
+  my $seconds = time() - $start;
+  
+  my %sites;
+  for (my $j = 0; $j < $jobs; $j++) {
+    next unless (-e "$prefix.job$j.out");
+    foreach my $line (readLines("$prefix.job$j.out")) {
+      my @cols = split(/\t/, $line);
+      next if ($cols[0] eq 'PrimerPairId');
+      $sites{join("\t", @cols[0..3])} = 1;
+    }
+    unlink("$prefix.job$j.out", "$prefix.job$j.txt");
+  }
+  return ($seconds, %sites);
+}
+
+sub readLines {
+  my $filename = shift;
+  open(FILE, $filename) || die "$filename: $!";
+  my @lines = <FILE>;
+  close FILE;
+  map {s/\s*$//} @lines;
+  return @lines;
+}
+
+sub genomeBases {
+  my $size = shift;
+  my %mult = ('k' => 1e3, 'K' => 1e3, 'm' => 1e6, 'M' => 1e6, 'g' => 1e9, 'G' => 1e9);
+  if ($size =~ /^([\d.]+)([kKmMgG])$/) {
+    return $1 * $mult{$2};
+  }
+  return $size;
+}
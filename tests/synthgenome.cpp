@@ -0,0 +1,437 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <string.h>
+#include <stdlib.h>
+#include "Properties.h"
+
+/////////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2007 Affymetrix, Inc.                                         //
+//                                                                             //
+// This program is free software; you can redistribute it and/or modify        //
+// it under the terms of the GNU General Public License (version 2) as         //
+// published by the Free Software Foundation.                                  //
+//                                                                             //
+// This program is distributed in the hope that it will be useful,             //
+// but WITHOUT ANY WARRANTY; without even the implied warranty of              // 
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU            //
+// General Public License for more details.                                    //
+//                                                                             //
+// You should have received a copy of the GNU General Public License           //
+// along with this program;if not, write to the                                //
+//                                                                             //
+// Free Software Foundation, Inc.,                                             //
+// 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA                       // 
+/////////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////
+// synthgenome                                                               //
+// - Deterministic synthetic genome for end-to-end scaling runs.  Writes a   //
+//   pgrep db (and optionally a blast style .nin/.nhr/.nsq layout that       //
+//   pgrep -b reads), a primer file, and the truth table of every primer     //
+//   pair planted in it with a known number of mismatches per primer.        //
+///////////////////////////////////////////////////////////////////////////////  
+
+const int NFAMILIES = 8;       // repeat families
+const int MIN_PRIMER = 18;
+const int MAX_PRIMER = 25;
+const double REPEAT_DIVERGENCE = 0.10;
+
+unsigned long long state = 88172645463325252LLU;
+
+///////////////////////////////////////////////////////////////////////////////
+// nextRandom / uniform                                                      //
+//  output: next xorshift64* value <unsigned long long>, or a uniform        //
+//          double in [0,1) <double>                                         //
+///////////////////////////////////////////////////////////////////////////////  
+
+unsigned long long nextRandom() {
+  state ^= state >> 12;
+  state ^= state << 25;
+  state ^= state >> 27;
+  return state * 2685821657736338717LLU;
+}
+
+double uniform() {
+  return (nextRandom() >> 11) * (1.0 / 9007199254740992.0);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// randomBase                                                                //
+//  inputs: GC fraction <double>                                             //
+//  output: base code, A0 C1 G2 T3 <unsigned char>                           //
+///////////////////////////////////////////////////////////////////////////////  
+
+unsigned char randomBase(double gc) {
+  double u = uniform();
+  if (u < gc) {
+    return (u < gc/2) ? 1 : 2;
+  }
+  return (u < gc + (1-gc)/2) ? 0 : 3;
+}
+
+std::string randomSeq(int n, double gc) {
+  std::string seq(n, 'A');
+  for (int i=0; i < n; i++) {
+    seq[i] = "ACGT"[randomBase(gc)];
+  }
+  return seq;
+}
+
+std::string reverseComplement(std::string seq) {
+  std::string rc(seq.length(), 'N');
+  for (unsigned int i=0; i < seq.length(); i++) {
+    char b = seq[seq.length() - 1 - i];
+    rc[i] = (b == 'A') ? 'T' : (b == 'C') ? 'G' : (b == 'G') ? 'C' : 'A';
+  }
+  return rc;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// mutate                                                                    //
+//  inputs: sequence <std::string>, mismatch count <int>, bases at the 3'    //
+//          end to keep exact <int>                                          //
+//  output: the sequence with that many distinct positions changed           //
+//          <std::string>                                                    //
+///////////////////////////////////////////////////////////////////////////////  
+
+std::string mutate(std::string seq, int mismatches, int keep3) {
+  std::vector<bool> used(seq.length(), false);
+  int n = 0;
+  while (n < mismatches) {
+    int p = nextRandom() % (seq.length() - keep3);
+    if (used[p]) {
+      continue;
+    }
+    char b;
+    do {
+      b = "ACGT"[nextRandom() & 3];
+    } while (b == seq[p]);
+    seq[p] = b;
+    used[p] = true;
+    ++n;
+  }
+  return seq;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// parseSize                                                                 //
+//  inputs: size with optional k/M/G suffix <std::string>                    //
+//  output: number of bases <unsigned long long>                             //
+///////////////////////////////////////////////////////////////////////////////  
+
+unsigned long long parseSize(std::string text) {
+  double size = atof(text.c_str());
+  switch (text[text.length()-1]) {
+    case 'k': case 'K': size *= 1e3; break;
+    case 'm': case 'M': size *= 1e6; break;
+    case 'g': case 'G': size *= 1e9; break;
+  }
+  return (unsigned long long) size;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// PlantedPair                                                               //
+// - One primer pair and the site planted for it                             //
+///////////////////////////////////////////////////////////////////////////////  
+
+struct PlantedPair {
+  std::string id;
+  std::string forPrimer;
+  std::string revPrimer;
+  int ampSize;
+  int chrom;
+  unsigned long long start; // 0-based, plus strand
+  int strand;               // 0 plus, 1 minus
+  int forMismatches;
+  int revMismatches;
+};
+
+void writeBigEndian(std::ofstream &out, int value) {
+  unsigned char b[4] = {(unsigned char) (value >> 24), (unsigned char) (value >> 16),
+                        (unsigned char) (value >> 8), (unsigned char) value};
+  out.write((char*) b, 4);
+}
+
+void usage() {
+  std::cerr << "usage: synthgenome -o prefix [options]\n\n";
+  std::cerr << "Option\tArgument\tDescription\n";
+  std::cerr << " o\tprefix\tOutput prefix: <prefix>.pdb, <prefix>.primers.txt, <prefix>.truth.txt (REQUIRED).\n";
+  std::cerr << " s\tsize\tGenome size in bases, k/M/G suffixes allowed (default 10M).\n";
+  std::cerr << " c\tsize\tMaximum sequence (chromosome) size (default 50M).\n";
+  std::cerr << " g\tfraction\tGC content (default 0.41).\n";
+  std::cerr << " r\tfraction\tFraction of the genome made of interspersed repeats (default 0.1).\n";
+  std::cerr << " n\tpairs\tNumber of primer pairs to plant (default 100).\n";
+  std::cerr << " m\tmismatches\tMaximum mismatches planted per primer (default 3).\n";
+  std::cerr << " a\tmin max\tPlanted amplicon size range (default 100 600).\n";
+  std::cerr << " x\tseed\tRandom seed (default 1).\n";
+  std::cerr << " b\tnone\tAlso write a blast style db <prefix>.nin/.nhr/.nsq for pgrep -b.\n";
+  exit(1);
+}
+
+int main(int argc, char *argv[]) {
+  std::string prefix;
+  unsigned long long genomeSize = 10000000;
+  unsigned long long chromSize = 50000000;
+  double gc = 0.41;
+  double repeatFraction = 0.1;
+  int npairs = 100;
+  int maxMismatches = 3;
+  int minAmp = 100;
+  int maxAmp = 600;
+  unsigned long long seed = 1;
+  bool writeBlast = false;
+  
+  std::vector<std::string> args(argv, argv + argc);
+  int ai = 1;
+  while (ai < argc && args[ai][0] == '-') {
+    char option = args[ai++][1];
+    if (option != 'b' && option != 'h' && ai >= argc) {
+      std::cerr << "ERROR:  Expecting a value after -" << option << " option.\n";
+      usage();
+    }
+    switch (option) {
+      case 'o' : prefix = args[ai++]; break;
+      case 's' : genomeSize = parseSize(args[ai++]); break;
+      case 'c' : chromSize = parseSize(args[ai++]); break;
+      case 'g' : gc = atof(args[ai++].c_str()); break;
+      case 'r' : repeatFraction = atof(args[ai++].c_str()); break;
+      case 'n' : npairs = atoi(args[ai++].c_str()); break;
+      case 'm' : maxMismatches = atoi(args[ai++].c_str()); break;
+      case 'x' : seed = strtoull(args[ai++].c_str(), NULL, 10); break;
+      case 'b' : writeBlast = true; break;
+      case 'a' :
+        if (ai + 1 >= argc) {
+          std::cerr << "ERROR:  Expecting min and max amplicon size after -a option.\n";
+          usage();
+        }
+        minAmp = atoi(args[ai++].c_str());
+        maxAmp = atoi(args[ai++].c_str());
+        break;
+      default :
+        usage();
+    }
+  }
+  if (prefix.empty() || genomeSize < 1000 || chromSize < (unsigned long long) maxAmp * 4 ||
+      minAmp < 2*MAX_PRIMER || maxAmp < minAmp || maxAmp >= MAX_AMP_SIZE || gc <= 0 || gc >= 1) {
+    usage();
+  }
+  // the 32 bit db sizes cap one sequence at 16 Gb, blast offsets at 8 Gb
+  if (chromSize > 2000000000LLU || (writeBlast && genomeSize > 8000000000LLU)) {
+    std::cerr << "ERROR:  Sequence or genome too large for the db format.\n";
+    exit(1);
+  }
+  state ^= seed * 0x9E3779B97F4A7C15LLU;
+  nextRandom();
+  
+  int nchroms = int((genomeSize + chromSize - 1) / chromSize);
+  if (writeBlast && nchroms > MAX_BLAST_ENTRIES) {
+    std::cerr << "ERROR:  A blast db may hold at most " << MAX_BLAST_ENTRIES << " seqs.  Increase -c.\n";
+    exit(1);
+  }
+  
+  // repeat families, 300 bp to 6 kb like SINEs and LINE fragments
+  std::vector<std::string> families;
+  for (int f=0; f < NFAMILIES; f++) {
+    families.push_back(randomSeq(300 + nextRandom() % 5700, gc));
+  }
+  
+  // choose the pairs and where they go; sites are kept apart so none
+  // overlap
+  std::vector<PlantedPair> pairs;
+  std::vector<std::vector<unsigned long long> > used(nchroms);
+  for (int p=0; p < npairs; p++) {
+    PlantedPair pp;
+    std::ostringstream id;
+    id << "syn" << p;
+    pp.id = id.str();
+    pp.forPrimer = randomSeq(MIN_PRIMER + nextRandom() % (MAX_PRIMER - MIN_PRIMER + 1), 0.5);
+    pp.revPrimer = randomSeq(MIN_PRIMER + nextRandom() % (MAX_PRIMER - MIN_PRIMER + 1), 0.5);
+    pp.ampSize = minAmp + nextRandom() % (maxAmp - minAmp + 1);
+    pp.strand = nextRandom() & 1;
+    pp.forMismatches = nextRandom() % (maxMismatches + 1);
+    pp.revMismatches = nextRandom() % (maxMismatches + 1);
+    
+    bool placed = false;
+    for (int tries=0; tries < 1000 && !placed; tries++) {
+      unsigned long long pos = nextRandom() % (genomeSize - maxAmp);
+      pp.chrom = int(pos / chromSize);
+      pp.start = pos % chromSize;
+      unsigned long long thisSize = (pp.chrom == nchroms - 1) ? genomeSize - pp.chrom*chromSize : chromSize;
+      if (pp.start + pp.ampSize >= thisSize) {
+        continue;
+      }
+      placed = true;
+      for (unsigned int u=0; u < used[pp.chrom].size(); u++) {
+        if (pp.start < used[pp.chrom][u] + 2*maxAmp && used[pp.chrom][u] < pp.start + 2*maxAmp) {
+          placed = false;
+          break;
+        }
+      }
+    }
+    if (!placed) {
+      std::cerr << "ERROR:  Could not place " << npairs << " pairs.  Use a larger genome.\n";
+      exit(1);
+    }
+    used[pp.chrom].push_back(pp.start);
+    pairs.push_back(pp);
+  }
+  
+  std::string pdbName = prefix + ".pdb";
+  std::ofstream pdb(pdbName.c_str(), std::ios::out | std::ios::binary);
+  std::ofstream nsq;
+  std::vector<std::string> seqNames;
+  std::vector<unsigned int> seqBytes;
+  if (writeBlast) {
+    std::string nsqName = prefix + ".nsq";
+    nsq.open(nsqName.c_str(), std::ios::out | std::ios::binary);
+    nsq.put(0);
+  }
+  if (!pdb || (writeBlast && !nsq)) {
+    std::cerr << "ERROR:  Could not write to " << prefix << ".*\n";
+    exit(1);
+  }
+  
+  std::vector<unsigned char> codes;
+  std::vector<char> packed;
+  for (int c=0; c < nchroms; c++) {
+    unsigned long long size = (c == nchroms - 1) ? genomeSize - c*chromSize : chromSize;
+    codes.resize(size);
+    for (unsigned long long i=0; i < size; i++) {
+      codes[i] = randomBase(gc);
+    }
+    
+    // interspersed repeats, each copy diverged from its family
+    unsigned long long repeatBases = 0;
+    while (repeatBases < repeatFraction * size) {
+      std::string &family = families[nextRandom() % NFAMILIES];
+      int length = 100 + nextRandom() % (family.length() - 99);
+      if ((unsigned long long) length >= size) {
+        break;
+      }
+      unsigned long long pos = nextRandom() % (size - length);
+      bool minus = nextRandom() & 1;
+      for (int i=0; i < length; i++) {
+        char b = minus ? family[family.length() - 1 - i] : family[i];
+        unsigned char code = (b == 'A') ? 0 : (b == 'C') ? 1 : (b == 'G') ? 2 : 3;
+        if (minus) {
+          code = 3 - code;
+        }
+        if (uniform() < REPEAT_DIVERGENCE) {
+          code = nextRandom() & 3;
+        }
+        codes[pos + i] = code;
+      }
+      repeatBases += length;
+    }
+    
+    // plant the amplicons: for primer ... reverse complement of rev
+    // primer, mismatches kept off the last 3 bases so the 3' end holds
+    for (unsigned int p=0; p < pairs.size(); p++) {
+      PlantedPair &pp = pairs[p];
+      if (pp.chrom != c) {
+        continue;
+      }
+      std::string amp = randomSeq(pp.ampSize, gc);
+      std::string forSite = mutate(pp.forPrimer, pp.forMismatches, 3);
+      std::string revSite = reverseComplement(mutate(pp.revPrimer, pp.revMismatches, 3));
+      amp.replace(0, forSite.length(), forSite);
+      amp.replace(amp.length() - revSite.length(), revSite.length(), revSite);
+      if (pp.strand) {
+        amp = reverseComplement(amp);
+      }
+      for (int i=0; i < pp.ampSize; i++) {
+        char b = amp[i];
+        codes[pp.start + i] = (b == 'A') ? 0 : (b == 'C') ? 1 : (b == 'G') ? 2 : 3;
+      }
+    }
+    
+    // pack 4 bases per byte, first base in the high bits, padded with A
+    unsigned int nbytes = (unsigned int) ((size + 3) / 4);
+    packed.assign(nbytes, 0);
+    for (unsigned long long i=0; i < size; i++) {
+      packed[i/4] |= codes[i] << (6 - 2*(i % 4));
+    }
+    
+    std::ostringstream name;
+    name << "synth" << (c + 1);
+    char seqName[MAX_SEQNAME_SIZE];
+    memset(seqName, 0, MAX_SEQNAME_SIZE);
+    strncpy(seqName, name.str().c_str(), MAX_SEQNAME_SIZE - 1);
+    pdb.write(seqName, MAX_SEQNAME_SIZE);
+    pdb.write((char*) &nbytes, sizeof(unsigned int));
+    pdb.write(&packed[0], nbytes);
+    if (writeBlast) {
+      nsq.write(&packed[0], nbytes);
+    }
+    seqNames.push_back(name.str());
+    seqBytes.push_back(nbytes);
+    std::cerr << name.str() << "\t" << size << " bases\n";
+  }
+  pdb.close();
+  
+  if (writeBlast) {
+    // headers are 8 bytes, the name, then 32 bytes that pgrep skips
+    std::string nhrName = prefix + ".nhr";
+    std::string ninName = prefix + ".nin";
+    std::ofstream nhr(nhrName.c_str(), std::ios::out | std::ios::binary);
+    std::ofstream nin(ninName.c_str(), std::ios::out | std::ios::binary);
+    char pad[32];
+    memset(pad, 0, 32);
+    for (int c=0; c < nchroms; c++) {
+      nhr.write(pad, 8);
+      nhr.write(seqNames[c].c_str(), seqNames[c].length());
+      nhr.write(pad, 32);
+    }
+    
+    std::string title = "synthgenome " + prefix;
+    std::string date = "synthetic";
+    writeBigEndian(nin, 4);   // formatdb version
+    writeBigEndian(nin, 0);   // nucleotide
+    writeBigEndian(nin, title.length());
+    nin.write(title.c_str(), title.length());
+    writeBigEndian(nin, date.length());
+    nin.write(date.c_str(), date.length());
+    writeBigEndian(nin, nchroms);
+    unsigned long long total = genomeSize;
+    nin.write((char*) &total, 8);
+    unsigned int maxSeq = 0;
+    for (int c=0; c < nchroms; c++) {
+      maxSeq = (seqBytes[c]*4 > maxSeq) ? seqBytes[c]*4 : maxSeq;
+    }
+    writeBigEndian(nin, maxSeq);
+    int offset = 0;
+    for (int c=0; c <= nchroms; c++) {
+      writeBigEndian(nin, offset);
+      if (c < nchroms) {
+        offset += 8 + seqNames[c].length() + 32;
+      }
+    }
+    offset = 1;
+    for (int c=0; c <= nchroms; c++) {
+      writeBigEndian(nin, offset);
+      if (c < nchroms) {
+        offset += seqBytes[c];
+      }
+    }
+  }
+  
+  // primers and truth, in pgrep full output coordinates (1-based,
+  // inclusive, strand 1 when the site reads rev primer first)
+  std::string primerName = prefix + ".primers.txt";
+  std::string truthName = prefix + ".truth.txt";
+  std::ofstream primers(primerName.c_str());
+  std::ofstream truth(truthName.c_str());
+  primers << "PrimerPairId\tForwardPrimer\tReversePrimer\tAmpSize\n";
+  truth << "PrimerPairId\tTemplateSequenceName\tMatchStart\tMatchStop\tMatchStrand\tForwardMismatches\tReverseMismatches\n";
+  for (unsigned int p=0; p < pairs.size(); p++) {
+    PlantedPair &pp = pairs[p];
+    primers << pp.id << "\t" << pp.forPrimer << "\t" << pp.revPrimer << "\t" << pp.ampSize << "\n";
+    truth << pp.id << "\t" << seqNames[pp.chrom] << "\t" << (pp.start + 1) << "\t" << (pp.start + pp.ampSize) << "\t"
+          << pp.strand << "\t" << pp.forMismatches << "\t" << pp.revMismatches << "\n";
+  }
+  
+  return 0;
+}